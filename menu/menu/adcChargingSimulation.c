@@ -8,12 +8,14 @@ Output: There are two outputs for this module, that are being
 passed to the inheriting module main:
 _charge function returns true whenever simulation's reached the
 desired value or user has cancelled it.
-The simulation value then is stored in external variable
-double energy that is being used by main module menu.
+The simulation value then is kept by energyMeter module
+and read from it by main module menu.
 
 Uses: It is self sufficient module, thus it uses other
 driver modules such as:
 LCD, Timer, Keypad and USART (debugging purpose) drivers.
+Samples are taken by periodic software timer (timerWheel), 
+keypad is scanned between them.
 
 Author: Ultra 2000
 Company: DTU Dipom
@@ -36,28 +38,31 @@ Date and year: 2014/05/26
 #include "driverLCD.h"
 #include "driverUSART.h"
 #include "driverKeyPad.h"
+#include "timerWheel.h"
+#include "screenTemplates.h"
+#include "fixedPoint.h"
+#include "energyMeter.h"
+#include "driverADC.h"
 
 #define NsampleSeconds 1
+/* Samples taken from ADC ring at once, whole frames */
+#define METER_BLOCK (4 * ADC_CHANNELS)
 #define F_CPU 10000000L
 
 /* -----------------------------------------------------
 Global parameters used:
 
-char buffer[12];			Buffer to store ADC read values
-double energy = 0;			decimal value of sampled energy v
-double Last_power = 0;		"-"
-uint16_t data = 0;			sample readings from ADC
-uint16_t lastData = 0;		"-"
+char buffer[12];			Buffer to store values written to LCD
+uint32_t shownPower = 0;	power that is shown on LCD, thousandths of mW
 bool cancelled = false;		Bool variable for flagging simulation cancellation by user
+bool sampleDue = false;		Set by sample timer when it is time to sample
 -----------------------------------------------------*/
 
 char buffer[12];
 //int n=0;
-double energy = 0;
-double Last_power = 0;
-uint16_t data = 0;
-uint16_t lastData = 0;
+uint32_t shownPower = 0;
 bool cancelled = false;
+bool sampleDue = false;
 
 // char arrow = 0b01111110;
 // char CustomChar1 = 0b00000000;
@@ -68,13 +73,11 @@ char ful5x8font = 0b11111111;
 
 typedef unsigned int uint16_t;
 
-void initADC();
-unsigned doSample();
-void onADC();
-void offADC();
 bool chargeADC();
-void progressBar(double _energy);
+void progressBar(uint32_t _energy);
 bool waitAndScanKeyPad();
+void sampleTick(void);
+void meterSamples(void);
 
 /* -----------------------------------------------------
 void initCharge(void)
@@ -86,63 +89,66 @@ void initCharge(void)
 {
 	lcd_init();
 	keypad_init();
-	initADC();
-	init_timer1(0,1);
+	init_timer1(1,0);
 	USART_Init(64);
-	onADC();
+	energyMeterLoadCalibration();
+	energyMeterReset();
+	adcStart();
 	
-	lcdClear();
-	_delay_ms(15);
-	GoTo(0,0);
-	LCDPutString("Energy:          mWs");
-	_delay_ms(10);
-	GoTo(0,1);
-	_delay_ms(10);
-	LCDPutString("Power:           mW");
-	_delay_ms(10);
-	GoTo(0,2);
-	LCDPutString("Charging progress:");
+	drawScreen(SCREEN_CHARGING);
 	sei();
 }
 
 /* -----------------------------------------------------
 void startCharge(void)
-Initiates charge() function and returns true when simulation
-is done
+Starts sample timer, initiates charge() function and returns
+true when simulation is done
 -----------------------------------------------------*/
 
 bool startCharge(){
 	//initCharge();
+	int8_t sampleTimer = timerStart(NsampleSeconds * 1000, NsampleSeconds * 1000, sampleTick);
+	
+	sampleDue = false;
 	while(!chargeADC());
+	timerStop(sampleTimer);
 	return true;
 }
 /* -----------------------------------------------------
+void sampleTick(void)
+Callback of sample timer, fired every NsampleSeconds.
+-----------------------------------------------------*/
+void sampleTick(void){
+	sampleDue = true;
+}
+/* -----------------------------------------------------
 bool waitAndScanKeyPad()
-The function uses the time ADC samples it's values and 
-scans keypad for user interaction (cancels charging sim)
-meanwhile. Let's say, ADC readings are being sampled every
-4 seconds, thus keypad is scanned four seconds and then 
-sample is made.
+The function waits until it is time to show the next sample
+and scans keypad for user interaction (cancels charging sim)
+meanwhile. ADC samples in the background (driverADC), here
+samples are taken from its ring to energy meter. Software
+timers are polled here, sample timer sets sampleDue, and
+LCD shadow is flushed.
 -----------------------------------------------------*/
 bool waitAndScanKeyPad(){
-	if(second == NsampleSeconds) {
- 		second = 0;
+	timerPoll();
+	meterSamples();
+	lcdFlush();
+	if(sampleDue) {
+ 		sampleDue = false;
 		return true;
 	}else{
-		if (scanKeyPad() == 1)
+		if (keypad_get(KEYPAD_NO_WAIT) == 'B')
 		{
-			if (returnKey() == 'B')
-			{
-				cancelled = true;
-			}
+			cancelled = true;
 		}
 		return false;
 	}
 }
 /* -----------------------------------------------------
 bool charge()
-Main function that returns true and stores energy used value
-in energy variable. It returns true whenever energy value 
+Main function that returns true and counts energy used in
+energyMeter. It returns true whenever energy value
 reached desired one or user's cancelled it.
 -----------------------------------------------------*/
 bool chargeADC(){
@@ -150,113 +156,69 @@ bool chargeADC(){
  	while(!waitAndScanKeyPad());
 	if (cancelled)
 	{
-		offADC();
+		adcStop();
 		return true;
 	}
-		data = doSample();
-		
-		double power = data/(0.4*1023);   //mW  uW 0.4*1.023
+		//real power (voltage times current), decimated and
+		//averaged by energy meter, read once per second
+		uint32_t power = energyMeterPower(3);
 		if (power == 0)
 		{
-			energy = 0;
-		}
-		else
-		{
-			energy = energy + power;
+			energyMeterReset();
 		}
 		
-		//Only update lcd if needed
-		if(Last_power!= power) {
-			if(snprintf(buffer,8, "%.3f \r\n", (double) power )) {
-				GoTo(10,1);
-			
-				_delay_ms(10);
-				LCDPutString("       ");
-				_delay_ms(10);
-				GoTo(10,1);
-				_delay_ms(10);
-				LCDPutString(buffer);
-				Last_power = power;
-				}else{
-				LCDPutString("not converted");
-			}
-		}
-		
-		
-		
-		if (buffer == ultoa(energy, buffer, 10)) {  //last number is the radix
-			snprintf(buffer,8, "%.1f \r\n", (double) energy );
-			GoTo(10,0);
-			LCDPutString("      ");
-			_delay_ms(10);
-			GoTo(10,0);
+		//Only update lcd if needed, values fill 7 char fields
+		//in front of units, so old digits need no blanking
+		if(shownPower != power) {
+			fixedFormat(buffer, power, 3, 7, true);
+			GoTo(10,1);
 			LCDPutString(buffer);
-			_delay_ms(10);
-			}else{
-			LCDPutString("not converted correct");
+			shownPower = power;
 		}
+		
+		fixedFormat(buffer, energyMeterEnergy(1), 1, 7, true);
+		GoTo(10,0);
+		LCDPutString(buffer);
 		//draw a progress bar along with value sampling
-		if (energy <= 100)
+		uint32_t energyFixed = energyMeterEnergy(2);
+		if (energyFixed <= 10000)
 		{
-			progressBar(energy);
+			progressBar(energyFixed);
 		}
 		else //simulation has reached desired value energy <= 100 and true value returned
 		{
 			GoTo(0,3);
-			LCDPutString("Charging is complete");
-			offADC();
+			LCDPutString_P(PSTR("Charging is complete"));
+			adcStop();
 			return true;
 		
 	}
 	return false;
 }
 /* -----------------------------------------------------
-void progressBar(double _energy)
+void progressBar(uint32_t _energy)
 Simple function to draw some graphical simulation
-representation. Uses _energy as input
+representation. Uses _energy (hundredths of mWs) as input
 -----------------------------------------------------*/
-void progressBar(double _energy){
-	int pos_value = (int)floor(_energy/5);
+void progressBar(uint32_t _energy){
+	int pos_value = (int)(_energy/500);
 
 	GoTo(pos_value,3);
-	lcd_data_write(ful5x8font);
+	LCDPutChar(ful5x8font);
 
 }
 /* -----------------------------------------------------
-void initADC()
-ADC initialization function
------------------------------------------------------*/
-void initADC(){
-	ADMUX|=  (1<<REFS0);  //(1<<REFS1) |(1<<REFS0) the internal adcref: external ref  (1<<REFS0); and adc0 selected
-	ADCSRA|= (1<<ADEN);   //enable triggered sampling  |(1<<ADATE)
-}
-/* -----------------------------------------------------
-unsigned int doSample()
-Samples ADC readings of ADCL and ADCH 
-and returns it's value
------------------------------------------------------*/
-unsigned int doSample(){
-	
-	unsigned int value=0;
-	ADCSRA|=(1<<ADSC);
-	while((ADCSRA & (1<<ADSC)));
-	
-	value= ADCL+ ADCH*256;
-	return value&0x3FF;
-}
-/* -----------------------------------------------------
-void onADC()
-Turns on ADC.
+void meterSamples(void)
+Metering task, takes voltage and current frames that ADC
+interrupt has put to the ring and adds them to energy meter,
+a block at a time.
 -----------------------------------------------------*/
-void onADC(){
-	ADCSRA|= (1<<ADEN);
-	
-}
-/* -----------------------------------------------------
-void offADC()
-Turns off ADC.
------------------------------------------------------*/
-void offADC() {
-	ADCSRA &=~(1<<ADEN);
+void meterSamples(void){
+	uint16_t block[METER_BLOCK];
+	uint8_t n;
 	
+	while ((n = adcRead(block, METER_BLOCK)) != 0)
+	{
+		energyMeterBlock(block, n);
+	}
 }
\ No newline at end of file
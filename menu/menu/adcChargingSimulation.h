@@ -11,7 +11,5 @@
 #include "driverLCD.h"
 #include "driverUSART.h"
 
-extern double energy;
-
 extern bool startCharge(void);
 extern void initCharge(void);
\ No newline at end of file
@@ -0,0 +1,93 @@
+/*---------------------------------------------------------
+Purpose: The purpose of this module is to keep price and
+sum to be paid as whole ore (1/100 dkk) in integers, so that
+controller, RFID card and server get exactly the same numbers
+and no floating point is needed at the end of session.
+
+Input: Tariff in ore per kWs, set by billingSetTariff, read
+from server reply as decimal string ("2.5", "15", "1.25") by
+billingTariffFromString or as 4 bytes of fixed point by
+billingTariffFromBinary. Energy is taken from energyMeter.
+
+Output: int32_t billingClose(void) counts total of the session
+(totalOre) as energy * tariff. Product is rounded only once,
+to the nearest ore, half up. billingToString writes ore in
+canonical ASCII form, always with two decimals ("12.50"),
+billingToBinary in canonical binary form, 4 bytes most
+significant first, the same way server packages carry
+hundredths.
+
+Uses: "fixedPoint.h", "formPacket.h" and "energyMeter.h"
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "fixedPoint.h"
+#include "formPacket.h"
+#include "energyMeter.h"
+#include "billing.h"
+
+/* Decimals of kroner in ore */
+#define ORE_DECIMALS 2
+
+int32_t tariffOre = 0;
+int32_t totalOre = 0;
+/* -----------------------------------------------------
+void billingSetTariff(int32_t ore)
+Sets tariff, ore per kWs. Negative tariff is taken as zero.
+-----------------------------------------------------*/
+void billingSetTariff(int32_t ore){
+	
+	tariffOre = (ore < 0) ? 0 : ore;
+}
+/* -----------------------------------------------------
+void billingTariffFromString(const char *str)
+Sets tariff from decimal string in kroner, digits after the
+second decimal are rounded.
+-----------------------------------------------------*/
+void billingTariffFromString(const char *str){
+	
+	billingSetTariff(fixedParse(str, ORE_DECIMALS));
+}
+/* -----------------------------------------------------
+void billingTariffFromBinary(const char *p)
+Sets tariff from 4 bytes of fixed point (hundredths, most
+significant first) as binary server packages carry it.
+-----------------------------------------------------*/
+void billingTariffFromBinary(const char *p){
+	
+	billingSetTariff(getFixed32(p));
+}
+/* -----------------------------------------------------
+int32_t billingClose(void)
+Counts total of the session from energy meter and tariff,
+stores it in totalOre and returns it.
+-----------------------------------------------------*/
+int32_t billingClose(void){
+	
+	totalOre = energyMeterScaled(tariffOre, 0);
+	return totalOre;
+}
+/* -----------------------------------------------------
+uint8_t billingToString(char *str, int32_t ore, uint8_t width)
+Writes ore as kroner with two decimals. Width 0 gives the
+number only, else it is the most chars that are written.
+Returns number of chars written.
+-----------------------------------------------------*/
+uint8_t billingToString(char *str, int32_t ore, uint8_t width){
+	
+	return fixedFormat(str, ore, ORE_DECIMALS, width, false);
+}
+/* -----------------------------------------------------
+void billingToBinary(uint8_t *p, int32_t ore)
+Writes ore as 4 bytes, most significant first.
+-----------------------------------------------------*/
+void billingToBinary(uint8_t *p, int32_t ore){
+	
+	putFixed32(p, ore);
+}
@@ -0,0 +1,13 @@
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+extern int32_t tariffOre;
+extern int32_t totalOre;
+
+extern void billingSetTariff(int32_t ore);
+extern void billingTariffFromString(const char *str);
+extern void billingTariffFromBinary(const char *p);
+extern int32_t billingClose(void);
+extern uint8_t billingToString(char *str, int32_t ore, uint8_t width);
+extern void billingToBinary(uint8_t *p, int32_t ore);
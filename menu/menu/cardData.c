@@ -0,0 +1,155 @@
+/*---------------------------------------------------------
+Purpose: The purpose of this module is to keep RFID card
+record (debt, past energy and past expense) in one 16 byte
+card block as integers, so that it is written by one reader
+command and read without any text conversion.
+
+Block layout, multi byte values most significant first (the
+same way server packages carry them):
+0		CARD_DATA_VERSION
+1		sequence, counts writes of the record
+2..5	debt, ore
+6..9	past energy, hundredths of kWs
+10..13	past expense, ore
+14..15	CRC-16/CCITT of bytes 0..13
+
+Input: bool cardDataDecode(cardRecord *record, const char
+*block, const char *energyBlock, const char *expenseBlock)
+Record block as read from card. Cards of the old layout
+keep debt, past energy and past expense as ASCII in three
+blocks, those are parsed instead (energyBlock and
+expenseBlock could be NULL if they were not read) and are
+taken over to the new layout by the next write. Block is
+taken as legacy only if it looks like one: digits, '.', '-',
+'+' or spaces, then zero bytes up to the end. Returns false
+if record check sum does not match or block is neither, so
+record with a corrupted version byte is not read as legacy.
+
+Output: void cardDataEncode(const cardRecord *record, uint8_t
+*block) writes record to 16 bytes of block. PIN is not part
+of the record, it stays in its own block.
+
+Uses: "crc16.h", "formPacket.h" and "fixedPoint.h"
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "crc16.h"
+#include "formPacket.h"
+#include "fixedPoint.h"
+#include "cardData.h"
+
+/* Bytes of the record that check sum covers */
+#define CARD_DATA_LENGTH 14
+
+uint16_t cardDataCrc(const uint8_t *block);
+bool cardLegacyBlock(const char *block);
+int32_t cardLegacyParse(const char *block);
+
+/* -----------------------------------------------------
+void cardDataEncode(const cardRecord *record, uint8_t *block)
+Writes version, sequence, values and check sum of record
+to 16 bytes of block.
+-----------------------------------------------------*/
+void cardDataEncode(const cardRecord *record, uint8_t *block){
+	
+	uint16_t crc;
+	
+	block[0] = CARD_DATA_VERSION;
+	block[1] = record->sequence;
+	putFixed32(block + 2, record->debt);
+	putFixed32(block + 6, record->pastEnergy);
+	putFixed32(block + 10, record->pastExpense);
+	crc = cardDataCrc(block);
+	block[14] = crc >> 8;
+	block[15] = crc;
+}
+/* -----------------------------------------------------
+bool cardDataDecode(cardRecord *record, const char *block, const char *energyBlock, const char *expenseBlock)
+Reads record block to record. Block that does not start
+with CARD_DATA_VERSION and looks like legacy ASCII debt is
+parsed, then legacy energy and expense blocks are parsed too
+and sequence is 0. If check sum does not match or block is
+not legacy either, values are zero and false is returned.
+-----------------------------------------------------*/
+bool cardDataDecode(cardRecord *record, const char *block, const char *energyBlock, const char *expenseBlock){
+	
+	uint16_t crc;
+	
+	if (((uint8_t)block[0] != CARD_DATA_VERSION) && cardLegacyBlock(block))
+	{
+		record->sequence = 0;
+		record->debt = cardLegacyParse(block);
+		record->pastEnergy = (energyBlock != NULL) ? cardLegacyParse(energyBlock) : 0;
+		record->pastExpense = (expenseBlock != NULL) ? cardLegacyParse(expenseBlock) : 0;
+		return true;
+	}
+	crc = ((uint16_t)(uint8_t)block[14] << 8) | (uint8_t)block[15];
+	if (((uint8_t)block[0] != CARD_DATA_VERSION) || (crc != cardDataCrc((const uint8_t *)block)))
+	{
+		record->sequence = 0;
+		record->debt = 0;
+		record->pastEnergy = 0;
+		record->pastExpense = 0;
+		return false;
+	}
+	record->sequence = block[1];
+	record->debt = getFixed32(block + 2);
+	record->pastEnergy = getFixed32(block + 6);
+	record->pastExpense = getFixed32(block + 10);
+	return true;
+}
+/* -----------------------------------------------------
+uint16_t cardDataCrc(const uint8_t *block)
+Check sum of the first CARD_DATA_LENGTH bytes of block.
+-----------------------------------------------------*/
+uint16_t cardDataCrc(const uint8_t *block){
+	
+	uint16_t crc = CRC16_INIT;
+	
+	for (uint8_t i = 0; i < CARD_DATA_LENGTH; i++)
+	{
+		crc = crc16Update(crc, block[i]);
+	}
+	return crc;
+}
+/* -----------------------------------------------------
+bool cardLegacyBlock(const char *block)
+Tells whether block could be legacy ASCII value: number
+chars first, then only zero bytes (blank block is 0).
+-----------------------------------------------------*/
+bool cardLegacyBlock(const char *block){
+	
+	uint8_t i = 0;
+	
+	while ((i < CARD_BLOCK_SIZE) && (((block[i] >= '0') && (block[i] <= '9')) ||
+		   (block[i] == '.') || (block[i] == '-') || (block[i] == '+') || (block[i] == ' ')))
+	{
+		i++;
+	}
+	while ((i < CARD_BLOCK_SIZE) && (block[i] == '\0'))
+	{
+		i++;
+	}
+	return (i == CARD_BLOCK_SIZE);
+}
+/* -----------------------------------------------------
+int32_t cardLegacyParse(const char *block)
+Reads legacy ASCII block ("12.50" padded with zero bytes)
+as hundredths. Block is not always terminated, so it is
+copied first.
+-----------------------------------------------------*/
+int32_t cardLegacyParse(const char *block){
+	
+	char text[CARD_BLOCK_SIZE + 1];
+	
+	memcpy(text, block, CARD_BLOCK_SIZE);
+	text[CARD_BLOCK_SIZE] = '\0';
+	return fixedParse(text, CARD_DATA_DECIMALS);
+}
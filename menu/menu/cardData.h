@@ -0,0 +1,28 @@
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* First byte of binary card block, never an ASCII digit, so
+it tells new record from legacy ASCII debt block */
+#define CARD_DATA_VERSION 0xC1
+/* Bytes in a card block */
+#define CARD_BLOCK_SIZE 16
+/* Card block that holds the record (was ASCII debt) */
+#define CARD_DATA_BLOCK 0x02
+/* Blocks of legacy ASCII past expense and past energy */
+#define CARD_LEGACY_EXPENSE_BLOCK 0x04
+#define CARD_LEGACY_ENERGY_BLOCK 0x05
+/* Decimals of record values, ore and hundredths of kWs */
+#define CARD_DATA_DECIMALS 2
+
+/* Card contents, values in fixed point */
+typedef struct {
+	char pin[5];			//block 1, ASCII
+	uint8_t sequence;		//times the record was written
+	int32_t debt;			//ore
+	int32_t pastEnergy;		//hundredths of kWs
+	int32_t pastExpense;	//ore
+} cardRecord;
+
+extern void cardDataEncode(const cardRecord *record, uint8_t *block);
+extern bool cardDataDecode(cardRecord *record, const char *block, const char *energyBlock, const char *expenseBlock);
@@ -0,0 +1,59 @@
+/*---------------------------------------------------------
+Purpose: The purpose of this module is to calculate CRC-16/CCITT
+(polynomial 0x1021, initial value 0xFFFF) check sum that protects
+server - controller communication packages. Check sum is updated
+one byte at a time, so it could be calculated while package is
+being formed or received.
+
+Input: uint16_t crc16Update(uint16_t crc, uint8_t byte)
+Previous check sum value (CRC16_INIT for the first byte) and
+the next byte of package.
+
+Output: Updated check sum value. void crc16ToHex(uint16_t crc,
+char *hex) writes it as four uppercase hex digits, those never
+collide with stop chars.
+
+Uses: usual avr libraries such as io.h and pgmspace.h. Lookup
+table is 16 entries (32 bytes) and lives in flash only.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <stdint.h>
+#include "crc16.h"
+
+/* CRC of every 4 bit value shifted to the top of register */
+const uint16_t crc16NibbleTable[16] PROGMEM = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+const char hexDigits[16] PROGMEM = "0123456789ABCDEF";
+/* -----------------------------------------------------
+uint16_t crc16Update(uint16_t crc, uint8_t byte)
+Shifts byte into check sum, high nibble first, using
+nibble lookup table. Returns updated check sum.
+-----------------------------------------------------*/
+uint16_t crc16Update(uint16_t crc, uint8_t byte)
+{
+	crc = (crc << 4) ^ pgm_read_word(&crc16NibbleTable[((crc >> 12) ^ (byte >> 4)) & 0x0F]);
+	crc = (crc << 4) ^ pgm_read_word(&crc16NibbleTable[((crc >> 12) ^ byte) & 0x0F]);
+	return crc;
+}
+/* -----------------------------------------------------
+void crc16ToHex(uint16_t crc, char *hex)
+Writes check sum to hex array as four uppercase hex
+digits, most significant first. No terminator is added.
+-----------------------------------------------------*/
+void crc16ToHex(uint16_t crc, char *hex)
+{
+	for (int i = 3; i >= 0; i--)
+	{
+		hex[i] = pgm_read_byte(&hexDigits[crc & 0x0F]);
+		crc >>= 4;
+	}
+}
@@ -0,0 +1,15 @@
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <stdint.h>
+
+/* Package check sum mode: 1 - CRC-16/CCITT as four hex digits,
+0 - legacy "00" and xor byte */
+#define PACKET_CRC16 1
+
+#define CRC16_INIT 0xFFFF
+
+/* Uppercase hex digits, in flash */
+extern const char hexDigits[16] PROGMEM;
+
+extern uint16_t crc16Update(uint16_t crc, uint8_t byte);
+extern void crc16ToHex(uint16_t crc, char *hex);
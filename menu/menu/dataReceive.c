@@ -4,15 +4,24 @@ packages from server and correctly interpret as well as to pass
 interpreted values to inheriting modules.
 
 Input: Input comes from ISR where USART_RXC_vect vector is passed
-as a parameter.
+as a parameter. ISR only stores bytes to the receive ring buffer,
+receivePackage() drains it from main loop, so no bytes are lost
+while main loop is busy with LCD or delays.
 
 Output: The output is a number of variables that contain
 interpreted values from data package after reception.
 extern int dl; int that has a number of bytes of received actual data
-extern char actualData[100]; string or char array with actual data in it
+extern char *const actualData; string with actual data in it
 extern int _source;	int with source value
 extern int _destination; int with destination value
 extern int _command;	int with command value
+extern uint8_t _sequence; sequence number, binary mode only
+extern uint16_t _first; position of the first byte of package
+in received byte stream, see rxPosition()
+extern int _status;	RX_OK or reason why the last package was rejected
+extern uint16_t rxFramesRejected; number of rejected packages
+extern volatile uint16_t rxOverruns; bytes dropped because ring was full
+extern volatile uint16_t rxHwOverruns; bytes lost in USART (DOR flag)
 
 Uses: USARTdriver for testing purposes, else it's self-sufficent
 
@@ -26,61 +35,138 @@ Date and year: 2014/05/26
 #include <stdbool.h>
 #include <string.h>
 #include "driverUSART.h"
+#include "dataReceive.h"
+#include "crc16.h"
+#include "formPacket.h"
 
 #define STOP_CHAR1 '-'
 #define STOP_CHAR2 '*'
+/* Package layout: header is source, destination, command
+and data lenght digits, check sum is CRC-16 as four hex digits
+or legacy "00" and xor byte */
+#define FRAME_MAX 100
+#define FRAME_HEADER_LEN 10
+#if PACKET_CRC16
+#define CHECKSUM_LEN 4
+#else
+#define CHECKSUM_LEN 3
+#endif
+#define FRAME_DATA_MAX (FRAME_MAX - FRAME_HEADER_LEN - CHECKSUM_LEN)
+/* Receive ring size, must be power of two and not bigger
+than 128, because 8 bit free running indexes are used */
+#define RX_RING_SIZE 64
+#define RX_RING_MASK (RX_RING_SIZE - 1)
 /*			Global variables
 	Developer believes that 
 	variable names speak for
 	themselves. 
 */
-volatile char arrivedByte;
-volatile bool packageArrival = false;
-volatile bool packageArrived = false;
-bool datastart = false;
+volatile char rxRing[RX_RING_SIZE];
+volatile uint8_t rxHead = 0;	//written by ISR only
+volatile uint8_t rxTail = 0;	//written by main loop only
+uint16_t rxTaken = 0;			//bytes taken from ring, main loop only
+volatile uint16_t rxOverruns = 0;
+volatile uint16_t rxHwOverruns = 0;
+
+/* Package parser states */
+typedef enum {
+	rxIdle,
+	rxStart,
+	rxHeader,
+	rxBinHeader,
+	rxBinLength,
+	rxData,
+	rxChecksum,
+	rxBinChecksum,
+	rxStop1,
+	rxStop2,
+	rxBadStop1,
+	rxBadStop2
+} rxParserState;
+
+rxParserState rxState = rxIdle;
+char frameBuffer[FRAME_MAX];
+int rxSource;
+int rxDestination;
+int rxCommand;
+int rxLength;
+uint8_t rxSequence;
+uint16_t rxFirstByte;
+bool rxCorrupted = false;
+uint16_t rxFramesRejected = 0;
 
-char dataArrived[100];
-char source[3];
-char destination[3];
-char command[3];
-char dataLenght[5];
-char checksum[4];
 int dl;
-char actualData[100];
+char *const actualData = frameBuffer + FRAME_HEADER_LEN;
 int _source;
 int _destination;
 int _command;
-int _status;
-static char prevByteisr = 0;
-static char currByteisr = 0;
+uint8_t _sequence;
+uint16_t _first;
+int _status = RX_OK;
 
 
 bool receivePackage(void);
 bool packageReceived(void);
+bool rxRingGet(char *byte);
+uint16_t rxPosition(void);
+void rejectPackage(int reason, char byte);
+bool parseByte(char byte);
 
 /* -----------------------------------------------------
 ISR(USART_RXC_vect)
 Interrupt service routine is used by passing USART receive
-vector. It receives byte and stores it's value in currByteisr
-variable and also determines the beginning of data package by
-detecting consecutive bytes to be stop char 2 and stop char 1
-and setting datastart true and start to store arrived data byte
-to arrivedByte variable.
+vector. It receives byte and stores it in rxRing at rxHead.
+If ring is full, byte is dropped and rxOverruns is increased,
+if USART itself has lost a byte (DOR flag), rxHwOverruns is
+increased. Indexes are free running, so ring is full when
+head and tail differ by RX_RING_SIZE.
 -----------------------------------------------------*/
 ISR(USART_RXC_vect)
 {
-	prevByteisr = currByteisr;
-	currByteisr = UDR;
-	if (datastart)
+	if (UCSRA & (1<<DOR))
 	{
-		packageArrival = true;
-		arrivedByte = currByteisr;
+		rxHwOverruns++;
 	}
-	if ((currByteisr == STOP_CHAR1) && (prevByteisr == STOP_CHAR2))
+	char byte = UDR;
+	uint8_t head = rxHead;
+	
+	if ((uint8_t)(head - rxTail) >= RX_RING_SIZE)
 	{
-		datastart = true;
+		rxOverruns++;
+		return;
 	}
+	rxRing[head & RX_RING_MASK] = byte;
+	rxHead = head + 1;
+}
+/* -----------------------------------------------------
+bool rxRingGet(char *byte)
+Takes the oldest byte from receive ring and stores it to
+*byte. Returns false if ring is empty. Only main loop calls
+it, so rxTail needs no protection, rxHead is a single byte
+and is read atomically.
+-----------------------------------------------------*/
+bool rxRingGet(char *byte)
+{
+	uint8_t tail = rxTail;
 	
+	if (tail == rxHead)
+	{
+		return false;
+	}
+	*byte = rxRing[tail & RX_RING_MASK];
+	rxTail = tail + 1;
+	rxTaken++;
+	return true;
+}
+/* -----------------------------------------------------
+uint16_t rxPosition(void)
+Number of bytes received so far, the ones still in ring
+included, wraps. Package whose _first is not before it
+has begun after this call.
+-----------------------------------------------------*/
+uint16_t rxPosition(void)
+{
+	return rxTaken + (uint8_t)(rxHead - rxTail);
 }
 /* -----------------------------------------------------
 bool packageReceived(void)
@@ -90,102 +176,311 @@ received yet. It returns true whenever it is received.
 bool packageReceived(void)
 {
 	//USART_Init(64);
-    while(!receivePackage());
+	while(!receivePackage());
 	return true;
 }
 /* -----------------------------------------------------
-bool receivePackage(void)
-Main module function that after getting flag packageArrival
-starts to store arrived data in dataArrived array and look
-for consecutive bytes to be stop char 1 and stop char 2.
-As latter happens it sets a flag packageArrived and the 
-proceeds to interpret data according to a following format:
+void rejectPackage(int reason, char byte)
+Drops package that is being parsed, counts it and stores
+reason to _status. If the byte that broke package is stop
+char 2, it could be the beginning of a new package.
+-----------------------------------------------------*/
+void rejectPackage(int reason, char byte)
+{
+	rxFramesRejected++;
+	_status = reason;
+	rxState = (byte == STOP_CHAR2) ? rxStart : rxIdle;
+	rxFirstByte = rxTaken - 1;
+}
+/* -----------------------------------------------------
+bool parseByte(char byte)
+Package parser state machine that takes one byte at a time.
+Package format is:
 *-02012400011001-* 
-Where 2 first bytes are stop chars 1 and 2,
+Where 2 first bytes are stop chars 2 and 1,
 next 2 bytes are destination, then 2 bytes are source, then
-2 bytes are command, then 4 bytes are data lenght, next undefined
-number of bytes are actual data, 3 bytes for check sum and 2
-for stop chars 1 and 2.
-The interpreted data is stored in external and global 
+2 bytes are command, then 4 bytes are data lenght, next dl
+number of bytes are actual data, 4 bytes for check sum (CRC-16
+of header and data as hex digits, or legacy 3 bytes "00" and xor)
+and 2 for stop chars 1 and 2.
+In binary mode (binaryMode is set after StartSession) format is:
+*-(source)(destination)(command)(sequence)(lenght)(data)(CRC-16)-*
+where source, destination, command and sequence are single
+bytes (reply carries sequence of the request), lenght
+is varint (7 bits per byte, least significant first, top bit
+set if more bytes follow) and CRC-16 is two bytes, most
+significant first. Data is found by lenght, not by stop chars.
+Header fields are decoded while digits arrive, data lenght is
+checked against frameBuffer size as soon as it is known and
+check sum is updated with every byte, so broken package is
+rejected at the first wrong byte. Returns true when the last
+stop char of a package arrives. If check sum did not match,
+package is complete but corrupted, _status is RX_ERR_CHECKSUM
+then, so the caller could ask server to repeat it.
+-----------------------------------------------------*/
+bool parseByte(char byte)
+{
+	static int field = 0;
+	static int count = 0;
+	static bool binaryFrame = false;
+	static uint16_t crc = CRC16_INIT;
+	static uint16_t crcArrived = 0;
+#if !PACKET_CRC16
+	static char xor = 0;
+#endif
+	
+	switch (rxState)
+	{
+		case rxIdle:
+		if (byte == STOP_CHAR2)
+		{
+			rxState = rxStart;
+			rxFirstByte = rxTaken - 1;
+		}
+		break;
+		
+		case rxStart:
+		if (byte == STOP_CHAR1)
+		{
+			binaryFrame = binaryMode;
+			rxState = binaryFrame ? rxBinHeader : rxHeader;
+			rxCorrupted = false;
+			count = 0;
+			field = 0;
+			crc = CRC16_INIT;
+			crcArrived = 0;
+#if !PACKET_CRC16
+			xor = 0;
+#endif
+		}
+		else if (byte != STOP_CHAR2)
+		{
+			rxState = rxIdle;
+		}
+		break;
+		
+		case rxHeader:
+		if ((byte < '0') || (byte > '9'))
+		{
+			rejectPackage(RX_ERR_FORMAT, byte);
+			break;
+		}
+		frameBuffer[count++] = byte;
+		crc = crc16Update(crc, byte);
+#if !PACKET_CRC16
+		xor ^= byte;
+#endif
+		field = field * 10 + (byte - '0');
+		
+		if (count == 2)
+		{
+			rxSource = field;
+			field = 0;
+		}
+		else if (count == 4)
+		{
+			rxDestination = field;
+			field = 0;
+		}
+		else if (count == 6)
+		{
+			rxCommand = field;
+			field = 0;
+		}
+		else if (count == FRAME_HEADER_LEN)
+		{
+			if (field > FRAME_DATA_MAX)
+			{
+				rejectPackage(RX_ERR_LENGTH, byte);
+				break;
+			}
+			rxLength = field;
+			rxState = (rxLength == 0) ? rxChecksum : rxData;
+		}
+		break;
+		
+		case rxBinHeader:
+		frameBuffer[count++] = byte;
+		crc = crc16Update(crc, byte);
+		if (count == 1)
+		{
+			rxSource = (uint8_t)byte;
+		}
+		else if (count == 2)
+		{
+			rxDestination = (uint8_t)byte;
+		}
+		else if (count == 3)
+		{
+			rxCommand = (uint8_t)byte;
+		}
+		else
+		{
+			rxSequence = (uint8_t)byte;
+			rxState = rxBinLength;
+		}
+		break;
+		
+		case rxBinLength: //varint, 7 bits per byte, least significant first
+		crc = crc16Update(crc, byte);
+		field |= ((uint8_t)byte & 0x7F) << (7 * (count - 4));
+		count++;
+		if ((uint8_t)byte & 0x80)
+		{
+			if (count == 6)
+			{
+				rejectPackage(RX_ERR_LENGTH, byte);
+			}
+			break;
+		}
+		if (field > FRAME_DATA_MAX)
+		{
+			rejectPackage(RX_ERR_LENGTH, byte);
+			break;
+		}
+		rxLength = field;
+		count = FRAME_HEADER_LEN;
+		rxState = (rxLength == 0) ? rxBinChecksum : rxData;
+		break;
+		
+		case rxData:
+		frameBuffer[count++] = byte;
+		crc = crc16Update(crc, byte);
+#if !PACKET_CRC16
+		xor ^= byte;
+#endif
+		if (count == FRAME_HEADER_LEN + rxLength)
+		{
+			rxState = binaryFrame ? rxBinChecksum : rxChecksum;
+		}
+		break;
+		
+		case rxBinChecksum: //CRC-16, most significant byte first
+		crcArrived = (crcArrived << 8) | (uint8_t)byte;
+		count++;
+		if (count == FRAME_HEADER_LEN + rxLength + 2)
+		{
+			rxState = (crcArrived == crc) ? rxStop1 : rxBadStop1;
+		}
+		break;
+		
+		case rxChecksum:
+		frameBuffer[count++] = byte;
+#if PACKET_CRC16
+		if ((byte >= '0') && (byte <= '9'))
+		{
+			crcArrived = (crcArrived << 4) | (byte - '0');
+		}
+		else if ((byte >= 'A') && (byte <= 'F'))
+		{
+			crcArrived = (crcArrived << 4) | (byte - 'A' + 10);
+		}
+		else
+		{
+			rejectPackage(RX_ERR_FORMAT, byte);
+			break;
+		}
+		if (count == FRAME_HEADER_LEN + rxLength + CHECKSUM_LEN)
+		{
+			rxState = (crcArrived == crc) ? rxStop1 : rxBadStop1;
+		}
+#else
+		if (count == FRAME_HEADER_LEN + rxLength + CHECKSUM_LEN)
+		{
+			rxState = (byte == xor) ? rxStop1 : rxBadStop1;
+		}
+#endif
+		break;
+		
+		case rxBadStop1:
+		if (byte != STOP_CHAR1)
+		{
+			rejectPackage(RX_ERR_FORMAT, byte);
+			break;
+		}
+		rxState = rxBadStop2;
+		break;
+		
+		case rxBadStop2:
+		if (byte != STOP_CHAR2)
+		{
+			rejectPackage(RX_ERR_FORMAT, byte);
+			break;
+		}
+		rejectPackage(RX_ERR_CHECKSUM, byte);
+		rxState = rxIdle;
+		rxCorrupted = true;
+		return true;
+		
+		case rxStop1:
+		if (byte != STOP_CHAR1)
+		{
+			rejectPackage(RX_ERR_FORMAT, byte);
+			break;
+		}
+		rxState = rxStop2;
+		break;
+		
+		case rxStop2:
+		if (byte != STOP_CHAR2)
+		{
+			rejectPackage(RX_ERR_FORMAT, byte);
+			break;
+		}
+		rxState = rxIdle;
+		return true;
+		
+		default:
+		rxState = rxIdle;
+		break;
+	}
+	return false;
+}
+/* -----------------------------------------------------
+bool receivePackage(void)
+Main module function that drains receive ring through
+package parser. As soon as a valid package is complete,
+the decoded fields are published in external and global
 variables:
 extern int dl;
-extern char actualData[100];
+extern char *const actualData;
 extern int _source;
 extern int _destination;
 extern int _command;
+extern uint8_t _sequence;
+extern uint16_t _first;
+actualData points to data inside frameBuffer, it is null
+terminated in place of the first check sum byte, so it
+could be used as a string. Values are valid until next
+call of receivePackage(). Package with wrong check sum is
+returned as well, with _command 0 and _status set to
+RX_ERR_CHECKSUM.
 -----------------------------------------------------*/
 bool receivePackage(void){
 	
-static char prevByte = 0;
-static char currByte = 0;
-static int countBits = 0;
+char arrivedByte;
 
-	if ((packageArrival) && (!packageArrived))
+	while (rxRingGet(&arrivedByte))
 	{
-		
-		packageArrival = false;
-		
-		prevByte = currByte;
-		currByte = arrivedByte;
-		
-		if ((prevByte == STOP_CHAR1) && (currByte == STOP_CHAR2)) //The end of package is detected and flag packageArrived is set
+		if (parseByte(arrivedByte))
 		{
-			packageArrived = true;
-			dataArrived[countBits++] = '\0';
-			countBits = 0;
-			prevByte = 0;
-			currByte = 0;
-			datastart = false;
-		}else{
-			packageArrived = false;
+			if (rxCorrupted) //corrupted package, nothing is to be interpreted
+			{
+				dl = 0;
+				_command = 0;
+				frameBuffer[FRAME_HEADER_LEN] = '\0';
+				return true;
+			}
+			frameBuffer[FRAME_HEADER_LEN + rxLength] = '\0';
+			dl = rxLength;
+			_source = rxSource;
+			_destination = rxDestination;
+			_command = rxCommand;
+			_sequence = rxSequence;
+			_first = rxFirstByte;
+			_status = RX_OK;
+			return true;
 		}
-
-		dataArrived[countBits++] = currByte;		
-	}
-	
-	if ((!packageArrival) && packageArrived) //package data interpretation
-	{
-		_source = 0;
-		_destination = 0;
-		_command = 0;
-		//set a null terminators so the arrays later could be interpreted as a string
-		memset(source, '\0', 3);
-		memset(destination, '\0', 3);
-		memset(command, '\0', 3);
-		memset(dataLenght, '\0', 5);
-		memset(actualData, '\0', 100);
-		memset(checksum, '\0', 4);
-		
-		//copy package contents to package fields
-		memcpy(source, dataArrived, 2);
-		memcpy(destination, dataArrived + 2, 2);
-		memcpy(command, dataArrived + 4, 2);
-		memcpy(dataLenght, dataArrived + 6, 4);
-				
-		//count data bytes and copy data to package data field
-		dl = atoi(dataLenght);
-				
-		memcpy(actualData, dataArrived + 10, dl);
-		memcpy(checksum, dataArrived + (10 + dl), 3);
-		
-//  		putString("Data lenght: \n");
-//  		putString(dataLenght);
-//  		usart_transmit('\n');
-//  		putString("Data: \n");
-//  		putString(actualData);
-//  		usart_transmit('\n');
-//  		putString("CheckSum: \n");
-//  		putString(checksum);
-//  		usart_transmit('\n');
-// 			putString(command);
-		_source = atoi(source);
-		_destination = atoi(destination);
-		_command = atoi(command);
-		packageArrived = false;
-		packageArrival = false;
-		memset(dataArrived, '\0', 100);
-		countBits = 0;
-		return true;
 	}
 	return false;
 }
@@ -1,12 +1,27 @@
 #include <avr/io.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
 
+/* _status values */
+#define RX_OK 0
+#define RX_ERR_FORMAT 1
+#define RX_ERR_LENGTH 2
+#define RX_ERR_CHECKSUM 3
+
 extern int dl;
-extern char actualData[100];
+extern char *const actualData;
 extern int _source;
 extern int _destination;
 extern int _command;
+extern uint8_t _sequence;
+extern uint16_t _first;
+extern int _status;
+extern uint16_t rxFramesRejected;
+extern volatile uint16_t rxOverruns;
+extern volatile uint16_t rxHwOverruns;
 
-extern bool packageReceived(void);
\ No newline at end of file
+extern bool packageReceived(void);
+extern bool receivePackage(void);
+extern uint16_t rxPosition(void);
\ No newline at end of file
@@ -0,0 +1,177 @@
+/*---------------------------------------------------------
+Purpose: The purpose of this module is to sample voltage and
+current channels in the background at fixed rate, so that
+main loop does not start conversions and wait for them.
+
+Input: void adcStart(void)
+ADC is set to auto trigger on timer 1 compare match B.
+Timer 1 runs in CTC mode with 1 ms period (see driverTimer.c,
+init_timer1 has to be called first), OCR1B puts the trigger
+in the middle of the period, away from the ms tick interrupt.
+Compare B interrupt counts ticks and lets only every
+ADC_SAMPLE_DIVIDER-th compare start conversion (by switching
+ADATE), so the rate is ADC_SAMPLE_HZ frames.
+A frame is one conversion of every channel of the scan list
+(ADC0 voltage, ADC1 current). Trigger converts the first one,
+ADC complete interrupt switches ADMUX to the next channel and
+starts it right away, so channels of a frame are 166 us apart.
+
+Output: ADC complete interrupt puts results to a ring of
+ADC_RING_SIZE samples, interleaved in scan list order
+(ADC_VOLTAGE, ADC_CURRENT). Frame is made visible only when
+its last channel is done. uint8_t adcRead(uint16_t *samples,
+uint8_t max) takes up to max oldest samples out of it and
+returns how many were taken, max has to be multiple of
+ADC_CHANNELS. If the ring has no room for a frame, whole frame
+is dropped and adcOverruns is counted.
+
+Uses: usual avr libraries such as io.h and interrupt.h.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "driverADC.h"
+
+#define ADC_RING_MASK (ADC_RING_SIZE - 1)
+/* Compare B in the middle of 1250 count timer 1 period */
+#define ADC_TRIGGER_COUNT 624
+/* Timer 1 compare match B as auto trigger source */
+#define ADC_TRIGGER_SOURCE ((1<<ADTS2) | (1<<ADTS0))
+/* Multiplexer inputs */
+#define ADC_MUX_VOLTAGE 0
+#define ADC_MUX_CURRENT 1
+
+/* ADMUX of every position in a frame, AVCC reference */
+const uint8_t adcScanList[ADC_CHANNELS] PROGMEM = {
+	(1<<REFS0) | ADC_MUX_VOLTAGE,
+	(1<<REFS0) | ADC_MUX_CURRENT
+};
+
+volatile uint16_t adcRing[ADC_RING_SIZE];
+volatile uint8_t adcHead = 0;
+volatile uint8_t adcTail = 0;
+volatile uint8_t adcOverruns = 0;
+volatile uint8_t adcDivider = 0;
+volatile uint8_t adcScanIndex = 0;
+volatile bool adcFrameDropped = false;
+/* -----------------------------------------------------
+void adcStart(void)
+Empties the ring, selects first channel of scan list, ADC
+clock 10 MHz / 128 (78 kHz, 166 us conversion) and turns
+on triggered conversions and their interrupts.
+-----------------------------------------------------*/
+void adcStart(void){
+	
+	uint8_t sreg = SREG;
+	
+	cli();
+	adcHead = 0;
+	adcTail = 0;
+	adcDivider = 0;
+	adcScanIndex = 0;
+	adcFrameDropped = false;
+	ADMUX = pgm_read_byte(&adcScanList[0]);
+	OCR1B = ADC_TRIGGER_COUNT;
+	SFIOR = (SFIOR & ~((1<<ADTS2) | (1<<ADTS1) | (1<<ADTS0))) | ADC_TRIGGER_SOURCE;
+	ADCSRA = (1<<ADEN) | (1<<ADIE) | (1<<ADPS2) | (1<<ADPS1) | (1<<ADPS0) | ((ADC_SAMPLE_DIVIDER == 1) ? (1<<ADATE) : 0);
+	TIFR = (1<<OCF1B);
+	TIMSK |= (1<<OCIE1B);
+	SREG = sreg;
+}
+/* -----------------------------------------------------
+void adcStop(void)
+Turns off ADC and its trigger.
+-----------------------------------------------------*/
+void adcStop(void){
+	
+	TIMSK &= ~(1<<OCIE1B);
+	ADCSRA = 0;
+}
+/* -----------------------------------------------------
+uint8_t adcRead(uint16_t *samples, uint8_t max)
+Copies up to max samples from the ring, oldest first.
+Head is written by interrupt only, so it is read once. It
+moves a frame at a time, so only whole frames are copied.
+-----------------------------------------------------*/
+uint8_t adcRead(uint16_t *samples, uint8_t max){
+	
+	uint8_t head = adcHead;
+	uint8_t n = 0;
+	
+	while ((adcTail != head) && (n < max))
+	{
+		samples[n++] = adcRing[adcTail & ADC_RING_MASK];
+		adcTail++;
+	}
+	return n;
+}
+/* -----------------------------------------------------
+ISR(TIMER1_COMPB_vect)
+Executing it clears compare B flag, so the next compare
+gives a new trigger edge. Auto trigger is on only for the
+compare that is to be sampled. ADIF is written as 0 so
+pending conversion interrupt is not cleared.
+-----------------------------------------------------*/
+ISR(TIMER1_COMPB_vect)
+{
+	if (++adcDivider >= ADC_SAMPLE_DIVIDER)
+	{
+		adcDivider = 0;
+	}
+	if (adcDivider == ADC_SAMPLE_DIVIDER - 1)
+	{
+		ADCSRA = (ADCSRA & ~(1<<ADIF)) | (1<<ADATE);
+	}
+	else
+	{
+		ADCSRA = ADCSRA & ~((1<<ADIF) | (1<<ADATE));
+	}
+}
+/* -----------------------------------------------------
+ISR(ADC_vect)
+Conversion is complete, puts result to its place in the
+frame and selects the next channel. Within a frame next
+conversion is started at once, after the last one ADMUX is
+left at the first channel for the next trigger. ADIF is
+written as 0, it was cleared when interrupt was entered.
+-----------------------------------------------------*/
+ISR(ADC_vect)
+{
+	uint16_t sample = ADCW;
+	uint8_t index = adcScanIndex;
+	
+	if (index == 0)
+	{
+		adcFrameDropped = (uint8_t)(adcHead - adcTail) > ADC_RING_SIZE - ADC_CHANNELS;
+		if (adcFrameDropped)
+		{
+			adcOverruns++;
+		}
+	}
+	if (!adcFrameDropped)
+	{
+		adcRing[(uint8_t)(adcHead + index) & ADC_RING_MASK] = sample;
+	}
+	if (++index < ADC_CHANNELS)
+	{
+		ADMUX = pgm_read_byte(&adcScanList[index]);
+		ADCSRA = (ADCSRA & ~(1<<ADIF)) | (1<<ADSC);
+	}
+	else
+	{
+		index = 0;
+		ADMUX = pgm_read_byte(&adcScanList[0]);
+		if (!adcFrameDropped)
+		{
+			adcHead += ADC_CHANNELS;
+		}
+	}
+	adcScanIndex = index;
+}
\ No newline at end of file
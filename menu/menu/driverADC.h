@@ -0,0 +1,20 @@
+#include <avr/io.h>
+#include <stdint.h>
+
+/* Timer 1 tick (1 ms) triggers conversions, every
+ADC_SAMPLE_DIVIDER-th tick a frame is sampled */
+#define ADC_SAMPLE_DIVIDER 1
+#define ADC_SAMPLE_HZ (1000 / ADC_SAMPLE_DIVIDER)
+/* Scan list, positions of the channels in a frame */
+#define ADC_VOLTAGE 0
+#define ADC_CURRENT 1
+#define ADC_CHANNELS 2
+/* Samples that wait for metering task, power of two and
+whole frames */
+#define ADC_RING_SIZE 32
+
+extern volatile uint8_t adcOverruns;
+
+extern void adcStart(void);
+extern void adcStop(void);
+extern uint8_t adcRead(uint16_t *samples, uint8_t max);
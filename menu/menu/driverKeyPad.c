@@ -4,12 +4,19 @@ correctly interpret values of decoder and encoder.
 
 Input: Input comes from decoder cd4532b and encoder cd4028b.
 
-Output: Function scanKeyPad() scans a keypad and 
-returns 1 if any key is pressed.
-Function returnKey() returns a ASCII value of 
-corresponding key that was recently pressed.
+Output: Keypad is scanned by keypad_tick(), that timer 1
+compare A interrupt calls every ms, so keys are not missed
+while main program writes to LCD or waits for USART.
+Debouncing counts ticks of stable reading, nothing waits.
+Decoded keys (ASCII) go to a FIFO of EVENT_QUEUE_SIZE keys.
+Function keypad_get(uint16_t timeoutMs) takes the oldest key
+out of it, waiting up to timeoutMs (KEYPAD_NO_WAIT or
+KEYPAD_FOREVER), returns KEYPAD_NO_KEY if there was none.
+Function scanKeyPad() returns 1 if a key was taken out of
+FIFO and function returnKey() returns its ASCII value, they
+are kept for polling loops.
 
-Uses: Self-sufficent
+Uses: driverTimer, eventQueue
 
 Author: Ultra 2000
 Company: DTU Dipom
@@ -23,13 +30,24 @@ Date and year: 2014/05/26
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "driverTimer.h"
+#include "eventQueue.h"
+#include "driverKeyPad.h"
+
+/* Ticks (ms) that reading has to stay the same, release
+ends when pressed bit has been quiet that long */
+#define PRESS_DEBOUNCE_MS 4
+#define RELEASE_DEBOUNCE_MS 5
 
 int count;
-int keyfound;
 char key;
 char temp;
+uint8_t stableTicks;
+volatile bool keypadScanning = false;
+eventQueue keyEvents;
 
-enum{idle, keyPresses, debounce, getKey, waitRelease, releasedDebounce,released}state1;
+enum{idle, debounce, waitRelease}state1;
 
 char key_table[4][4]=  
 {{'1','2','3','F'},
@@ -92,86 +110,114 @@ char findKey(int row, char temp){
 	
 }
 /* -----------------------------------------------------
-bool delay(char ms)
-This function was written because the use of timers was
-not reliable for constant use in main routine. It returns
-a true whenever _delay_ms(1) was executed ms number of
-times. 
+void keypad_tick()
+This function is a little and nice state machine that uses
+functions above, it is called from timer interrupt every ms
+and does one step. It has three states:
+idle - checks the row that was set on previous tick, if no
+key is pressed, sets the next row,
+debounce - reading has to stay the same for
+PRESS_DEBOUNCE_MS ticks, then ASCII value is looked up and
+put to FIFO (unless code is unknown), if key is let go
+before, scanning goes on,
+waitRelease - pressed bit has to stay low for
+RELEASE_DEBOUNCE_MS ticks, then scanning starts from row 1.
 -----------------------------------------------------*/
-bool delay(char ms)
-{
-	int i;
-	for (i=0;i<ms;i++)
+void keypad_tick(){
+	
+	char raw;
+	
+	if (!keypadScanning)
 	{
-		_delay_ms(1);
+		return;
 	}
-	return true;
-}
-/* -----------------------------------------------------
-char scanKeyPad()
-This function that is a little and nice state machine that
-implements the use of functions above. It has a number of states:
-idle, keyPresses, debounce, getKey, waitRelease, 
-releasedDebounce,released. All of them are explained above. 
-In short, it sets the row, checks if there was a key press,
-if yes, waits for debounce and looks up for ASCII value, else
-sets another row and continues routine. Returns a 1 after
-key press was detected, encoded and ASCII value found.
-ASCII value is stored in global value key.
------------------------------------------------------*/
-char scanKeyPad(){
-	
+	raw = RawKeyPressed();
 	switch(state1)
 	{
 		case idle:
-		if(keyfound==1)
+		if ((raw&0x02)==(0x02))
 		{
-			keyfound=0;
-		} if (count==5)
-		{ 
-			count=1; 
-			setRow(count);
-		} if ((RawKeyPressed()&0x02)==(0x02)) 
-		{ 
-			state1=keyPresses;
+			temp=raw;
+			stableTicks=0;
+			state1=debounce;
 		} else {
-			state1=idle; 
-			count++; 
+			if (++count==5)
+			{
+				count=1;
+			}
 			setRow(count);
 		} break;
 		
-		case keyPresses: 
-		temp=RawKeyPressed(); 
-		state1=debounce; 
-		break;
-		
-		case debounce: 
-		if((delay(10)) && (temp==RawKeyPressed()))
-		{ 
-			state1=getKey; 
-		}else { 
-			state1=debounce;
-		}  break;
-		
-		case getKey:state1=waitRelease; key=findKey(count,temp); keyfound=1; break;
-
-		case waitRelease: if(keyfound==1){keyfound=0;} if ((RawKeyPressed()&0x02)==(0x02)){state1=releasedDebounce;} else {state1=released;} break;
-		
-		case releasedDebounce: 
-		if((delay(35)) && (RawKeyPressed()==0b0000000))
+		case debounce:
+		if ((raw&0x02)!=(0x02))
 		{
-			state1=released;
-		} else {
-			state1=releasedDebounce;
+			state1=idle;
+		} else if (raw!=temp)
+		{
+			temp=raw;
+			stableTicks=0;
+		} else if (++stableTicks>=PRESS_DEBOUNCE_MS)
+		{
+			char found=findKey(count,temp);
+			if (found!=KEYPAD_NO_KEY)
+			{
+				eventPost(&keyEvents, found);
+			}
+			stableTicks=0;
+			state1=waitRelease;
 		} break;
 		
-		case released: state1=idle; count=1; break;
+		case waitRelease:
+		if ((raw&0x02)==(0x02))
+		{
+			stableTicks=0;
+		} else if (++stableTicks>=RELEASE_DEBOUNCE_MS)
+		{
+			count=1;
+			setRow(count);
+			state1=idle;
+		} break;
 		
 		default:state1=idle; break;
 	}
+}
+/* -----------------------------------------------------
+char keypad_get(uint16_t timeoutMs)
+Takes the oldest key out of FIFO. If there is none, waits
+for it up to timeoutMs, KEYPAD_NO_WAIT returns at once and
+KEYPAD_FOREVER waits as long as it takes. Returns ASCII
+value of the key or KEYPAD_NO_KEY.
+-----------------------------------------------------*/
+char keypad_get(uint16_t timeoutMs)
+{
+	uint8_t event;
+	uint16_t start = getTick();
 	
-
-	return keyfound;
+	do
+	{
+		if (eventGet(&keyEvents, &event))
+		{
+			return (char)event;
+		}
+	} while ((timeoutMs == KEYPAD_FOREVER) || ((uint16_t)(getTick() - start) < timeoutMs));
+	return KEYPAD_NO_KEY;
+}
+/* -----------------------------------------------------
+char scanKeyPad()
+Polling wrapper of keypad_get(), takes a key out of FIFO
+without waiting. Returns a 1 if there was one, its ASCII
+value is stored in global value key.
+-----------------------------------------------------*/
+char scanKeyPad(){
+	
+	char got = keypad_get(KEYPAD_NO_WAIT);
+	
+	if (got == KEYPAD_NO_KEY)
+	{
+		return 0;
+	}
+	key = got;
+	return 1;
 }
 /* -----------------------------------------------------
 char returnKey()
@@ -185,12 +231,17 @@ char returnKey()
 /* -----------------------------------------------------
 void keypad_init()
 Function that sets initial values for keypad scanning
-mechanism.
+mechanism, empties FIFO and lets timer interrupt scan.
 -----------------------------------------------------*/
 void keypad_init()
 {	 
 	 DDRC |= 1 << PINC6;
 	 DDRC |= 1 << PINC7;
 
+	 keypadScanning = false;
 	 state1=idle;
+	 count=1;
+	 setRow(count);
+	 eventQueueClear(&keyEvents);
+	 keypadScanning = true;
 }
@@ -1,3 +1,12 @@
+#include <stdint.h>
+
+/* keypad_get() timeouts and its result when no key came */
+#define KEYPAD_NO_WAIT 0
+#define KEYPAD_FOREVER 0xFFFF
+#define KEYPAD_NO_KEY 0
+
 extern void keypad_init();
+extern void keypad_tick();
+extern char keypad_get(uint16_t timeoutMs);
 extern char scanKeyPad();
 extern char returnKey();
\ No newline at end of file
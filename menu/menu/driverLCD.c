@@ -7,6 +7,20 @@ as this project mostly writes to LCD and does not read.
 
 Output: See the specific outputs of specific functions
 
+Drawing functions (GoTo, LCDPutString, LCDPutString_P,
+LCDPutChar, lcdClear, clearLine) do not talk to the display, they write to 80 byte
+shadow buffer lcdShadow and mark changed cells dirty. lcdFlush()
+sends only dirty cells to the display, following DDRAM order
+(line 0, 2, 1, 3) so that address commands are needed only
+where unchanged cells are skipped.
+
+After lcd_init, lcd_cmd_write and lcd_data_write do not wait
+for the display either: they put the byte to LCD queue and timer 2
+compare interrupt sends it, one nibble every 50 us, so LCD bus
+time overlaps with whatever main loop does. lcdWaitIdle() waits
+until everything queued is on the display. During lcd_init bytes
+are sent directly, as before.
+
 Uses: uses it's header file for stored and defined values
 
 Author: Ole Shultz, edited by Ultra 2000
@@ -17,7 +31,10 @@ Date and year: 2014/05/26
 
 #include <avr/io.h>    
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 #include <stdio.h> 
+#include <string.h>
+#include <stdbool.h>
 
 
 #include "driverLCD.h"  // File with #define statements and prototypes for the lcdm.c module
@@ -41,6 +58,34 @@ unsigned char lcd_x=0;
 unsigned char lcd_y=0;
 unsigned char lcd_maxx=16;
 
+/* What should be on display, cell is line * LCD_COLUMNS + x */
+char lcdShadow[LCD_CELLS];
+/* One bit for every cell that differs from what display got */
+unsigned char lcdDirty[LCD_CELLS / 8];
+/* DDRAM address where next char is drawn to shadow */
+unsigned char lcdCursor = 0;
+/* DDRAM address of display itself, it increments after data */
+unsigned char lcdAddress = LCD_ADDRESS_UNKNOWN;
+
+/* Clear command with its 1.6 ms busy wait costs about as much
+as this number of cell writes (two 50 us ticks each) */
+#define LCD_CLEAR_COST 17
+
+/* LCD queue, bytes and their RS bit, drained by timer 2 */
+#define LCD_QUEUE_SIZE 32
+#define LCD_QUEUE_MASK (LCD_QUEUE_SIZE - 1)
+/* Timer 2 ticks (50 us) to wait after clear or home command */
+#define LCD_HOME_TICKS 32
+
+volatile unsigned char lcdQueueByte[LCD_QUEUE_SIZE];
+volatile unsigned char lcdQueueRS[LCD_QUEUE_SIZE];
+volatile unsigned char lcdQueueHead = 0;
+volatile unsigned char lcdQueueTail = 0;
+volatile unsigned char lcdBusyTicks = 0;
+bool lcdAsync = false;
+
+const unsigned char lineAddress[LCD_LINES] = {line_0, line_1, line_2, line_3};
+
 
 //*******************************************************************
 // LCD initialization sequence (works somewhat like a constructor)
@@ -49,6 +94,12 @@ unsigned char lcd_maxx=16;
 void lcd_init()    // Works like a constructor
    
    {
+   //finish queued bytes and send directly until init is done
+   if (lcdAsync)
+   {
+      lcdWaitIdle();
+      lcdAsync = false;
+   }
 
    // Power on delay
 	lcd_direction |= 0xfc;							//	set port a as output
@@ -92,6 +143,18 @@ _delay_ms(2);
   createCustomFont();
  _delay_ms(2);
  lcd_cmd_write(RTN_HOME);
+ _delay_ms(2);
+ 
+ //from now on bytes go through queue
+ TCCR2 = (1<<WGM21)|(1<<CS21);		//CTC, prescaling by 8 - 1250000 Hz
+ OCR2 = 62;							//63 counts gives 50.4 us
+ lcdAsync = true;
+ 
+ //display is clear, so is shadow
+ memset(lcdShadow, ' ', LCD_CELLS);
+ memset(lcdDirty, 0, LCD_CELLS / 8);
+ lcdCursor = 0;
+ lcdAddress = LCD_ADDRESS_UNKNOWN;
    } // end lcd_init()
 /* -----------------------------------------------------
 void createCustomFont()
@@ -180,6 +243,11 @@ void createCustomFont(){
 
 void lcd_cmd_write(unsigned char cmd)
    { 
+    if (lcdAsync)
+    {
+        lcdEnqueue(0, cmd);
+        return;
+    }
     lcd_direction |= 0xfc;
 	lcd_port &= ~(1<<lcd_RS);
 
@@ -191,6 +259,11 @@ void lcd_cmd_write(unsigned char cmd)
 
 void lcd_data_write(unsigned char d)
 {
+   if (lcdAsync)
+   {
+      lcdEnqueue(1, d);
+      return;
+   }
    lcd_direction |= 0xfc;
    lcd_port|=(1<<lcd_RS);				//rs=1 when writing data
    
@@ -202,6 +275,89 @@ void lcd_data_write(unsigned char d)
 } 
 
 
+//********************************************************************************************
+// Queue of bytes to display, drained by timer 2 interrupt
+
+/* -----------------------------------------------------
+void lcdEnqueue(unsigned char rs, unsigned char d)
+Puts byte to LCD queue, rs is 1 for data and 0 for command.
+If queue is full, waits for interrupt to make room. Then
+turns on timer 2 compare interrupt.
+-----------------------------------------------------*/
+void lcdEnqueue(unsigned char rs, unsigned char d)
+{
+	while ((unsigned char)(lcdQueueHead - lcdQueueTail) >= LCD_QUEUE_SIZE);
+	
+	lcdQueueByte[lcdQueueHead & LCD_QUEUE_MASK] = d;
+	lcdQueueRS[lcdQueueHead & LCD_QUEUE_MASK] = rs;
+	lcdQueueHead++;
+	
+	unsigned char sreg = SREG;
+	cli();
+	TIMSK |= (1<<OCIE2);
+	SREG = sreg;
+}
+/* -----------------------------------------------------
+void lcdWaitIdle(void)
+Waits until all queued bytes are on display, including
+wait after clear or home command.
+-----------------------------------------------------*/
+void lcdWaitIdle(void)
+{
+	while ((lcdQueueHead != lcdQueueTail) || (lcdBusyTicks != 0));
+}
+/* -----------------------------------------------------
+ISR(TIMER2_COMP_vect)
+Every 50 us sends one nibble of the oldest queued byte, high
+one first. 50 us between nibbles covers 37 us the display
+needs for a byte, clear and home commands are followed by
+LCD_HOME_TICKS of waiting. When queue is empty, interrupt
+turns itself off.
+-----------------------------------------------------*/
+ISR(TIMER2_COMP_vect)
+{
+	static bool lowNibble = false;
+	
+	if (lcdBusyTicks != 0)
+	{
+		lcdBusyTicks--;
+		return;
+	}
+	if (lcdQueueHead == lcdQueueTail)
+	{
+		TIMSK &= ~(1<<OCIE2);
+		return;
+	}
+	
+	unsigned char i = lcdQueueTail & LCD_QUEUE_MASK;
+	unsigned char d = lcdQueueByte[i];
+	
+	if (lcdQueueRS[i])
+	{
+		lcd_port |= (1<<lcd_RS);
+	}else{
+		lcd_port &= ~(1<<lcd_RS);
+	}
+	lcd_port |= (1<<lcd_E);
+	lcd_port = (lcd_port & 0x0f) | ((lowNibble ? (d<<4) : d) & 0xf0);
+	asm volatile("NOP");   // E pulse at least 230 nS
+	asm volatile("NOP");
+	asm volatile("NOP");
+	lcd_port &= ~(1<<lcd_E);
+	
+	if (!lowNibble)
+	{
+		lowNibble = true;
+		return;
+	}
+	lowNibble = false;
+	lcdQueueTail++;
+	if (!lcdQueueRS[i] && (d <= (CLR_DISPLAY|RTN_HOME)))
+	{
+		lcdBusyTicks = LCD_HOME_TICKS;					//clear or home
+	}
+}
+
 //********************************************************************************************
 // Low level functions
 // Write to the lcd data bus - generate E pulse 
@@ -233,12 +389,65 @@ void lcd_nibble_transfer( unsigned char d )
 	_delay_us(60);
    } 
 
-//clear the display
+/* -----------------------------------------------------
+unsigned char lcdCell(unsigned char address)
+Returns shadow cell of DDRAM address or LCD_CELLS if the
+address is not visible (0x28 - 0x3F and above 0x67).
+-----------------------------------------------------*/
+unsigned char lcdCell(unsigned char address){
+	
+	if (address < line_2)
+	{
+		return address;									//line 0
+	}
+	if (address < line_2 + LCD_COLUMNS)
+	{
+		return 2 * LCD_COLUMNS + (address - line_2);
+	}
+	if ((address >= line_1) && (address < line_1 + LCD_COLUMNS))
+	{
+		return LCD_COLUMNS + (address - line_1);
+	}
+	if ((address >= line_3) && (address < line_3 + LCD_COLUMNS))
+	{
+		return 3 * LCD_COLUMNS + (address - line_3);
+	}
+	return LCD_CELLS;
+}
+/* -----------------------------------------------------
+void LCDPutChar(char c)
+Draws char (or custom char code) to shadow at cursor and
+moves cursor like display does: end of line 0 continues on
+line 2, end of line 2 - on line 1 (after hidden addresses),
+end of line 1 - on line 3.
+-----------------------------------------------------*/
+void LCDPutChar(char c){
+	
+	unsigned char cell = lcdCell(lcdCursor);
+	
+	if ((cell < LCD_CELLS) && (lcdShadow[cell] != c))
+	{
+		lcdShadow[cell] = c;
+		lcdDirty[cell >> 3] |= (1 << (cell & 7));
+	}
+	lcdCursor++;
+	if (lcdCursor == 0x28)
+	{
+		lcdCursor = line_1;
+	}else if (lcdCursor == 0x68)
+	{
+		lcdCursor = line_0;
+	}
+}
+
+//clear the display (shadow), cursor goes home
 void lcdClear(void) {
-	lcd_cmd_write(CLR_DISPLAY);
-	lcd_wait(WAIT_15m);
-	lcd_cmd_write(CLR_DISPLAY+RTN_HOME);
-	lcd_wait(WAIT_15m);
+	lcdCursor = line_0;
+	for (unsigned char cell = 0; cell < LCD_CELLS; cell++)
+	{
+		LCDPutChar(' ');
+	}
+	lcdCursor = line_0;
 }
 
 void clearLine(unsigned char x, unsigned char y){
@@ -248,11 +457,84 @@ void clearLine(unsigned char x, unsigned char y){
 	GoTo(x,y);
 	for (int i=x; i<max_x; i++)
 	{
-		lcd_data_write(0x20);
-		_delay_ms(1);
+		LCDPutChar(' ');
 	}
 	GoTo(x,y);
 }
+/* -----------------------------------------------------
+void lcdFlush(void)
+Sends dirty cells of shadow to display. Cells are walked in
+DDRAM order, so display address increments by itself from one
+dirty cell to the next. When a single clean cell is between
+two dirty ones, it is sent again (same bus time as address
+command), otherwise address command jumps over clean cells.
+If new screen has fewer non blank cells than there are dirty
+ones by more than clear command costs, display is cleared and
+only non blank cells are sent.
+-----------------------------------------------------*/
+void lcdFlush(void){
+	
+	unsigned char dirty = 0;
+	unsigned char nonBlank = 0;
+	
+	for (unsigned char cell = 0; cell < LCD_CELLS; cell++)
+	{
+		if (lcdDirty[cell >> 3] & (1 << (cell & 7)))
+		{
+			dirty++;
+		}
+		if (lcdShadow[cell] != ' ')
+		{
+			nonBlank++;
+		}
+	}
+	if (dirty == 0)
+	{
+		return;
+	}
+	if (nonBlank + LCD_CLEAR_COST < dirty)
+	{
+		lcd_cmd_write(CLR_DISPLAY);						//queue waits 1.53 ms after it
+		lcdAddress = line_0;
+		for (unsigned char cell = 0; cell < LCD_CELLS; cell++)
+		{
+			if (lcdShadow[cell] != ' ')
+			{
+				lcdDirty[cell >> 3] |= (1 << (cell & 7));
+			}else{
+				lcdDirty[cell >> 3] &= ~(1 << (cell & 7));
+			}
+		}
+	}
+	
+	for (unsigned char block = 0; block < 2; block++)
+	{
+		unsigned char base = block ? line_1 : line_0;		//lines 1,3 or 0,2
+		
+		for (unsigned char i = 0; i < 2 * LCD_COLUMNS; i++)
+		{
+			unsigned char address = base + i;
+			unsigned char cell = lcdCell(address);
+			
+			if (!(lcdDirty[cell >> 3] & (1 << (cell & 7))))
+			{
+				continue;
+			}
+			if (lcdAddress != address)
+			{
+				if ((i > 0) && (lcdAddress == address - 1))
+				{
+					lcd_data_write(lcdShadow[lcdCell(address - 1)]);
+				}else{
+					lcd_cmd_write(SET_DRAM_ADDR + address);
+				}
+			}
+			lcd_data_write(lcdShadow[cell]);
+			lcdAddress = (address == line_2 + LCD_COLUMNS - 1) ? line_1 : address + 1;
+			lcdDirty[cell >> 3] &= ~(1 << (cell & 7));
+		}
+	}
+}
 
 // Software function for delay insertion after commands/data tranfers
 
@@ -265,55 +547,49 @@ void lcd_wait(unsigned int count)
 }
 
 
-//! write a zero-terminated ASCII string to the display
+//! write a zero-terminated ASCII string to the display (shadow)
 void LCDPutString(char *str) {
    char c,index=0;
 	for (; (c = *str) != 0; str++){
 	
 		if((c=='\r') || c=='\n');
 		else
-		lcd_data_write(c);
+		LCDPutChar(c);
 
 		index++;
 
 		if (index>=20) {
-			lcd_cmd_write(SET_DRAM_ADDR+line_3);
-			lcd_wait(WAIT_15m);
+			lcdCursor = line_3;
 			index=0;
 		}
 
 	}
 }
 
-//*goto x-position and y-line called by parameters x, y used in main() and internally LCDPutChar()*/
-
-void GoTo(unsigned char x, unsigned char y){
-	switch (y) {
-		case 0: 
+//! write a zero-terminated ASCII string stored in flash to the display (shadow)
+void LCDPutString_P(PGM_P str) {
+   char c,index=0;
+	for (; (c = pgm_read_byte(str)) != 0; str++){
+	
+		if((c=='\r') || c=='\n');
+		else
+		LCDPutChar(c);
 
-		lcd_cmd_write(SET_DRAM_ADDR+x);
-		lcd_wait(WAIT_15m);  
-		break;
+		index++;
 
-		case 1: 
+		if (index>=20) {
+			lcdCursor = line_3;
+			index=0;
+		}
 
-		lcd_cmd_write(SET_DRAM_ADDR+line_1+x);
-		lcd_wait(WAIT_15m);  
-		break;
+	}
+}
 
-		case 2:
-		lcd_cmd_write(SET_DRAM_ADDR+line_2+x);
-		lcd_wait(WAIT_15m);  
-		break;
+//*goto x-position and y-line called by parameters x, y used in main() and internally LCDPutChar()*/
 
-		case 3:
-		lcd_cmd_write(SET_DRAM_ADDR+line_3+x);
-		lcd_wait(WAIT_15m);  
-		break;
-		
-		default:
-		break;
+void GoTo(unsigned char x, unsigned char y){
+	if (y < LCD_LINES)
+	{
+		lcdCursor = lineAddress[y] + x;
 	}
-
 }
-
@@ -1,4 +1,5 @@
 #include <avr/io.h>
+#include <avr/pgmspace.h>
 // Include file for the LCD module 2 x 16    03/03/2005 hkp 29/08/2007 osc
 #define F_CPU 10000000L
 #include <util/delay.h>
@@ -7,6 +8,11 @@
 #define line_2 0x14  // 14-27H
 #define line_3 0x54  // 54-67H
 
+#define LCD_COLUMNS 20
+#define LCD_LINES 4
+#define LCD_CELLS 80
+#define LCD_ADDRESS_UNKNOWN 0xFF
+
 #define SET_DRAM_ADDR   0x80     //0x80 default addr 00 in the DDRAM
 #define DAR_MASK        0x7f
 
@@ -70,7 +76,12 @@ extern void lcdClear();
 extern void lcd_ready();
 extern void lcdWrite(char *s);
 extern void LCDPutString(char *str) ;
+extern void LCDPutString_P(PGM_P str);
 extern void GoTo(unsigned char x, unsigned char y);
 extern void clearLine(unsigned char x, unsigned char y);
 extern void createCustomFont(void);
+extern void LCDPutChar(char c);
+extern void lcdFlush(void);
+extern void lcdEnqueue(unsigned char rs, unsigned char d);
+extern void lcdWaitIdle(void);
  
@@ -12,10 +12,10 @@ cur. St/ Event			nilEvent			cardEvent				cardDatareadyEvent			startTransmitEvent
 
 
 idle				idle, nilAction		commanding,send_command		reading,nilAction			idle,nilAction
-commanding			idle, nilAction		wait_data,nilAction			reading,nilAction			idle,nilAction
-wait_data			idle, nilAction		wait_data,nilAction			reading,nilAction			idle,nilAction
-reading				idle, nilAction		wait_data,nilAction			reading,readBuffer			presenting,nilAction
-presenting			idle, nilAction		wait_RFID_removed,nilAction	reading,nilAction			presenting,transmitString
+commanding			idle, nilAction		wait_data,nilAction			reading,readBuffer			idle,nilAction
+wait_data			idle, nilAction		wait_data,nilAction			reading,readBuffer			idle,nilAction
+reading				idle, nilAction		wait_data,nilAction			reading,readBuffer			presenting,transmitString
+presenting			idle, nilAction		commanding,send_command		reading,nilAction			presenting,transmitString
 wait_RFID_removed	idle, nilAction		wait_RFID_removed,nilAction	wait_RFID_removed,nilAction	wait_RFID_removed,nilAction
 
 Actions
@@ -24,6 +24,15 @@ send_command
 readBuffer
 transmitString
 
+Events are queued (rfidEvents), interrupts post card and data
+ready edges and actions post the next step: cardEvent for the
+next command, nilEvent when done. Every event is dispatched
+once, so every action runs once per edge, and the CPU sleeps
+while the queue is empty. The latest event is kept apart
+(lastRFIDEvent), RFIDinit starts from it with an empty queue,
+so edges that came between calls (even more than the queue
+holds) do not leave a stale event behind.
+
 Input: Input comes RFID reader through SPI serial comm. Also,
 it uses two external interrupt routines to detect card entrance
 and flag data availability.
@@ -32,20 +41,31 @@ global variables:
 extern bool offlineFirstRead	-- set in case of this mode
 extern bool offlineWrite;		-- set in case of this mode
 extern bool onlineFirstREad;	-- set in case of this mode
-extern int writeAction;			-- set in case of offlineWrite action
+extern cardRecord cardInfo;			-- record to write in case of
+									offlineWrite, one block (see
+									cardData.c), one 0x57 command
 
 Output: 
 case onlineFirstREad:
-extern char RfidBufferToRead[MAX];	--card id in ASCII representation
-extern char debtChar[17];			--debit if there was any
+extern char RfidBufferToRead[MAX + 1];	--card id in ASCII representation
+extern cardRecord cardInfo			--debit if there was any (and
+									past values of binary record)
+extern bool cardRecordValid			--false if record block is
+									corrupted, then debt is not
+									deleted
 
-case onlineFirstREad:
+case offlineFirstRead:
 
-extern char RfidBufferToRead[MAX];	--card id in ASCII representation
-extern char pinChar[5];				--PIN code in ASCII
-extern char debtChar[17];			--debit if there was one
-extern char pastEnChar[17];			--past consumption if there was one
-extern char pastExChar[17];			--past total if there was one
+extern char RfidBufferToRead[MAX + 1];	--card id in ASCII representation
+extern cardRecord cardInfo;			--PIN, debit, past consumption and
+									past total, blocks
+									CARD_FIRST_BLOCK.. are read in one
+									reader transaction (0x52 with block
+									count), not one block per card event.
+									Cards of legacy ASCII layout are
+									parsed, PIN is cleared and
+									cardRecordValid is false if
+									record is corrupted
 
 
 Uses: Self-sufficient, USART driver is here for testing purposes
@@ -57,16 +77,19 @@ Date and year: 2014/05/26
 -----------------------------------------------------*/
 #include "driverSPI.h"
 #include "driverUSART.h"
+#include "crc16.h"
+#include "driverRFID.h"
+#include "eventQueue.h"
 #define  F_CPU 10000000L
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/sleep.h>
 #include <util/delay.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 
-#define MAX 14  //ascii representation for the 7 bytes id
 					
 typedef enum {
 	nilEvent,
@@ -86,10 +109,15 @@ typedef enum {
 
 typedef void (*action)();
 void stateEvalRFID(eventRFID e);
+void waitRFIDEvent();
+void postRFIDEvent(eventRFID e);
 
 void nilAction();
 void sendCommand();
+void commandPut(char byte);
+void commandPutRecord();
 void readBuffer();
+void idToString();
 void transmitString();
 
 
@@ -100,15 +128,19 @@ typedef struct {
 
 																														   
 stateElementRFID stateMatrixRFID[6][4] ={{{idle, nilAction} ,{	commanding,sendCommand} ,	{	reading,nilAction},			{idle,nilAction}},
-								{{idle, nilAction},{	wait_data,nilAction	},	{		reading,nilAction},			{idle,nilAction}},
-								{{idle, nilAction},{	wait_data,nilAction	},	{		reading,nilAction},			{idle,nilAction}},
-								{{idle, nilAction},{	wait_data,nilAction  },	{		reading,readBuffer},		{presenting,nilAction }},
-								{{idle, nilAction},{	wait_RFID_removed,nilAction},{	reading,nilAction},			{presenting,transmitString}},
+								{{idle, nilAction},{	wait_data,nilAction	},	{		reading,readBuffer},		{idle,nilAction}},
+								{{idle, nilAction},{	wait_data,nilAction	},	{		reading,readBuffer},		{idle,nilAction}},
+								{{idle, nilAction},{	wait_data,nilAction  },	{		reading,readBuffer},		{presenting,transmitString}},
+								{{idle, nilAction},{	commanding,sendCommand},{	reading,nilAction},			{presenting,transmitString}},
 								{{idle, nilAction},{	commanding,sendCommand},{	wait_RFID_removed,nilAction},{wait_RFID_removed,nilAction}}};
-char RfidBufferToRead[MAX];
+char RfidBufferToRead[MAX + 1];
 char superBuffer[100];
-int index_ = 0;
-volatile int i=MAX;
+uint8_t commandBuffer[32];
+uint8_t commandLength = 0;
+uint8_t replyLength = 0;
+bool replyStarted = false;
+spiTransfer commandTransfer;
+spiTransfer replyTransfer;
 //global flags to guide state machine 
 bool uid = false;
 bool pinB = false;
@@ -117,6 +149,7 @@ bool writeCredit = false;
 bool deleteCredit = false;
 bool pastConsB = false;
 bool pastExpB = false;
+bool cardBlocks = false;
 
 bool offlineFirstRead = false;
 bool offlineWrite = false;
@@ -124,11 +157,8 @@ bool onlineFirstREad = false;
 bool creditDetected = false;
 //Global variables to store read values
 int pl = 0;
-char pinChar[5];
-char debtChar[17];
-char pastEnChar[17];
-char pastExChar[17];
-int writeAction = 1;
+cardRecord cardInfo;
+bool cardRecordValid = true;
 char parammeter[100];
 
 volatile char data_ready=0;
@@ -136,9 +166,11 @@ volatile char RFID_present=0;
 volatile char bufferRead=0;
 bool rfidDone = false;
 
-eventRFID eventOccuredRFID=nilEvent;
+eventQueue rfidEvents;
+volatile uint8_t lastRFIDEvent = nilEvent;
 stateRFID currentStateRFID=idle;
 void OfflineFirstReading();
+char *cardBlock(char block);
 void OfflineWriting();
 void OnlineFirstReading();
 
@@ -153,7 +185,7 @@ void init ()
 	USART_Init(64);
 	GICR |=(1<<INT0)|(1<<INT1)|(1<<INT1);//
 	MCUCR|=(1<<ISC00)|(1<<ISC10); //(1<<ISC11)|(1<<ISC01)| rising edge and falling edge int0 card present/removed
-	asm("SEI");
+	sei();
 }
 /* -----------------------------------------------------
 ISR(INT1_vect)
@@ -164,11 +196,11 @@ is ready, on sequential initiation it starts the command transmission.
 ISR(INT1_vect) {
 static char togle=0;
 	if(togle==0) {
-		eventOccuredRFID=cardDatareadyEvent;
+		postRFIDEvent(cardDatareadyEvent);
 		togle=1;
 	}
 	else {
-		eventOccuredRFID=startTransmitEvent;
+		postRFIDEvent(startTransmitEvent);
 		togle=0;
 	}
 }
@@ -182,12 +214,12 @@ ISR(INT0_vect) {
 static char togle=0;
    
    if (togle==0){
-	eventOccuredRFID=cardEvent;
+	postRFIDEvent(cardEvent);
 	 togle=1;
    }
 	 else {
 		 togle=0;
-		 eventOccuredRFID=nilEvent;
+		 postRFIDEvent(nilEvent);
 	 }
 	
 }
@@ -196,14 +228,18 @@ bool RFIDinit(int command, char _parammeter[], int sizeOfPar)
 This function determines the mode that desired, passes parameter
 in case it is offlineWrite and parameter size. It also initiates
 serial communication with RFID reader as well as sets up interface
-and stimulates event change.
+and stimulates event change. Queue is emptied and only the
+latest event that came before the call is kept, as the state
+machine saw it before.
 -----------------------------------------------------*/
 bool RFIDinit(int command, char _parammeter[], int sizeOfPar)
 {
+	uint8_t e;
+	
 	pl = sizeOfPar;
 	memset(parammeter, '\0', sizeOfPar+1);
 	memcpy(parammeter, _parammeter, sizeOfPar);
-	memset(pinChar, '\0', 5);
+	memset(cardInfo.pin, '\0', 5);
 	memset(superBuffer, '\0', 100);
 	
 	switch(command){
@@ -236,18 +272,61 @@ bool RFIDinit(int command, char _parammeter[], int sizeOfPar)
 			pastExpB = true;
 		break;
 		
+		case RFID_READ_CARD :
+			cardBlocks = true;
+		break;
+		
 	}
 	 init();
 	 SPIinit();
 	
+	 cli();
+	 eventQueueClear(&rfidEvents);
+	 eventPost(&rfidEvents, lastRFIDEvent);
+	 sei();
 
 while (!rfidDone)
 {
-	  stateEvalRFID(eventOccuredRFID);
+	  if (eventGet(&rfidEvents, &e))
+	  {
+		  stateEvalRFID((eventRFID)e);
+	  }
+	  else
+	  {
+		  waitRFIDEvent();
+	  }
 }	
 return true;	   
 }
 /* -----------------------------------------------------
+void postRFIDEvent(eventRFID e)
+Puts event to the queue and notes it as the latest one,
+called from interrupts and actions.
+-----------------------------------------------------*/
+void postRFIDEvent(eventRFID e){
+	lastRFIDEvent = e;
+	eventPost(&rfidEvents, e);
+}
+/* -----------------------------------------------------
+void waitRFIDEvent()
+Puts the CPU to idle sleep until an interrupt, if no event
+is waiting. Interrupts are enabled by the instruction just
+before sleep, so an edge that comes after the check still
+wakes it.
+-----------------------------------------------------*/
+void waitRFIDEvent(){
+	cli();
+	if (eventQueueEmpty(&rfidEvents))
+	{
+		set_sleep_mode(SLEEP_MODE_IDLE);
+		sleep_enable();
+		sei();
+		sleep_cpu();
+		sleep_disable();
+	}
+	sei();
+}
+/* -----------------------------------------------------
 void stateEvalRFID(eventRFID e)
 This function is being passed an event as a parameter and 
 determines a state and action according to the a new event
@@ -267,143 +346,166 @@ void stateEvalRFID(eventRFID e){
 void sendCommand()
 This function sends commands and parameters to the RFID 
 reader through SPI according to the flags that are set.
+Command is built in commandBuffer and shifted by SPI engine
+in the background, length of the reply is noted for
+readBuffer.
 -----------------------------------------------------*/	 
  void sendCommand(){
 	
+commandLength = 0;
+replyStarted = false;
 if (uid)
 {
-	SPItransmit(0x55);
+	commandPut(0x55);
+	replyLength = MAX / 2;
 }
 
 if (pinB)
 {
-	SPItransmit(0x52);
-	SPItransmit(0x01);
-	SPItransmit(0x01);
+	commandPut(0x52);
+	commandPut(0x01);
+	commandPut(0x01);
+	replyLength = 1 + CARD_BLOCK_SIZE;
 }
 if (debt)
 {
-	SPItransmit(0x52);
-	SPItransmit(0x02);
-	SPItransmit(0x01);
+	commandPut(0x52);
+	commandPut(0x02);
+	commandPut(0x01);
+	replyLength = 1 + CARD_BLOCK_SIZE;
 }
 if (pastExpB)
 {
-	SPItransmit(0x52);
-	SPItransmit(0x04);
-	SPItransmit(0x01);
+	commandPut(0x52);
+	commandPut(0x04);
+	commandPut(0x01);
+	replyLength = 1 + CARD_BLOCK_SIZE;
 }
 if (pastConsB)
 {
-	SPItransmit(0x52);
-	SPItransmit(0x05);
-	SPItransmit(0x01);
+	commandPut(0x52);
+	commandPut(0x05);
+	commandPut(0x01);
+	replyLength = 1 + CARD_BLOCK_SIZE;
+}
+if (cardBlocks)
+{
+	commandPut(0x52);
+	commandPut(CARD_FIRST_BLOCK);
+	commandPut(CARD_BLOCK_COUNT);
+	replyLength = 1 + CARD_BLOCK_COUNT * CARD_BLOCK_SIZE;
 }
 if (writeCredit)
 {
-	char blockAddress = 0x02;
-	if (writeAction == 1)
-	{
-		blockAddress = 0x02; //debt
-		memset(parammeter, '\0', 17);
-		memcpy(parammeter, debtChar, 16);
-		//usart_transmit('1');
-	}else if (writeAction == 2)
-	{
-		blockAddress = 0x05; //exp
-		memset(parammeter, '\0', 17);
-		memcpy(parammeter, pastEnChar, 16);
-		//usart_transmit('2');
-	}else if (writeAction == 3)
-	{
-		blockAddress = 0x04; //cons
-		memset(parammeter, '\0', 17);
-		memcpy(parammeter, pastExChar, 16);
-		//usart_transmit('3');
-	}
-	SPItransmit(0x57);
-	SPItransmit(blockAddress);
-	SPItransmit(0x01);
-	
-	for (int i = 0; i < 16; i++)
-	{
-		SPItransmit(parammeter[i]);
-	}
+	commandPutRecord();
 }
 if (deleteCredit)
 {
-	SPItransmit(0x57);
-	SPItransmit(0x02);
-	SPItransmit(0x01);
-	
-	for (i = 0; i < 6; i++)
+	cardInfo.debt = 0;
+	cardInfo.sequence++;
+	commandPutRecord();
+}
+commandTransfer.tx = commandBuffer;
+commandTransfer.rx = NULL;
+commandTransfer.length = commandLength;
+commandTransfer.gapMs = 0;
+spiStart(&commandTransfer);
+}
+/* -----------------------------------------------------
+void commandPut(char byte)
+Appends a byte to the command that sendCommand builds,
+bytes that do not fit are dropped.
+-----------------------------------------------------*/
+void commandPut(char byte){
+	if (commandLength < sizeof(commandBuffer))
 	{
-		SPItransmit('0');
+		commandBuffer[commandLength++] = byte;
 	}
-
-}
 }
 /* -----------------------------------------------------
-void SPItransmit_(unsigned char byte)
-This is simple function to shift bytes through SPI. It receives
-char byte as a parameter, shifts it to RFID and puts received
-one to the superBuffer array. Acts as a usual buffer.
+void commandPutRecord()
+Appends write command of record block with cardInfo
+encoded in binary layout (debt, past energy and past
+expense together), whatever layout card had before.
 -----------------------------------------------------*/
- void SPItransmit_(unsigned char byte)
- {
-	 SPDR = byte;					//Load byte to Data register
-	 while(!(SPSR & (1<<SPIF))); 	// Wait for transmission complete
-	 char dd = SPDR;
-	 superBuffer[index_] = dd;
-// 	 usart_transmit('f');
-// 	 usart_transmit(dd);
-	 index_++;
- }
+void commandPutRecord(){
+	uint8_t block[CARD_BLOCK_SIZE];
+	
+	cardDataEncode(&cardInfo, block);
+	commandPut(0x57);
+	commandPut(CARD_DATA_BLOCK);
+	commandPut(0x01);
+	replyLength = 1;
+	for (uint8_t b = 0; b < CARD_BLOCK_SIZE; b++)
+	{
+		commandPut(block[b]);
+	}
+}
 /* -----------------------------------------------------
 void readBuffer()
 Function that reads the buffer of data RFID reader has
-sent through SPI. It has two cases, one when boolean uid
-is set true and second when it's not. First case is always
-true for card id reading and converts id bit value to ASCII
-representation and stores it to RfidBufferToRead array. On
-second case it calls SPItransmit_ where register is shift
-and bytes are stored to superBuffer array.
+sent through SPI. Reply of replyLength bytes (set by
+sendCommand) is read to superBuffer by SPI engine in the
+background, this only starts it. Reader flags data ready
+when its whole reply is ready, so bytes are clocked back to
+back (SPI_BYTE_GAP_MS, see driverSPI.h), and the command
+transfer is over or nearly over by then. Its next INT1 edge
+(startTransmitEvent) tells the reply is read, transmitString
+then waits for replyTransfer.done, microseconds at most.
 -----------------------------------------------------*/ 
  void readBuffer(){ 
-	 if (uid)
+	 if (!replyStarted)
+	 {
+		 replyTransfer.tx = NULL;
+		 replyTransfer.rx = (uint8_t *)superBuffer;
+		 replyTransfer.length = replyLength;
+		 replyTransfer.gapMs = SPI_BYTE_GAP_MS;
+		 while (!spiStart(&replyTransfer));
+		 replyStarted = true;
+	 }
+}
+/* -----------------------------------------------------
+void idToString()
+Converts card id bytes of the reply to ASCII hex in
+RfidBufferToRead, filled from the end as bytes come
+(indexes MAX-1 down to 0), terminated at MAX.
+-----------------------------------------------------*/
+ void idToString(){
+	 uint8_t i = MAX;
+	 
+	 for (uint8_t b = 0; b < MAX / 2; b++)
 	 {
-			 _delay_ms(2);
-			 SPItransmit(0xF5);
-			 char data = SPDR;
-			 char HEXbuffer[2];
-			 sprintf(HEXbuffer,"%02X", data);
-			 //RfidBufferToRead[15]='\0';
-			 RfidBufferToRead[i]=HEXbuffer[1];
-			 i--;
-			 RfidBufferToRead[i]=HEXbuffer[0];
-			 i--;
-	 }else{
-			_delay_ms(2);
-			SPItransmit_(0xF5);
-			//usart_transmit('r');
+		 char data = superBuffer[b];
+		 RfidBufferToRead[--i]=pgm_read_byte(&hexDigits[data & 0x0F]);
+		 RfidBufferToRead[--i]=pgm_read_byte(&hexDigits[(uint8_t)data >> 4]);
 	 }
+	 RfidBufferToRead[MAX]='\0';
+	 memset(superBuffer, '\0', 100);
 }
 /* -----------------------------------------------------
  void transmitString()
 This function interprets logical flags and calls 
 corresponding functions to interpret buffer value.
 Logical flags correspond to three modes this mechanism
-has. 
+has. It waits for the reply to be read completely first,
+it is already, or a byte time later.
 offlineFirstRead ->OfflineFirstReading()
 offlineWrite->OfflineWriting()
 onlineFirstREad->OnlineFirstReading()
 -----------------------------------------------------*/
  void transmitString(){
 	
+	if (replyStarted)
+	{
+		spiWait(&replyTransfer);
+	}
+	replyStarted = false;
+	if (uid)
+	{
+		idToString();
+	}
 	memset(parammeter, '\0', 100);
 	pl = 0;
-	i = MAX;
-	index_ = 0;
 	bufferRead=0;
 	
 	if (offlineFirstRead)
@@ -423,10 +525,10 @@ onlineFirstREad->OnlineFirstReading()
 		rfidDone = true;
 		deleteCredit = false;
 		//putString("deletedCredit");
-		eventOccuredRFID=nilEvent;
+		postRFIDEvent(nilEvent);
 		
 	}else{
-		eventOccuredRFID=nilEvent;
+		postRFIDEvent(nilEvent);
 	}
  }
  /* -----------------------------------------------------
@@ -434,7 +536,9 @@ onlineFirstREad->OnlineFirstReading()
 This function interprets and stores the values from RFID
 reader buffer according to the logical sequence. First it 
 catches card id and stores it to RfidBufferToRead. Then it 
-sets debt flag true and stores buffer value to debtChar.
+sets debt flag true and decodes record block to cardInfo.
+Corrupted record clears cardRecordValid and is not deleted,
+so debt on it is not lost by writing a fresh record.
 -----------------------------------------------------*/
  void OnlineFirstReading(void){
 	/* if (onlineFirstREad && deleteCredit)
@@ -444,19 +548,19 @@ sets debt flag true and stores buffer value to debtChar.
 		 //creditDetected = true;
 		 onlineFirstREad = false;
 		 putString("deleted");
-		 eventOccuredRFID=nilEvent;
+		 postRFIDEvent(nilEvent);
 	 }*/
 	 
 	 if (onlineFirstREad && debt)
 	 {
 		 rfidDone = true;
-		 deleteCredit = true;
 		 debt = false;
 		 //creditDetected = true;
 		 onlineFirstREad = true;
-		 memcpy(debtChar, superBuffer + 1, 16);
+		 cardRecordValid = cardDataDecode(&cardInfo, superBuffer + 1, NULL, NULL);
+		 deleteCredit = cardRecordValid;
 		 memset(superBuffer, '\0', 100);
-		 eventOccuredRFID=nilEvent;
+		 postRFIDEvent(nilEvent);
 	 }
 	 
 	 
@@ -465,111 +569,74 @@ sets debt flag true and stores buffer value to debtChar.
 		uid = false;
 		debt = true;
 		onlineFirstREad = true;
-		RfidBufferToRead[16]='\0';
+		RfidBufferToRead[MAX]='\0';
 		//putString(RfidBufferToRead);
 		//putString("\nfirstonline\n");
-		eventOccuredRFID=cardEvent;
+		postRFIDEvent(cardEvent);
 	 }
 	
 	 
  }
   /* -----------------------------------------------------
  void OfflineWriting()(void)
-This function sets writing flags in order to write parameters
-to the RFID card at consecutive states and events. By default
-first write action is to write debt, then it automatically sets
-flag to write last consumption and then - last expense.
+This function finishes writing to the RFID card. Debt, last
+consumption and last expense are written by one command as
+one record block, so it is done after the first reply.
 -----------------------------------------------------*/
  void OfflineWriting(){
-	  if (offlineWrite && writeCredit && writeAction == 3)
+	  if (offlineWrite && writeCredit)
 	  {
 		  rfidDone = true;
 		  offlineWrite = false;
 		  writeCredit = false;
 		  //putString("\ndoneOfflinewrite\n");
-		  eventOccuredRFID=nilEvent;
+		  postRFIDEvent(nilEvent);
 	  }
-	  
-	   if (offlineWrite && writeCredit && writeAction == 2)
-	   {
-		   writeCredit = true;
-		   writeAction = 3;
-		   
-		   eventOccuredRFID=cardEvent;
-	   }
-	   
-	    if (offlineWrite && writeCredit && writeAction == 1)
-	    {
-		    writeCredit = true;
-			writeAction = 2;
-		    
-		    eventOccuredRFID=cardEvent;
-	    }
  }
   /* -----------------------------------------------------
 void OfflineFirstReading(void)
 This function interprets and stores the values from RFID
 reader buffer according to the logical sequence. First it 
 catches card id and stores it to RfidBufferToRead. Then it 
-sets debt flag true and stores buffer value to debtChar.
-Consecutively it performs same action for storing pin, 
-past expenditure and past expense values.
+sets cardBlocks flag true, so the next command reads PIN,
+debt, past expense and past consumption blocks at once, and
+decodes them from the buffer to cardInfo (legacy ASCII blocks
+are parsed if record block is not binary). PIN is cleared
+if record check sum fails, so the card could not be used.
+Reader puts status byte first, then blocks one after another.
 -----------------------------------------------------*/
  void OfflineFirstReading(){
 	 
-	 if (offlineFirstRead && pastExpB)
+	 if (offlineFirstRead && cardBlocks)
 	 {
 		 rfidDone = true;
-		 pastConsB = false;
-		 pastExpB = false;
+		 cardBlocks = false;
 		 offlineFirstRead = false;
-		 memcpy(pastExChar, superBuffer + 1, 16);
-		// putString(pastExChar);
-		//  putString("\ndoneoffline\n");
-		 memset(superBuffer, '\0', 100);
-		 eventOccuredRFID=nilEvent;
-	 }
-	 
-	 if (offlineFirstRead && pastConsB)
-	 {
-		 pastConsB = false;
-		 pastExpB = true;
-		 memcpy(pastEnChar, superBuffer + 1, 16);
-	//	 putString(pastEnChar);
-		 memset(superBuffer, '\0', 100);
-		 eventOccuredRFID=cardEvent;
-	 }
-	 
-	 if (offlineFirstRead && debt)
-	 {
-		 rfidDone = false;
-		 debt = false;
-		 pastConsB = true;
-		 memcpy(debtChar, superBuffer + 1, 16);
-	//	 putString(debtChar);
+		 memcpy(cardInfo.pin, cardBlock(1), 4);
+		 cardRecordValid = cardDataDecode(&cardInfo, cardBlock(CARD_DATA_BLOCK), cardBlock(CARD_LEGACY_ENERGY_BLOCK), cardBlock(CARD_LEGACY_EXPENSE_BLOCK));
+		 if (!cardRecordValid)
+		 {
+			 memset(cardInfo.pin, '\0', 5);
+		 }
 		 memset(superBuffer, '\0', 100);
-		 eventOccuredRFID=cardEvent;
-	 }
-	 
-	 
-	 if (offlineFirstRead && pinB)
-	 {
-		 rfidDone = false;
-		 pinB = false;
-		 debt = true;
-		 memcpy(pinChar, superBuffer + 1, 4);
-	//	 putString(pinChar);
-		 memset(superBuffer, '\0', 100);
-		 eventOccuredRFID=cardEvent;
+		 postRFIDEvent(nilEvent);
 	 }
 	 
 	 if (offlineFirstRead && uid)
 	 {
 		 uid = false;
-		 pinB = true;
-		 RfidBufferToRead[16]='\0';
+		 cardBlocks = true;
+		 RfidBufferToRead[MAX]='\0';
 	//	 putString(RfidBufferToRead);
-		 eventOccuredRFID=cardEvent;
+		 postRFIDEvent(cardEvent);
 	 }
  }
+ /* -----------------------------------------------------
+char *cardBlock(char block)
+Returns where card block is in the buffer of multi block
+read, after status byte.
+-----------------------------------------------------*/
+ char *cardBlock(char block){
+	 return superBuffer + 1 + (block - CARD_FIRST_BLOCK) * CARD_BLOCK_SIZE;
+ }
  
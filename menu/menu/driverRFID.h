@@ -1,19 +1,23 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <stdbool.h>
+#include "cardData.h"
 
 #define MAX 14
+/* Card blocks read in one transaction, first block and count */
+#define CARD_FIRST_BLOCK 0x01
+#define CARD_BLOCK_COUNT 5
+/* RFIDinit command that reads all card blocks at once */
+#define RFID_READ_CARD 8
 
-extern char RfidBufferToRead[MAX];
+
+extern char RfidBufferToRead[MAX + 1];
 extern bool rfidDone;
-extern char pinChar[5];
-extern char debtChar[17];
-extern char pastEnChar[17];
-extern char pastExChar[17];
+extern cardRecord cardInfo;
+extern bool cardRecordValid;
 extern bool offlineFirstRead;
 extern bool offlineWrite;
 extern bool onlineFirstREad;
-extern int writeAction;
 extern bool creditDetected;
 
 
@@ -1,13 +1,26 @@
 /*---------------------------------------------------------
-Purpose: This is simple SPI initiation and buffer reading
-module. Has SPIinit() function to set apropriate bits as 
-well as void SPItransmit(unsigned char byte) function that 
-acts as shift register for serial communication.
+Purpose: This is SPI initiation and transfer module. Has
+SPIinit() function to set apropriate bits and a transfer
+engine that shifts whole buffers from SPI interrupt, so
+main program does not wait for every byte.
 
-Input: --
+Input: bool spiStart(spiTransfer *transfer)
+Descriptor with bytes to send (tx, or SPI_FILL bytes if it
+is NULL), buffer for received bytes (rx, or NULL to drop
+them), length and gapMs. Bytes of a transfer with gapMs
+are written by void spiTick(void) (called from 1 ms timer
+interrupt) after gapMs whole ms, not back to back. Returns
+false if another transfer is still running. Descriptor has
+to live until it is done.
 
-Output: void SPItransmit(unsigned char byte) is function that
-acts as shift register for serial communication. 
+Output: transfer->done is set by interrupt when the last
+byte is shifted, that is the signal to the caller (RFID
+state machine checks it). bool spiBusy(void) tells whether
+engine is running, void spiWait(spiTransfer *transfer) waits
+for the end. void SPItransmit(unsigned char byte) shifts one
+byte through the engine and waits, for short commands.
+Clock is F_CPU divided by the smallest divider that gives
+no more than SPI_READER_MAX_HZ.
 
 Uses: usual avr libraries such as io.h and interrupt.h
 
@@ -18,22 +31,161 @@ Date and year: 2014/05/26
 -----------------------------------------------------*/
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "driverSPI.h"
+#define F_CPU 10000000L
+
+/* SPCR rate bits and SPI2X of the divider, fastest first */
+#if F_CPU / 2 <= SPI_READER_MAX_HZ
+#define SPI_RATE_BITS 0
+#define SPI_DOUBLE_SPEED 1
+#elif F_CPU / 4 <= SPI_READER_MAX_HZ
+#define SPI_RATE_BITS 0
+#define SPI_DOUBLE_SPEED 0
+#elif F_CPU / 8 <= SPI_READER_MAX_HZ
+#define SPI_RATE_BITS (1<<SPR0)
+#define SPI_DOUBLE_SPEED 1
+#elif F_CPU / 16 <= SPI_READER_MAX_HZ
+#define SPI_RATE_BITS (1<<SPR0)
+#define SPI_DOUBLE_SPEED 0
+#elif F_CPU / 32 <= SPI_READER_MAX_HZ
+#define SPI_RATE_BITS (1<<SPR1)
+#define SPI_DOUBLE_SPEED 1
+#elif F_CPU / 64 <= SPI_READER_MAX_HZ
+#define SPI_RATE_BITS (1<<SPR1)
+#define SPI_DOUBLE_SPEED 0
+#else
+#define SPI_RATE_BITS ((1<<SPR1) | (1<<SPR0))
+#define SPI_DOUBLE_SPEED 0
+#endif
+
+spiTransfer * volatile spiCurrent = NULL;
+volatile uint8_t spiPosition = 0;
+volatile uint8_t spiGapTicks = 0;
+
+void spiWriteNext(spiTransfer *transfer);
 /* -----------------------------------------------------
 void SPIinit(void)
-Initializes SPI.
+Initializes SPI master with transfer complete interrupt.
+SPI2X is in SPSR, not in SPCR.
 -----------------------------------------------------*/
 void SPIinit(void)
 {
 	DDRB = (1<<PB4) | (1<<PB5) | (1<<PB7);								// Set MOSI , SCK , and SS output
-	SPCR = (1<<SPE) | (1<<MSTR) | (1<<SPR1) | (1<<SPI2X);				// Enable , SPI itself, Master, set clock rate fck/32
+	SPCR = (1<<SPIE) | (1<<SPE) | (1<<MSTR) | SPI_RATE_BITS;			// Enable interrupt, SPI itself, Master, clock rate
+	SPSR = SPI_DOUBLE_SPEED ? (1<<SPI2X) : 0;
+	spiCurrent = NULL;
+}
+/* -----------------------------------------------------
+bool spiStart(spiTransfer *transfer)
+Starts transfer by writing its first byte (or by arming
+the gap before it), the rest are written by interrupt.
+Empty transfer is done at once.
+-----------------------------------------------------*/
+bool spiStart(spiTransfer *transfer)
+{
+	bool started = false;
+	uint8_t sreg = SREG;
+	
+	cli();
+	if (spiCurrent == NULL)
+	{
+		transfer->done = (transfer->length == 0);
+		if (!transfer->done)
+		{
+			spiCurrent = transfer;
+			spiPosition = 0;
+			spiWriteNext(transfer);
+		}
+		started = true;
+	}
+	SREG = sreg;
+	return started;
+}
+/* -----------------------------------------------------
+bool spiBusy(void)
+Tells whether a transfer is running.
+-----------------------------------------------------*/
+bool spiBusy(void)
+{
+	return (spiCurrent != NULL);
+}
+/* -----------------------------------------------------
+void spiWait(spiTransfer *transfer)
+Waits until transfer is done.
+-----------------------------------------------------*/
+void spiWait(spiTransfer *transfer)
+{
+	while (!transfer->done);
 }
 /* -----------------------------------------------------
 void SPItransmit(unsigned char byte)
-Shifts a byte through SPI.
+Shifts a byte through SPI and waits for it, after other
+transfer has finished.
 -----------------------------------------------------*/
 void SPItransmit(unsigned char byte)
 {
-	SPDR = byte;					//Load byte to Data register
-	while(!(SPSR & (1<<SPIF))); 	// Wait for transmission complete
+	spiTransfer single = {&byte, NULL, 1, 0, false};
+	
+	while (!spiStart(&single));
+	spiWait(&single);
+}
+/* -----------------------------------------------------
+void spiWriteNext(spiTransfer *transfer)
+Writes byte at spiPosition, or arms the gap for spiTick if
+transfer has one. Tick is counted one more time, the first
+one could come at once.
+-----------------------------------------------------*/
+void spiWriteNext(spiTransfer *transfer)
+{
+	if (transfer->gapMs == 0)
+	{
+		SPDR = (transfer->tx != NULL) ? transfer->tx[spiPosition] : SPI_FILL;
+	}
+	else
+	{
+		spiGapTicks = transfer->gapMs + 1;
+	}
+}
+/* -----------------------------------------------------
+void spiTick(void)
+Called every ms from timer interrupt, writes the waiting
+byte when gap is over.
+-----------------------------------------------------*/
+void spiTick(void)
+{
+	spiTransfer *transfer = spiCurrent;
+	
+	if ((transfer != NULL) && (spiGapTicks != 0) && (--spiGapTicks == 0))
+	{
+		SPDR = (transfer->tx != NULL) ? transfer->tx[spiPosition] : SPI_FILL;
+	}
+}
+/* -----------------------------------------------------
+ISR(SPI_STC_vect)
+Byte is shifted, keeps received one and writes the next
+(or leaves it to spiTick), after the last one marks
+descriptor done and frees engine.
+-----------------------------------------------------*/
+ISR(SPI_STC_vect)
+{
+	spiTransfer *transfer = spiCurrent;
+	uint8_t received = SPDR;
+	
+	if (transfer->rx != NULL)
+	{
+		transfer->rx[spiPosition] = received;
+	}
+	if (++spiPosition < transfer->length)
+	{
+		spiWriteNext(transfer);
+	}
+	else
+	{
+		spiCurrent = NULL;
+		transfer->done = true;
+	}
 }
 
@@ -1,5 +1,36 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Fastest SPI clock the RFID reader takes, Hz. Divider of
+F_CPU is chosen in SPIinit as the smallest one that is not
+faster. */
+#define SPI_READER_MAX_HZ 250000UL
+/* Byte sent when descriptor has no tx buffer (reader poll) */
+#define SPI_FILL 0xF5
+/* Pause before each reply byte, ms, 0 sends bytes back to
+back. Reader raises INT1 when its whole reply is ready and
+again after the last byte is read, so reply is clocked at
+SPI_READER_MAX_HZ and the second edge ends it. Old driver
+waited 2 ms before every byte, that was the pace of its
+polling loop (_delay_ms(2) per byte), no reader data sheet
+asks for it. Set it only for a reader that needs time
+between bytes */
+#define SPI_BYTE_GAP_MS 0
+
+/* Transfer descriptor, tx or rx could be NULL */
+typedef struct {
+	const uint8_t *tx;
+	uint8_t *rx;
+	uint8_t length;
+	uint8_t gapMs;		//pause before every byte, ms
+	volatile bool done;
+} spiTransfer;
 
 extern void SPIinit(void);
-extern void SPItransmit(unsigned char byte);
\ No newline at end of file
+extern void SPItransmit(unsigned char byte);
+extern bool spiStart(spiTransfer *transfer);
+extern bool spiBusy(void);
+extern void spiWait(spiTransfer *transfer);
+extern void spiTick(void);
\ No newline at end of file
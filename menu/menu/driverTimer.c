@@ -12,6 +12,10 @@ interrupt is disabled.
 Output: 
 extern char ms;			--> ++ every ms
 extern char second;		--> ++ every s
+uint16_t getTick(void)	--> milliseconds since timer start, wraps
+						after 65.5 s, so compare differences only
+Compare A interrupt drives keypad scanning (driverKeyPad)
+and gaps between SPI reply bytes (driverSPI).
 
 Uses: usual avr libraries such as io.h and interrupt.h etc.
 
@@ -22,53 +26,77 @@ Date and year: 2014/05/26
 -----------------------------------------------------*/
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "driverKeyPad.h"
+#include "driverSPI.h"
 #define F_CPU 10000000L
 
 volatile char ms=0;
 volatile int timeOut=0;
 volatile char second=0;
+volatile uint16_t tick=0;
+volatile bool countSeconds=false;
 /* -----------------------------------------------------
 void init_timer1(char flagA, char flagB)
-Chars flagA and flagB are used to set up counter. If flagA is
-1, timer 1 is enabled else timer 1 compareA interrupt is disabled.
-If flagB is set to 1, timer 0 is enabled else timer 1 compareB
-interrupt is disabled.
+Chars flagA and flagB are used to set up counter. Timer 1
+runs in CTC mode, prescaled by 8 (1250000 Hz), and compare A
+at 1249 gives 1 ms period. If flagA is 1, timer 1 compareA
+interrupt (ms tick) is enabled else it is disabled. If flagB
+is set to 1, seconds are counted as well, it is done in
+compareA interrupt, so it needs flagA too.
 -----------------------------------------------------*/
 void init_timer1(char flagA, char flagB){
 	
-	TCCR1A=(0<<COM1A1)|(0<<COM1B1)|(0<<COM1A0)|(0<<WGM11)|(0<<WGM10);   //enable timer1 out for simulation of pedal speed - phase and frequency correct mode
-	TCCR1B=(1<<WGM10)|(3<<CS10); /*prescaling by 64 - 1250000 Hz*/ // (1<<WGM12) CTC
+	TCCR1A=0x00;						//no outputs, WGM11:10 = 0
+	TCCR1B=(1<<WGM12)|(1<<CS11);		//CTC with OCR1A top, prescaling by 8 - 1250000 Hz
 
-	OCR1A=0x04E2;  //04E2gives 1 msec compare og 30D4 gives 10ms 
-	TCCR1A=0x0000;
+	OCR1A=1249;  //1250 counts gives 1 msec compare
 	if (flagA==1)
-		TIMSK|=(1<<OCIE1A);   //enable timer 1 and disable timer 0 compare interrupt
+		TIMSK|=(1<<OCIE1A);   //enable timer 1 compare A interrupt
 	else
 		TIMSK&=~(1<<OCIE1A);
 
-	if (flagB==1) {
-		TIMSK|=(1<<OCIE1B);   //enable timer 1 and disable timer 0 compare interrupt
-		OCR1B =14375;  //count to 5 => 1 seconds - 1 ms is counted by compare A
-	}
-	else
-	TIMSK&=~(1<<OCIE1B);
+	countSeconds = (flagB==1);
+}
+/* -----------------------------------------------------
+uint16_t getTick(void)
+Returns ms tick counter. It is 16 bit, so interrupts are
+disabled while it is read.
+-----------------------------------------------------*/
+uint16_t getTick(void)
+{
+	uint16_t now;
+	uint8_t sreg = SREG;
+	
+	cli();
+	now = tick;
+	SREG = sreg;
+	return now;
 }
 /* -----------------------------------------------------
 ISR(TIMER1_COMPA_vect)
 ISR timer1 compare interrupt that is executed every ms
-and increments ms variable value.
+and increments ms variable value, every 1000 ms it
+increments second variable value if seconds are counted.
+Keypad is scanned here as well, one step per ms, and
+SPI byte gap is counted.
 -----------------------------------------------------*/
 ISR(TIMER1_COMPA_vect)
 {
+	static uint16_t msInSecond = 0;
+	
 	timeOut++;
 	ms++;
-}
-/* -----------------------------------------------------
-ISR(TIMER1_COMPB_vect)
-ISR timer1 compare interrupt that is executed every s
-and increments second variable value.
------------------------------------------------------*/
-ISR(TIMER1_COMPB_vect)
-{
-	second++;
+	tick++;
+	keypad_tick();
+	spiTick();
+	if (++msInSecond == 1000)
+	{
+		msInSecond = 0;
+		if (countSeconds)
+		{
+			second++;
+		}
+	}
 }
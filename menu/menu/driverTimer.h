@@ -1,4 +1,7 @@
-extern int timeOut;
-extern char ms;
-extern char second;
+#include <stdint.h>
+
+extern volatile int timeOut;
+extern volatile char ms;
+extern volatile char second;
 extern void init_timer1(char onA, char onB);
+extern uint16_t getTick(void);
\ No newline at end of file
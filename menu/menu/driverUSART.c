@@ -9,7 +9,11 @@ Input: A byte could be received through char receiveUSART().
 
 Output: A byte and array of chars could be sent through 
 void usart_transmit( char data) and 
-void sendStringUSART (char *s) respectively. 
+void sendStringUSART (char *s) respectively. Both only put
+bytes to transmit ring that is drained by USART_UDRE_vect ISR,
+so they return immediately unless the ring is full.
+bool txQueueEmpty(void) tells whether everything is sent and
+void flushUSART(void) waits until it is.
 
 
 Uses: usual avr libraries such as io.h and interrupt.h etc.
@@ -22,6 +26,34 @@ Date and year: 2014/05/26
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <stdio.h>
+#include <stdbool.h>
+
+/* Transmit ring size, must be power of two and not bigger
+than 128, because 8 bit free running indexes are used */
+#define TX_RING_SIZE 128
+#define TX_RING_MASK (TX_RING_SIZE - 1)
+
+volatile char txRing[TX_RING_SIZE];
+volatile uint8_t txHead = 0;	//written by main loop only
+volatile uint8_t txTail = 0;	//written by ISR only
+/* -----------------------------------------------------
+ISR(USART_UDRE_vect)
+Interrupt service routine that is fired whenever UDR is
+empty. Shifts next byte from transmit ring to UDR, disables
+itself when ring is empty.
+-----------------------------------------------------*/
+ISR(USART_UDRE_vect)
+{
+	uint8_t tail = txTail;
+	
+	if (tail == txHead)
+	{
+		UCSRB &= ~(1<<UDRIE);
+		return;
+	}
+	UDR = txRing[tail & TX_RING_MASK];
+	txTail = tail + 1;
+}
 /* -----------------------------------------------------
 char receiveUSART()
 Waits for RXC flag and writes UDR byte value to received
@@ -39,19 +71,24 @@ char receiveUSART()
 }
 /* -----------------------------------------------------
 void usart_transmit( char data)
-Waits for UDRE flag and writes to data parameter value
-to UDR register. Sends data byte.
+Puts data byte to transmit ring and enables UDRE interrupt
+that sends it. Waits only if the ring is full.
 -----------------------------------------------------*/
 void transmitUSART( char data)
 {
-	/* Wait for data to be transmitted */
-	while ( !(UCSRA & (1<<UDRE)));
+	uint8_t head = txHead;
+	
+	/* Wait for free place in ring */
+	while ((uint8_t)(head - txTail) >= TX_RING_SIZE);
 
-	UDR = data;
+	txRing[head & TX_RING_MASK] = data;
+	txHead = head + 1;
+	UCSRA = (UCSRA & (1<<U2X)) | (1<<TXC);	//clear transmit complete flag
+	UCSRB |= (1<<UDRIE);
 }
 /* -----------------------------------------------------
 void sendStringUSART (char *s)
-Sends a string through USART. Shifts bytes of array
+Sends a string through USART. Queues bytes of array
 passed by *s pointer until terminator.
 -----------------------------------------------------*/
 void sendStringUSART (char *s)
@@ -62,7 +99,26 @@ void sendStringUSART (char *s)
 	}
 }
 /* -----------------------------------------------------
-void sendStringUSART (char *s)
+bool txQueueEmpty(void)
+Returns true when every queued byte has been moved to UDR.
+-----------------------------------------------------*/
+bool txQueueEmpty(void)
+{
+	return (txHead == txTail);
+}
+/* -----------------------------------------------------
+void flushUSART(void)
+Waits until transmit ring is drained and the last byte
+has left the shift register (TXC flag). Used before
+watchdog resets.
+-----------------------------------------------------*/
+void flushUSART(void)
+{
+	while (!txQueueEmpty());
+	while (!(UCSRA & (1<<TXC)));
+}
+/* -----------------------------------------------------
+void USART_Init( unsigned int baud )
 Enables USART receiver and transmitter, sets up frame
 format: 1 stop bit, 8 data bits, no parity, full duplex.
 Uses int baud parameter to set baud rate while casted.
@@ -1,7 +1,10 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <stdbool.h>
 
 extern void USART_Init( unsigned int baud );
 extern void sendStringUSART (char *s);
 extern void transmitUSART(unsigned char data);
-extern char receiveUSART();
\ No newline at end of file
+extern char receiveUSART();
+extern bool txQueueEmpty(void);
+extern void flushUSART(void);
\ No newline at end of file
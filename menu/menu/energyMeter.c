@@ -0,0 +1,269 @@
+/*---------------------------------------------------------
+Purpose: The purpose of this module is to count energy of
+charging in integers. Every ADC frame holds voltage and
+current sampled over one sample period (1 / ENERGY_SAMPLE_HZ
+s), their product (real power) and square of current are
+added to 64 bit accumulators, so nothing is lost on the way
+and no floating point is needed.
+
+Input: void energyMeterBlock(const uint16_t *samples, uint8_t n)
+Block of interleaved ADC frames taken from driverADC ring.
+Channel offsets are taken away from every sample, channel
+gains are applied only when value is converted, as one
+precomputed power scale (nW per count^2, Q4).
+Power of every frame also goes through a decimation stage,
+4^ENERGY_OVERSAMPLE_BITS frames are summed and shifted by
+ENERGY_OVERSAMPLE_BITS, and the result through exponential
+moving average with coefficient 2^-ENERGY_EMA_SHIFT. Only
+additions and shifts, it gives the shown power more bits
+and less noise. Energy is not decimated, it is the exact
+sum of every frame.
+Calibration is kept in EEPROM, energyMeterLoadCalibration
+reads it (defaults are used while EEPROM is erased) and
+energyMeterSaveCalibration stores a new one.
+
+Output: uint32_t energyMeterEnergy(uint8_t decimals) returns
+energy (mWs) as fixed point with given decimals (see
+fixedPoint.c), rounded to nearest. uint32_t energyMeterPower
+(uint8_t decimals) returns filtered real power (mW) the same
+way and closes current window. uint32_t energyMeterCurrent
+(uint8_t decimals) returns RMS current (mA) of frames added
+before the window was closed by energyMeterPower.
+uint32_t energyMeterScaled(uint32_t factor, uint8_t decimals)
+returns energy multiplied by factor (e.g. price, below 2^24),
+rounding only once. Conversion is done only when value is
+shown or sent, not on every sample. Energy flowing back to
+the grid is counted off, but negative total reads as 0.
+
+Sums of products are exact, only power scale is rounded (to
+1/16 nW per count^2) and conversion drops less than 1 nWs.
+
+Uses: usual avr libraries such as io.h, pgmspace.h and
+eeprom.h.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/eeprom.h>
+#include <stdint.h>
+#include "energyMeter.h"
+
+/* aW (gain product) per nW Q4 */
+#define ENERGY_SCALE_DIVISOR (1000000000UL >> ENERGY_FRACTION_BITS)
+#define ENERGY_DECIMATION (1 << (2 * ENERGY_OVERSAMPLE_BITS))
+
+uint64_t mulDiv(uint64_t value, uint32_t factor, uint32_t divisor);
+uint32_t squareRoot(uint64_t value);
+
+const uint32_t nanoDivisors[ENERGY_NANO_DECIMALS + 1] PROGMEM = {
+	1000000UL, 100000UL, 10000UL, 1000UL, 100UL, 10UL, 1UL
+};
+
+/* Defaults of the simulation board: DC on both channels,
+5 V and 4 mA over 1024 counts */
+meterCalibration EEMEM eeCalibration = {
+	{0, 0},
+	{4882813UL, 3906UL}
+};
+
+meterCalibration calibration = {
+	{0, 0},
+	{4882813UL, 3906UL}
+};
+uint32_t powerScale = 305;
+int64_t energyAccumulator = 0;
+int32_t decimatorSum = 0;
+uint8_t decimatorCount = 0;
+int32_t filteredPower = 0;
+uint64_t squareWindowSum = 0;
+uint16_t squareWindowCount = 0;
+uint64_t lastSquareSum = 0;
+uint16_t lastSquareCount = 0;
+/* -----------------------------------------------------
+void energyMeterLoadCalibration(void)
+Reads calibration from EEPROM and precomputes power scale.
+Erased EEPROM (gain 0xFFFFFFFF) leaves defaults in use.
+-----------------------------------------------------*/
+void energyMeterLoadCalibration(void){
+	
+	meterCalibration stored;
+	
+	eeprom_read_block(&stored, &eeCalibration, sizeof(stored));
+	if ((stored.gain[ADC_VOLTAGE] != 0xFFFFFFFFUL) && (stored.gain[ADC_CURRENT] != 0xFFFFFFFFUL))
+	{
+		calibration = stored;
+	}
+	powerScale = ((uint64_t)calibration.gain[ADC_VOLTAGE] * calibration.gain[ADC_CURRENT] + ENERGY_SCALE_DIVISOR / 2) / ENERGY_SCALE_DIVISOR;
+}
+/* -----------------------------------------------------
+void energyMeterSaveCalibration(const meterCalibration *newCalibration)
+Writes calibration to EEPROM (only bytes that differ) and
+starts using it.
+-----------------------------------------------------*/
+void energyMeterSaveCalibration(const meterCalibration *newCalibration){
+	
+	eeprom_update_block(newCalibration, &eeCalibration, sizeof(meterCalibration));
+	energyMeterLoadCalibration();
+}
+/* -----------------------------------------------------
+void energyMeterReset(void)
+Sets accumulated energy and power to zero.
+-----------------------------------------------------*/
+void energyMeterReset(void){
+	
+	energyAccumulator = 0;
+	decimatorSum = 0;
+	decimatorCount = 0;
+	filteredPower = 0;
+	squareWindowSum = 0;
+	squareWindowCount = 0;
+	lastSquareSum = 0;
+	lastSquareCount = 0;
+}
+/* -----------------------------------------------------
+void energyMeterBlock(const uint16_t *samples, uint8_t n)
+Adds n samples (n / ADC_CHANNELS frames) to energy, to
+decimation stage and to current window. Offsets are taken
+away, then voltage is multiplied by current, 32 bit sums
+are enough for a block. Filter state keeps
+ENERGY_EMA_SHIFT more bits, so averaging loses nothing.
+-----------------------------------------------------*/
+void energyMeterBlock(const uint16_t *samples, uint8_t n){
+	
+	int32_t powerSum = 0;
+	uint32_t squareSum = 0;
+	uint8_t frames = 0;
+	
+	for (uint8_t i = 0; i + ADC_CHANNELS <= n; i += ADC_CHANNELS)
+	{
+		int16_t voltage = (int16_t)samples[i + ADC_VOLTAGE] - calibration.offset[ADC_VOLTAGE];
+		int16_t current = (int16_t)samples[i + ADC_CURRENT] - calibration.offset[ADC_CURRENT];
+	
+		int32_t power = (int32_t)voltage * current;
+	
+		powerSum += power;
+		squareSum += (uint32_t)((int32_t)current * current);
+		frames++;
+		decimatorSum += power;
+		if (++decimatorCount == ENERGY_DECIMATION)
+		{
+			filteredPower += (decimatorSum >> ENERGY_OVERSAMPLE_BITS) - (filteredPower >> ENERGY_EMA_SHIFT);
+			decimatorSum = 0;
+			decimatorCount = 0;
+		}
+	}
+	energyAccumulator += powerSum;
+	squareWindowSum += squareSum;
+	squareWindowCount += frames;
+}
+/* -----------------------------------------------------
+uint32_t energyMeterPower(uint8_t decimals)
+Filtered real power in mW, with decimals, rounded. Filter
+output is in count^2 with ENERGY_OVERSAMPLE_BITS and
+ENERGY_EMA_SHIFT more bits, they are divided out with the
+power scale. Current window is closed, if a frame was added
+to it.
+-----------------------------------------------------*/
+uint32_t energyMeterPower(uint8_t decimals){
+	
+	uint32_t divisor = pgm_read_dword(&nanoDivisors[decimals]);
+	
+	if (squareWindowCount != 0)
+	{
+		lastSquareSum = squareWindowSum;
+		lastSquareCount = squareWindowCount;
+		squareWindowSum = 0;
+		squareWindowCount = 0;
+	}
+	if (filteredPower <= 0)
+	{
+		return 0;
+	}
+	return (mulDiv(filteredPower, powerScale, 1UL << (ENERGY_FRACTION_BITS + ENERGY_OVERSAMPLE_BITS + ENERGY_EMA_SHIFT)) + divisor / 2) / divisor;
+}
+/* -----------------------------------------------------
+uint32_t energyMeterCurrent(uint8_t decimals)
+RMS current in mA of the last closed window, with decimals,
+rounded. Root is taken of mean square in Q16, so it comes
+in Q8 counts, then current gain (nA) is applied.
+-----------------------------------------------------*/
+uint32_t energyMeterCurrent(uint8_t decimals){
+	
+	uint64_t divisor = (uint64_t)pgm_read_dword(&nanoDivisors[decimals]) << 8;
+	uint32_t root;
+	
+	if (lastSquareCount == 0)
+	{
+		return 0;
+	}
+	root = squareRoot((lastSquareSum << 16) / lastSquareCount);
+	return ((uint64_t)root * calibration.gain[ADC_CURRENT] + divisor / 2) / divisor;
+}
+/* -----------------------------------------------------
+uint32_t energyMeterEnergy(uint8_t decimals)
+Accumulated energy in mWs with decimals, rounded.
+-----------------------------------------------------*/
+uint32_t energyMeterEnergy(uint8_t decimals){
+	
+	return energyMeterScaled(1, decimals);
+}
+/* -----------------------------------------------------
+uint32_t energyMeterScaled(uint32_t factor, uint8_t decimals)
+Accumulated energy multiplied by factor, with decimals and
+rounded once at the end. Energy is first taken to whole nWs,
+then quotient and remainder are scaled separately, so the
+product does not overflow.
+-----------------------------------------------------*/
+uint32_t energyMeterScaled(uint32_t factor, uint8_t decimals){
+	
+	uint32_t divisor = pgm_read_dword(&nanoDivisors[decimals]);
+	uint64_t energy;
+	
+	if (energyAccumulator <= 0)
+	{
+		return 0;
+	}
+	energy = mulDiv(energyAccumulator, powerScale, (uint32_t)ENERGY_SAMPLE_HZ << ENERGY_FRACTION_BITS);
+	return (energy / divisor) * factor + ((energy % divisor) * factor + divisor / 2) / divisor;
+}
+/* -----------------------------------------------------
+uint64_t mulDiv(uint64_t value, uint32_t factor, uint32_t divisor)
+Returns value * factor / divisor rounded down, without the
+product. divisor * factor has to be below 2^64.
+-----------------------------------------------------*/
+uint64_t mulDiv(uint64_t value, uint32_t factor, uint32_t divisor){
+	
+	return (value / divisor) * factor + (value % divisor) * factor / divisor;
+}
+/* -----------------------------------------------------
+uint32_t squareRoot(uint64_t value)
+Integer square root rounded down, two bits per step.
+-----------------------------------------------------*/
+uint32_t squareRoot(uint64_t value){
+	
+	uint64_t root = 0;
+	uint64_t bit = (uint64_t)1 << 62;
+	
+	while (bit > value)
+	{
+		bit >>= 2;
+	}
+	while (bit != 0)
+	{
+		if (value >= root + bit)
+		{
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else
+		{
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return root;
+}
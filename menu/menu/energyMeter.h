@@ -0,0 +1,32 @@
+#include <avr/io.h>
+#include <stdint.h>
+#include "driverADC.h"
+
+/* Fraction bits of power scale (nW per count^2) */
+#define ENERGY_FRACTION_BITS 4
+/* Decimals of nano units */
+#define ENERGY_NANO_DECIMALS 6
+/* Frames per second that are added to the meter */
+#define ENERGY_SAMPLE_HZ ADC_SAMPLE_HZ
+/* Power stream is decimated by 4^n frames and shifted by n,
+giving n more bits (2: 16 frames, 62.5 Hz) */
+#define ENERGY_OVERSAMPLE_BITS 2
+/* Moving average of decimated power, coefficient 2^-n, 0 is
+no averaging (4: time constant 16 decimated samples) */
+#define ENERGY_EMA_SHIFT 4
+
+/* Per channel calibration kept in EEPROM, offset in ADC
+counts, gain in nV (voltage) or nA (current) per count */
+typedef struct {
+	int16_t offset[ADC_CHANNELS];
+	uint32_t gain[ADC_CHANNELS];
+} meterCalibration;
+
+extern void energyMeterLoadCalibration(void);
+extern void energyMeterSaveCalibration(const meterCalibration *newCalibration);
+extern void energyMeterReset(void);
+extern void energyMeterBlock(const uint16_t *samples, uint8_t n);
+extern uint32_t energyMeterPower(uint8_t decimals);
+extern uint32_t energyMeterCurrent(uint8_t decimals);
+extern uint32_t energyMeterEnergy(uint8_t decimals);
+extern uint32_t energyMeterScaled(uint32_t factor, uint8_t decimals);
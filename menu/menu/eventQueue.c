@@ -0,0 +1,92 @@
+/*---------------------------------------------------------
+Purpose: The purpose of this module is to let state machine
+actions generate the next event without calling state machine
+engine from inside themselves. Action posts event to the queue
+and returns, dispatch loop of the state machine takes events
+out one by one and fires the actions, so stack depth stays the
+same however long session lasts.
+
+Input: bool eventPost(eventQueue *q, uint8_t event)
+Queue and event to put to its end. Returns false and counts
+overflow if queue is full. Interrupts are disabled while event
+is put, so it could be posted from interrupt routine as well.
+
+Output: bool eventGet(eventQueue *q, uint8_t *event)
+Takes the oldest event from the queue, returns false if queue
+is empty.
+
+Uses: usual avr libraries such as io.h and interrupt.h.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "eventQueue.h"
+
+#define EVENT_QUEUE_MASK (EVENT_QUEUE_SIZE - 1)
+/* -----------------------------------------------------
+bool eventPost(eventQueue *q, uint8_t event)
+Puts event to the end of queue. Indexes run freely and
+are masked, so queue is full when they differ by size.
+-----------------------------------------------------*/
+bool eventPost(eventQueue *q, uint8_t event)
+{
+	bool posted = false;
+	uint8_t sreg = SREG;
+	
+	cli();
+	if ((uint8_t)(q->head - q->tail) < EVENT_QUEUE_SIZE)
+	{
+		q->events[q->head & EVENT_QUEUE_MASK] = event;
+		q->head++;
+		posted = true;
+	}else{
+		q->overflows++;
+	}
+	SREG = sreg;
+	return posted;
+}
+/* -----------------------------------------------------
+bool eventGet(eventQueue *q, uint8_t *event)
+Takes the oldest event out of queue to *event.
+-----------------------------------------------------*/
+bool eventGet(eventQueue *q, uint8_t *event)
+{
+	bool got = false;
+	uint8_t sreg = SREG;
+	
+	cli();
+	if (q->head != q->tail)
+	{
+		*event = q->events[q->tail & EVENT_QUEUE_MASK];
+		q->tail++;
+		got = true;
+	}
+	SREG = sreg;
+	return got;
+}
+/* -----------------------------------------------------
+bool eventQueueEmpty(eventQueue *q)
+Tells whether there is no event waiting.
+-----------------------------------------------------*/
+bool eventQueueEmpty(eventQueue *q)
+{
+	return (q->head == q->tail);
+}
+/* -----------------------------------------------------
+void eventQueueClear(eventQueue *q)
+Drops all events that are waiting.
+-----------------------------------------------------*/
+void eventQueueClear(eventQueue *q)
+{
+	uint8_t sreg = SREG;
+	
+	cli();
+	q->tail = q->head;
+	SREG = sreg;
+}
@@ -0,0 +1,18 @@
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Number of events that could wait in a queue, power of two */
+#define EVENT_QUEUE_SIZE 8
+
+typedef struct {
+	uint8_t events[EVENT_QUEUE_SIZE];
+	uint8_t head;
+	uint8_t tail;
+	uint8_t overflows;
+} eventQueue;
+
+extern bool eventPost(eventQueue *q, uint8_t event);
+extern bool eventGet(eventQueue *q, uint8_t *event);
+extern bool eventQueueEmpty(eventQueue *q);
+extern void eventQueueClear(eventQueue *q);
@@ -0,0 +1,188 @@
+/*---------------------------------------------------------
+Purpose: The purpose of this module is to convert decimal
+numbers between strings and scaled integers (fixed point),
+e.g. 102.20 with two decimals is kept as 10220. It replaces
+snprintf("%.2f") and atof, so neither floating point printf
+nor scanf library has to be linked.
+
+Input: uint8_t fixedFormat(char *str, int32_t value,
+uint8_t decimals, uint8_t width, bool rightAlign)
+Value scaled by 10^decimals and field width. Right aligned
+field is padded with spaces in front, left aligned one is
+as long as the number. int32_t fixedParse(const char *str,
+uint8_t decimals) takes decimal string.
+
+Output: fixedFormat writes the number to str, always with
+decimals digits after point, and returns its length. If the
+number does not fit to width chars, field is filled with '*',
+so str never needs more than width + 1 bytes (width 0 means
+FIXED_LENGTH_MAX). fixedParse returns value
+scaled by 10^decimals, rounded on the first digit that does
+not fit, and stops on the first char that is not a digit.
+
+Digits are got by subtracting powers of ten from flash table,
+not by dividing, 32 bit division on AVR is a library call of
+about 600 cycles per digit.
+
+Uses: usual avr libraries such as io.h and pgmspace.h.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "fixedPoint.h"
+
+#define FIXED_DIGITS 10
+
+const uint32_t powersOfTen[FIXED_DIGITS] PROGMEM = {
+	1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL,
+	10000UL, 1000UL, 100UL, 10UL, 1UL
+};
+/* -----------------------------------------------------
+uint8_t fixedFormat(char *str, int32_t value, uint8_t decimals, uint8_t width, bool rightAlign)
+Writes value / 10^decimals as decimal string, e.g.
+(-1205, 2) gives "-12.05" and (5, 3) gives "0.005". Returns
+number of chars written, terminator is not counted.
+-----------------------------------------------------*/
+uint8_t fixedFormat(char *str, int32_t value, uint8_t decimals, uint8_t width, bool rightAlign){
+	
+	char digits[FIXED_LENGTH_MAX];
+	uint32_t u = (value < 0) ? -(uint32_t)value : (uint32_t)value;
+	uint8_t n = 0;
+	uint8_t first = FIXED_DIGITS - 1 - decimals;
+	uint8_t i;
+	
+	if (decimals >= FIXED_DIGITS)
+	{
+		decimals = FIXED_DIGITS - 1;
+		first = 0;
+	}
+	if (value < 0)
+	{
+		digits[n++] = '-';
+	}
+	for (i = 0; i < FIXED_DIGITS; i++)
+	{
+		uint32_t power = pgm_read_dword(&powersOfTen[i]);
+		char digit = '0';
+		
+		while (u >= power)
+		{
+			u -= power;
+			digit++;
+		}
+		//leading zeros are skipped up to the one in front of point
+		if ((digit != '0') || (i >= first) || (n > (value < 0)))
+		{
+			if (i == FIXED_DIGITS - decimals)
+			{
+				digits[n++] = '.';
+			}
+			digits[n++] = digit;
+		}
+	}
+	
+	if (width == 0)
+	{
+		width = FIXED_LENGTH_MAX;
+		rightAlign = false;
+	}
+	if (n > width)
+	{
+		for (i = 0; i < width; i++)
+		{
+			str[i] = '*';
+		}
+		str[width] = '\0';
+		return width;
+	}
+	i = 0;
+	if (rightAlign)
+	{
+		while (i < width - n)
+		{
+			str[i++] = ' ';
+		}
+	}
+	for (uint8_t j = 0; j < n; j++)
+	{
+		str[i++] = digits[j];
+	}
+	str[i] = '\0';
+	return i;
+}
+/* -----------------------------------------------------
+int32_t fixedParse(const char *str, uint8_t decimals)
+Reads decimal string such as " -12.5" to value scaled by
+10^decimals (-1250 for two decimals). Leading spaces are
+skipped, value saturates instead of overflowing.
+-----------------------------------------------------*/
+int32_t fixedParse(const char *str, uint8_t decimals){
+	
+	uint32_t u = 0;
+	bool negative = false;
+	bool point = false;
+	bool overflow = false;
+	uint8_t fraction = 0;
+	char c;
+	
+	while (*str == ' ')
+	{
+		str++;
+	}
+	if ((*str == '-') || (*str == '+'))
+	{
+		negative = (*str == '-');
+		str++;
+	}
+	for (; (c = *str) != '\0'; str++)
+	{
+		if ((c == '.') && !point)
+		{
+			point = true;
+			continue;
+		}
+		if ((c < '0') || (c > '9'))
+		{
+			break;
+		}
+		if (point && (fraction == decimals))
+		{
+			//first digit that does not fit rounds the value
+			if (c >= '5')
+			{
+				u++;
+			}
+			break;
+		}
+		if (u > (INT32_MAX - 9) / 10)
+		{
+			overflow = true;
+			break;
+		}
+		u = (u << 3) + (u << 1) + (c - '0');
+		if (point)
+		{
+			fraction++;
+		}
+	}
+	while (!overflow && (fraction < decimals))
+	{
+		if (u > INT32_MAX / 10)
+		{
+			overflow = true;
+		}
+		u = (u << 3) + (u << 1);
+		fraction++;
+	}
+	if (overflow || (u > INT32_MAX))
+	{
+		u = INT32_MAX;
+	}
+	return negative ? -(int32_t)u : (int32_t)u;
+}
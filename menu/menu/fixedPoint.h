@@ -0,0 +1,9 @@
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Longest string fixedFormat writes: sign, ten digits and point */
+#define FIXED_LENGTH_MAX 12
+
+extern uint8_t fixedFormat(char *str, int32_t value, uint8_t decimals, uint8_t width, bool rightAlign);
+extern int32_t fixedParse(const char *str, uint8_t decimals);
@@ -9,11 +9,21 @@ Third is the same as two previous and contains command value
 Fourth parameter is actual data that is to be sent.
 
 Output: The output is formed package which value is stored
-in global and external variable formedDataPackageToSend which
-although is defined size (100), is actually a string, so later
-it's size is determined as usual - by null terminator '\0'.
+in global and external variable formedDataPackageToSend, its
+size is stored in formedPacketLength. In binary mode package
+could contain zero bytes, so it is sent by sendPacket(), not
+as a string.
 
-Uses: USARTdriver for testing purposes, else it's self-sufficent
+Binary mode is switched on by sessionStart module when server
+accepts it at StartSession. Binary package is:
+*-(source)(destination)(command)(sequence)(lenght)(data)(CRC-16)-*
+source, destination, command and sequence are single bytes,
+every package gets next sequence number (packetSequence) and
+server echoes it in reply, lenght is varint, numeric values are 32 bit fixed point (hundredths,
+most significant byte first) and CRC-16 is two bytes.
+
+Uses: USARTdriver for testing purposes, fixedPoint for numeric
+values in ASCII mode, else it's self-sufficent
 
 Author: Ultra 2000
 Company: DTU Dipom
@@ -21,15 +31,22 @@ Version: 1.0
 Date and year: 2014/05/26
 -----------------------------------------------------*/
 #include <avr/io.h>
+#include <avr/pgmspace.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 #include "driverUSART.h"
+#include "crc16.h"
+#include "formPacket.h"
+#include "fixedPoint.h"
 
 #define STOP_CHAR1 '-'
 #define STOP_CHAR2 '*'
 
 char formedDataPackageToSend[100] = {0};
+int formedPacketLength = 0;
+bool binaryMode = false;
+uint8_t packetSequence = 0;
 
 /* -----------------------------------------------------
 bool formPacket(char _source[], char _destination[], char _command[], char _data[])
@@ -52,14 +69,24 @@ _source(2 bytes) _destination(2 bytes) _command (2 bytes) _data (undefined size)
 For input:
 formPacket("02", "01", "86", energyStr); where energyStr is "102.20"
 The output is:
+0201860006102.20(CRC-16 as 4 hex digits)-*
+or with PACKET_CRC16 set to 0:
 0201860006102.2000(xor value)-*
 -----------------------------------------------------*/
 	
 bool formPacket(char _source[], char _destination[], char _command[], char _data[]){
 	
-	memset(formedDataPackageToSend, 0, 100);
-	
 	int datalint = strlen(_data);
+	
+	if (binaryMode)
+	{
+		return formPacketBin((_source[0] - '0') * 10 + (_source[1] - '0'),
+							 (_destination[0] - '0') * 10 + (_destination[1] - '0'),
+							 (_command[0] - '0') * 10 + (_command[1] - '0'),
+							 (const uint8_t *)_data, datalint);
+	}
+	
+	memset(formedDataPackageToSend, 0, 100);
 
 	int sizeofpacket = datalint + 10;
 	
@@ -99,7 +126,20 @@ bool formPacket(char _source[], char _destination[], char _command[], char _data
 	memcpy(formedDataPackageToSend + 4, _command, 2);
 	memcpy(formedDataPackageToSend + 6, _dataLenght, 4);
 	memcpy(formedDataPackageToSend + 10, _data, datalint);
-		
+	
+#if PACKET_CRC16
+	uint16_t crc = CRC16_INIT;
+	
+	for ( int i = 0 ; i < (sizeofpacket); i ++ ) {
+		crc = crc16Update(crc, formedDataPackageToSend[i]);
+	}
+	
+	crc16ToHex(crc, formedDataPackageToSend + (10 + datalint));
+	formedDataPackageToSend[(14 + datalint)] = STOP_CHAR1;
+	formedDataPackageToSend[(15 + datalint)] = STOP_CHAR2;
+	formedDataPackageToSend[(16 + datalint)] = '\0';
+	formedPacketLength = 16 + datalint;
+#else
 	char xor = 0;
 	
 	for ( int i = 0 ; i < (sizeofpacket); i ++ ) {
@@ -112,6 +152,121 @@ bool formPacket(char _source[], char _destination[], char _command[], char _data
 	formedDataPackageToSend[(13 + datalint)] = STOP_CHAR1;
 	formedDataPackageToSend[(14 + datalint)] = STOP_CHAR2;
 	formedDataPackageToSend[(15 + datalint)] = '\0';
+	formedPacketLength = 15 + datalint;
+#endif
+	
+	return true;
+}
+/* -----------------------------------------------------
+bool formPacketBin(uint8_t _source, uint8_t _destination, uint8_t _command, const uint8_t _data[], uint8_t datalint)
+Forms binary mode package from byte sized header fields and
+datalint bytes of data. Package gets the next sequence number
+that is left in packetSequence. CRC-16 is calculated over header,
+lenght and data while they are copied. Returns false if
+data does not fit to formedDataPackageToSend.
+-----------------------------------------------------*/
+bool formPacketBin(uint8_t _source, uint8_t _destination, uint8_t _command, const uint8_t _data[], uint8_t datalint){
+	
+	if (datalint > 100 - 12)
+	{
+		return false;
+	}
+	
+	uint16_t crc = CRC16_INIT;
+	int n = 0;
+	
+	formedDataPackageToSend[n++] = STOP_CHAR2;
+	formedDataPackageToSend[n++] = STOP_CHAR1;
+	formedDataPackageToSend[n++] = _source;
+	formedDataPackageToSend[n++] = _destination;
+	formedDataPackageToSend[n++] = _command;
+	formedDataPackageToSend[n++] = ++packetSequence;
+	if (datalint < 0x80)
+	{
+		formedDataPackageToSend[n++] = datalint;
+	}else{
+		formedDataPackageToSend[n++] = (datalint & 0x7F) | 0x80;
+		formedDataPackageToSend[n++] = datalint >> 7;
+	}
+	memcpy(formedDataPackageToSend + n, _data, datalint);
+	n += datalint;
+	
+	for (int i = 2; i < n; i++)
+	{
+		crc = crc16Update(crc, formedDataPackageToSend[i]);
+	}
+	
+	formedDataPackageToSend[n++] = crc >> 8;
+	formedDataPackageToSend[n++] = crc & 0xFF;
+	formedDataPackageToSend[n++] = STOP_CHAR1;
+	formedDataPackageToSend[n++] = STOP_CHAR2;
+	formedPacketLength = n;
 	
 	return true;
+}
+/* -----------------------------------------------------
+bool formPacketFixed(char _command[], int32_t value)
+Forms package from controller (02) to server (01) with
+numeric value in hundredths. In binary mode it is sent as
+4 bytes of fixed point, in ASCII mode as decimal string
+with two decimals, e.g. 10220 is sent as "102.20".
+-----------------------------------------------------*/
+bool formPacketFixed(char _command[], int32_t value){
+	
+	if (binaryMode)
+	{
+		uint8_t bin[4];
+		putFixed32(bin, value);
+		return formPacketBin(2, 1, (_command[0] - '0') * 10 + (_command[1] - '0'), bin, 4);
+	}
+	char str[FIXED_LENGTH_MAX + 1];
+	fixedFormat(str, value, 2, 0, false);
+	return formPacket("02", "01", _command, str);
+}
+/* -----------------------------------------------------
+void sendPacket(void)
+Queues formedPacketLength bytes of formedDataPackageToSend
+to USART. Works for both modes.
+-----------------------------------------------------*/
+void sendPacket(void){
+	
+	for (int i = 0; i < formedPacketLength; i++)
+	{
+		transmitUSART(formedDataPackageToSend[i]);
+	}
+}
+/* -----------------------------------------------------
+void sendPacket_P(const char *packet)
+Queues null terminated ASCII package that is kept in flash
+(PROGMEM) to USART, byte by byte, without copying it to
+formedDataPackageToSend.
+-----------------------------------------------------*/
+void sendPacket_P(const char *packet){
+	
+	char c;
+	
+	while ((c = pgm_read_byte(packet++)) != '\0')
+	{
+		transmitUSART(c);
+	}
+}
+/* -----------------------------------------------------
+void putFixed32(uint8_t *p, int32_t value)
+Stores value to 4 bytes, most significant first.
+-----------------------------------------------------*/
+void putFixed32(uint8_t *p, int32_t value){
+	
+	p[0] = (uint32_t)value >> 24;
+	p[1] = (uint32_t)value >> 16;
+	p[2] = (uint32_t)value >> 8;
+	p[3] = (uint32_t)value;
+}
+/* -----------------------------------------------------
+int32_t getFixed32(const char *p)
+Reads 4 bytes, most significant first, as signed value.
+-----------------------------------------------------*/
+int32_t getFixed32(const char *p){
+	
+	return (int32_t)(((uint32_t)(uint8_t)p[0] << 24) | ((uint32_t)(uint8_t)p[1] << 16) |
+					 ((uint32_t)(uint8_t)p[2] << 8) | (uint8_t)p[3]);
 }
\ No newline at end of file
@@ -1,8 +1,18 @@
 #include <avr/io.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
 
 extern char formedDataPackageToSend[100];
+extern int formedPacketLength;
+extern bool binaryMode;
+extern uint8_t packetSequence;
 
-extern bool formPacket(char _source[], char _destination[], char _command[], char _data[]);
\ No newline at end of file
+extern bool formPacket(char _source[], char _destination[], char _command[], char _data[]);
+extern bool formPacketBin(uint8_t _source, uint8_t _destination, uint8_t _command, const uint8_t _data[], uint8_t datalint);
+extern bool formPacketFixed(char _command[], int32_t value);
+extern void sendPacket(void);
+extern void sendPacket_P(const char *packet);
+extern void putFixed32(uint8_t *p, int32_t value);
+extern int32_t getFixed32(const char *p);
\ No newline at end of file
@@ -31,6 +31,7 @@ void getBalance(void);
 void endSessionm(void);
 void identification(void);
 void idleWaiting(void);
+void sendExpense(void);
 
 Input: Idied flag is passed from sessionStart module when
 user was successfully identified and all the required data 
@@ -50,6 +51,14 @@ Uses: Usual avr libraries as well as other modules such as:
 "sessionStart.h"
 "adcChargingSimulation.h"
 "driverRFID.h"
+"serverRequest.h"
+"requestFrames.h"
+"eventQueue.h"
+"timerWheel.h"
+"screenTemplates.h"
+"fixedPoint.h"
+"energyMeter.h"
+"billing.h"
 
 Author: Ultra 2000
 Company: DTU Dipom
@@ -70,8 +79,18 @@ Date and year: 2014/05/26
 #include "sessionStart.h" 
 #include "adcChargingSimulation.h" 
 #include "driverRFID.h"
+#include "serverRequest.h"
+#include "requestFrames.h"
+#include "eventQueue.h"
+#include "timerWheel.h"
+#include "screenTemplates.h"
+#include "fixedPoint.h"
+#include "energyMeter.h"
+#include "billing.h"
 
-# define F_CPU 1000000UL 
+/* Time between consumption (86) and expense (87) packages in
+ASCII mode, old servers take one package at a time */
+#define OLD_SERVER_GAP_MS 500
   
 typedef enum { 
     one, 
@@ -91,8 +110,7 @@ typedef enum {
     e5 
 } event_menu; 
   
-int price; 
-char price_str[3]; 
+char price_str[7]; 
 
 /*LCD menu configuration*/  
 int menu_position = 1; 
@@ -105,7 +123,10 @@ char doneChar = 0b00000000;
 /*Other global variables and falgs*/ 
 char expenseToPayChar[8]; 
 char energyStr[8]; 
+int32_t energyFixed = 0; 
+int32_t expenseFixed = 0; 
 bool restart = false; 
+int8_t expenseTimer = NO_TIMER; 
   
 bool charged = false; 
 typedef void (*action)(); 
@@ -128,9 +149,11 @@ void charging(void);
 void getConsumption(void); 
 void getBalance(void); 
 bool waitUntilKeyPressed(char key); 
+void receivedValue(char *str, int size, int8_t request); 
 void endSessionm(void); 
 void identification(void); 
 void idleWaiting(void); 
+void sendExpense(void); 
   
         // No Action            a1                      b2              c3                      d4                      e5                 
   
@@ -143,6 +166,7 @@ stateElement_menu stateMatrix_menu[5][6] = {
 }; 
   
 event_menu  EventOccured_menu = zeroevent; 
+eventQueue menuEvents; 
   
 void  stateEval_menu(event_menu w); 
   
@@ -161,74 +185,83 @@ void stateEval_menu(event_menu w) {
 } 
 /* -----------------------------------------------------
 int main(void)
-Main function. Initiates USART, LCD, keypad and generates
-default event that is passed as parameter to state transition
-mechanism.
+Main function. Initiates USART, request packages, LCD, ms timer,
+keypad and generates default event that is passed as parameter
+to state transition mechanism. Then it is dispatch loop: polls software timers, sends
+what actions have drawn to LCD, takes posted events one by one
+and fires actions, if no event is waiting,
+the last one is evaluated again.
 -----------------------------------------------------*/  
 int main(void) 
 { 
+    uint8_t w; 
+      
     USART_Init(64); 
     lcd_init(); 
+    init_timer1(1,0); 
     sei(); 
     keypad_init(); 
     stateTransition_m(a1); 
-  
+      
+    while(true){ 
+        timerPoll(); 
+        lcdFlush(); 
+        if (!eventGet(&menuEvents, &w)) 
+        { 
+            w = EventOccured_menu; 
+        } 
+        stateEval_menu((event_menu)w); 
+    } 
 }
 /* -----------------------------------------------------
 void endSessionm(void)
 Method that works for both modes and ends a session.
 In case of online mode, it just generates data packet 
 and sends it. In case of offline mode, it prepares data
-(debt, last expense and last consumption) by copying to 
-appropriate variables and initiates RFID card writing 
-function. In both cases the last action is to restart
+(debt, last expense and last consumption) in card record 
+as fixed point and initiates RFID card writing function,
+all three are written as one card block. In both cases
+the last action is to restart
 controller in order to have a clean start with all the
-registers cleared. For that, watchdog timer is set to 15ms.
+registers cleared. Online, expense package that is still
+on its timer is sent before end of session and reset waits
+only until USART and LCD are done. For that, watchdog timer is set to 15ms.
 -----------------------------------------------------*/ 
 void endSessionm(void){ 
     lcdClear(); 
-    _delay_ms(10); 
       
     if (offline_mode && charged) 
     { 
-            GoTo(0,0); 
-            LCDPutString("You've been debited"); 
-//          GoTo(0,1); 
-//          LCDPutString("for 1500dkk"); 
-            GoTo(0,2); 
-            LCDPutString("Please use RFID card"); 
-            GoTo(0,3); 
-            LCDPutString("to recalculate"); 
+            drawScreen(SCREEN_DEBITED); 
             rfidDone = false; 
             offlineWrite = true; 
-        //  int exl = strlen(expenseToPayChar); 
-            //int enl = strlen(energyStr); 
-              
-              
-            //make a 16byte memory card block format data + 0000 
-            memset(pastEnChar, 0, 16); 
-            memset(debtChar, 0, 16); 
-            memset(pastExChar, 0, 16); 
-              
-            memcpy(pastEnChar, energyStr, 8); 
-            memcpy(pastExChar, expenseToPayChar, 8); 
-            memcpy(debtChar, expenseToPayChar, 8); 
               
+            //one binary card block, written by one command 
+            cardInfo.debt = expenseFixed; 
+            cardInfo.pastEnergy = energyFixed; 
+            cardInfo.pastExpense = expenseFixed; 
+            cardInfo.sequence++; 
               
+            lcdFlush(); 
             while (!RFIDinit(5, "write", 5)); 
             offlineWrite = false; 
             restart = true; 
             lcdClear(); 
-            LCDPutString("Logged out"); 
-            _delay_ms(100); 
+            LCDPutString_P(PSTR("Logged out")); 
+            lcdFlush(); 
+            lcdWaitIdle(); 
             wdt_enable(WDTO_15MS); 
             while(true){ 
               
             } 
           
     }else{ 
-            formPacket("02", "01","99", "EndofSession"); 
-            sendStringUSART(formedDataPackageToSend);  
+            while (timerActive(expenseTimer)) //expense goes before end of session 
+            { 
+                timerPoll(); 
+            } 
+            sendRequestFrame(FRAME_END_SESSION); 
+            flushUSART(); 
     } 
     /*if (creditDetected) 
     { 
@@ -241,8 +274,8 @@ void endSessionm(void){
     default_menu = true; 
     stMenuItem = 1; 
     menu_position = 1; 
-    _delay_ms(100); 
-    _delay_ms(100); 
+    lcdFlush(); 
+    lcdWaitIdle(); 
     wdt_enable(WDTO_15MS); 
     while(true); 
 } 
@@ -271,23 +304,20 @@ void idleWaiting(){
         wdt_enable(WDTO_15MS); 
         while(1); 
     } 
-    lcdClear(); 
-    _delay_ms(10); 
-    GoTo(0,1);
-    LCDPutString("Ultra 2000 eCharger");
-    GoTo(0,2);
-    LCDPutString("Press any key"); 
-    while (scanKeyPad()!=1); 
+    drawScreen(SCREEN_WELCOME); 
+    lcdFlush(); 
+    keypad_get(KEYPAD_FOREVER); 
     stateTransition_m(b2); 
 } 
 /* -----------------------------------------------------
 void charging(void)
 Action that is fired after used has selected menu option
 to charge. It initiates adcChargingSimulation module,
-waits for it to finish and interprets energy variable
-value, counts sum to be paid in double. If not offline,
+waits for it to finish and reads energy from energyMeter, 
+counts sum to be paid in ore (billing). If not offline, 
 sends data packages with consumption and expense to 
-server. Also puts charging summary screen template on
+server, in ASCII mode expense is sent OLD_SERVER_GAP_MS
+later by software timer, so nothing waits for it. Also puts charging summary screen template on
 LCD and waits user to confirm it. Also, adjusts menu
 configuration values so that after charging, charging 
 option is not available to choose anymore. After confirmation, 
@@ -301,57 +331,70 @@ void charging(void){
     initCharge(); 
     while(!startCharge()); 
 	
-    double sum = (double)price * (double)energy;
-	
-	int sizeofArray1 = sprintf(expenseToPayChar, "%.2f \r\n", sum); 
-	int sizeofArray2 = sprintf(energyStr, "%.2f \r\n", energy);
-	
-    snprintf(expenseToPayChar,sizeofArray1, "%.2f", sum); 
-      
-    snprintf(energyStr,sizeofArray2, "%.2f", (double)energy ); 
-    if (!offline_mode){
-        formPacket("02", "01", "86", energyStr); 
-        sendStringUSART(formedDataPackageToSend);
-		_delay_ms(500); 
-        formPacket("02", "01", "87", expenseToPayChar); 
-        sendStringUSART(formedDataPackageToSend); 
+    energyFixed = energyMeterEnergy(2); //hundredths 
+    expenseFixed = billingClose(); //ore 
+
+    billingToString(expenseToPayChar, expenseFixed, sizeof(expenseToPayChar) - 1); 
+    fixedFormat(energyStr, energyFixed, 2, sizeof(energyStr) - 1, false); 
+    if (!offline_mode){ 
+        formPacketFixed("86", energyFixed); 
+        sendPacket();
+        if (binaryMode) 
+        { 
+            sendExpense(); 
+        }else{ 
+            //old servers take one package at a time, expense is sent by timer 
+            expenseTimer = timerStart(OLD_SERVER_GAP_MS, 0, sendExpense); 
+            if (expenseTimer == NO_TIMER) 
+            { 
+                sendExpense(); 
+            } 
+        } 
     } 
     charged = true; 
     stMenuItem = 2; 
     menu_position = 2; 
     defChargMenu = true; 
-    lcdClear(); 
-    _delay_ms(5); 
-      
-    GoTo(0,0); 
-    LCDPutString("Charging's complete"); 
-    lcd_data_write(doneChar); 
-    GoTo(0,1); 
-    LCDPutString("Energy:  "); 
+    drawScreen(SCREEN_CHARGED); 
+    GoTo(19,0); 
+    LCDPutChar(doneChar); 
+    GoTo(9,1); 
     LCDPutString(energyStr); 
-    LCDPutString(" kWs"); 
-    GoTo(0,2); 
-    LCDPutString("Charged: "); 
+    LCDPutString_P(PSTR(" kWs")); 
+    GoTo(9,2); 
     LCDPutString(expenseToPayChar); 
-    LCDPutString(" dkk"); 
+    LCDPutString_P(PSTR(" dkk")); 
     GoTo(0,3); 
-    lcd_data_write(arrow); 
-    LCDPutString(" Accept"); 
+    LCDPutChar(arrow); 
+    LCDPutString_P(PSTR(" Accept")); 
     while(!waitUntilKeyPressed('A')); 
     lcdClear(); 
-    _delay_ms(5); 
     stateTransition_m(a1); 
 } 
 /* -----------------------------------------------------
+void sendExpense(void)
+Sends expense (87) package of the session. Called right after
+consumption package in binary mode, OLD_SERVER_GAP_MS later
+by software timer in ASCII mode.
+-----------------------------------------------------*/  
+void sendExpense(void){ 
+    formPacketFixed("87", expenseFixed); 
+    sendPacket(); 
+} 
+/* -----------------------------------------------------
 bool waitUntilKeyPressed(char mkey)
 Function that initiates keypad, waits for any key to be
 pressed, checks if it is equal to the parameter passed.
-If it is same, returns true, else - false.
+If it is same, returns true, else - false. Software timers
+are polled while it waits.
 -----------------------------------------------------*/  
 bool waitUntilKeyPressed(char mkey){ 
     char keyPressedm; 
-    while (scanKeyPad()!=1); 
-    keyPressedm = returnKey(); 
+    lcdFlush(); 
+    while ((keyPressedm = keypad_get(KEYPAD_NO_WAIT)) == KEYPAD_NO_KEY) 
+    { 
+        timerPoll(); 
+    } 
       
     if (keyPressedm == mkey) 
     { 
@@ -374,10 +417,9 @@ Consequently, it adjusts menu configuration values and
 generates event to shift back to menu.
 -----------------------------------------------------*/ 
 void getConsumption(void){ 
-    char consumedEnergyStr[10]; 
-    char consumedTotal[10]; 
+    char consumedEnergyStr[13]; 
+    char consumedTotal[13]; 
     lcdClear(); 
-    _delay_ms(10); 
       
     if (offline_mode) 
     { 
@@ -387,45 +429,41 @@ void getConsumption(void){
         memcpy(consumedTotal, pastExpense_, strlen(pastExpense_)); 
           
     }else{ 
-        formPacket("02", "01", "61", "SendLastConsumedEnergy"); 
-		sendStringUSART(formedDataPackageToSend); 
+        //both requests are sent at once, replies are matched as they come 
+        int8_t energyRequest = requestSend(FRAME_LAST_CONSUMED_ENERGY, 62, REQUEST_TIMEOUT_MS, REQUEST_RETRIES, REQUEST_REPEATABLE); 
+        int8_t totalRequest = requestSend(FRAME_LAST_TOTAL, 64, REQUEST_TIMEOUT_MS, REQUEST_RETRIES, REQUEST_REPEATABLE); 
 		
-		while(!packageReceived()); 
+		requestWait(energyRequest); 
+		requestWait(totalRequest); 
+		strcpy(consumedEnergyStr, "--"); //shown if there is no reply 
+		strcpy(consumedTotal, "--"); 
       
-		if (  _command == 62    ) 
+		if (  requestReplyCommand(energyRequest) == 62    ) 
 		{ 
-			memset(consumedEnergyStr, '\0', dl+1); 
-			memcpy(consumedEnergyStr, actualData, dl); 
+			receivedValue(consumedEnergyStr, 13, energyRequest); 
 		} 
       
-		formPacket("02", "01", "63", "SendLastTotal"); 
-		sendStringUSART(formedDataPackageToSend); 
-		while(!packageReceived()); 
-      
-		if (_command == 64  ) 
+		if (requestReplyCommand(totalRequest) == 64  ) 
 		{ 
-			memset(consumedTotal, '\0', dl+1); 
-			memcpy(consumedTotal, actualData, dl); 
+			receivedValue(consumedTotal, 13, totalRequest); 
 		}
+		requestRelease(energyRequest); 
+		requestRelease(totalRequest); 
     } 
       
       
-    GoTo(0,0); 
-    LCDPutString("The last consumption"); 
-    GoTo(0,1); 
-    LCDPutString("Energy:  "); 
+    drawScreen(SCREEN_LAST_CONSUMPTION); 
+    GoTo(9,1); 
     LCDPutString(consumedEnergyStr); 
-    LCDPutString(" kWs"); 
-    GoTo(0,2); 
-    LCDPutString("Charged: "); 
+    LCDPutString_P(PSTR(" kWs")); 
+    GoTo(9,2); 
     LCDPutString(consumedTotal); 
-    LCDPutString(" dkk"); 
+    LCDPutString_P(PSTR(" dkk")); 
     GoTo(14,3); 
-    lcd_data_write(arrow); 
-    LCDPutString(" Back"); 
+    LCDPutChar(arrow); 
+    LCDPutString_P(PSTR(" Back")); 
     while(!waitUntilKeyPressed('B')); 
     lcdClear(); 
-    _delay_ms(10); 
     if (!charged) 
     { 
         default_menu = true; 
@@ -447,42 +485,38 @@ Consequently, it adjusts menu configuration values and
 generates event to shift back to menu.
 -----------------------------------------------------*/  
 void getBalance(void){ 
-    char balanceStr[10]; 
+    char balanceStr[13]; 
     lcdClear(); 
-    _delay_ms(10); 
     if (offline_mode) 
     { 
         memset(balanceStr, '\0', 10); 
         memcpy(balanceStr, credit_, strlen(credit_)); 
-        GoTo(0,0); 
-        LCDPutString("Account debit"); 
+        drawScreen(SCREEN_DEBIT); 
         GoTo(0,1); 
         LCDPutString(balanceStr); 
-        LCDPutString(" Dkk"); 
+        LCDPutString_P(PSTR(" Dkk")); 
     }else{ 
-        formPacket("02", "01", "66", "SendBalance"); 
-    sendStringUSART(formedDataPackageToSend); 
-    while(!packageReceived()); 
+    int8_t balanceRequest = requestSend(FRAME_BALANCE, 67, REQUEST_TIMEOUT_MS, REQUEST_RETRIES, REQUEST_REPEATABLE); 
+    requestWait(balanceRequest); 
+    strcpy(balanceStr, "--"); //shown if there is no reply 
       
-    if (  _command == 67    ) 
+    if (  requestReplyCommand(balanceRequest) == 67    ) 
     { 
-        memset(balanceStr, '\0', dl+1); 
-        memcpy(balanceStr, actualData, dl); 
+        receivedValue(balanceStr, 13, balanceRequest); 
     }
-    GoTo(0,0); 
-    LCDPutString("Account balance"); 
+    requestRelease(balanceRequest); 
+    drawScreen(SCREEN_BALANCE); 
     GoTo(0,1); 
     LCDPutString(balanceStr); 
-    LCDPutString(" Dkk"); 
+    LCDPutString_P(PSTR(" Dkk")); 
     } 
       
       
     GoTo(14,3); 
-    lcd_data_write(arrow); 
-    LCDPutString(" Back"); 
+    LCDPutChar(arrow); 
+    LCDPutString_P(PSTR(" Back")); 
     while(!waitUntilKeyPressed('B')); 
     lcdClear(); 
-    _delay_ms(10); 
     if (!charged) 
     { 
         menu_position = 1; 
@@ -507,22 +541,22 @@ bool arrow_mov(void)
     if(default_menu){ 
         default_menu = false; 
         GoTo(0,1); 
-        lcd_data_write(arrow); 
+        LCDPutChar(arrow); 
         menu_position = 1; 
     } 
     if(charged){ 
         GoTo(0,1); 
-        lcd_data_write(doneChar); 
+        LCDPutChar(doneChar); 
     } 
     if (defChargMenu){ 
         defChargMenu = false; 
         GoTo(0,2); 
-        lcd_data_write(arrow); 
+        LCDPutChar(arrow); 
     } 
     old_menu_position = menu_position; 
   
-    while(scanKeyPad()!=1); 
-    char key = returnKey(); 
+    lcdFlush(); 
+    char key = keypad_get(KEYPAD_FOREVER); 
       
     switch(key){ 
         case 'F'  : 
@@ -568,51 +602,82 @@ bool arrow_mov(void)
             menu_position = 1; 
     } 
     GoTo(0,old_menu_position); 
-    lcd_data_write(' '); 
+    LCDPutChar(' '); 
     GoTo(0,menu_position); 
-    lcd_data_write(arrow); 
+    LCDPutChar(arrow); 
     return false; 
 } 
  /* -----------------------------------------------------
+void receivedValue(char *str, int size, int8_t request)
+Copies value from reply to the request to str as a string.
+In binary mode value is 4 bytes of fixed point and is
+converted to decimal string with two decimals, else data is
+copied as it is. At most size-1 chars are stored.
+ -----------------------------------------------------*/
+void receivedValue(char *str, int size, int8_t request){ 
+    int length = requestReplyLength(request); 
+    char *data = requestReplyData(request); 
+    if (binaryMode && (length == 4)) 
+    { 
+        fixedFormat(str, getFixed32(data), 2, size - 1, false); 
+        return; 
+    } 
+    int n = (length < size) ? length : (size - 1); 
+    memcpy(str, data, n); 
+    str[n] = '\0'; 
+} 
+ /* -----------------------------------------------------
 void stateTransition_m(event_menu curr)
-Function that passes event to "engine" and saves a 
+Function that posts event to "engine" and saves a 
 generated event that is passed as a parameter. It is very
 handy at testing stages and as generated event is stored, 
 let's stimulate state and action change from anywhere from
-this module.
+this module. Action is fired by dispatch loop in main after
+the calling one returns.
  -----------------------------------------------------*/
 void stateTransition_m(event_menu curr){ 
     EventOccured_menu = curr; 
-    stateEval_menu((event_menu)curr); 
+    eventPost(&menuEvents, curr); 
 } 
  /* -----------------------------------------------------
 void retrieve_price(void)
 Method that retrieves price value in both cases. If it is 
 offline, it takes fixed price which value is stored in 
 OFFLINE_PRICE variable. Else, sends data packet with request
-to retrieve online price form server. Latter stored in 
-price_str variable and used in menu template as well as
-to calculate totals.
+to retrieve online price form server, if server does not
+reply in time, it switches to offline mode. Price is set as 
+billing tariff in ore, used to calculate totals, and its
+text is stored in price_str variable for menu template.
  -----------------------------------------------------*/  
 void retrieve_price(void){ 
     if (offline_mode) 
     { 
-        price = OFFLINE_PRICE; 
-        itoa(price, price_str, 10); 
-        //snprintf(price_str,2, "%i \r\n", price); 
+        billingSetTariff(OFFLINE_PRICE); 
+        billingToString(price_str, tariffOre, sizeof(price_str) - 1); 
         stateTransition_m(b2); 
     } 
     else{ 
-    formPacket("02","01","50", "SendCurrentPrice"); 
-    sendStringUSART(formedDataPackageToSend); 
-    while(!packageReceived()); 
-    if ( _command == 51   ) 
+    int8_t priceRequest = requestSend(FRAME_CURRENT_PRICE, 51, REQUEST_TIMEOUT_MS, REQUEST_RETRIES, REQUEST_REPEATABLE); 
+    uint8_t priceStatus = requestWait(priceRequest); 
+    char *priceData = requestReplyData(priceRequest); 
+    if (priceStatus == REQUEST_TIMEOUT) 
     { 
-        price = atoi(actualData); //retrieve price, conv string to int and assign to the field 
-        memset(price_str, '\0', dl);  
-        memcpy(price_str, actualData, 2);//init known size string with price value as char 
+        //server is gone, continue offline with fixed price 
+        offline_mode = true; 
+        stateTransition_m(a1); 
+    } 
+    else if ( requestReplyCommand(priceRequest) == 51   ) 
+    { 
+        if (binaryMode) 
+        { 
+            billingTariffFromBinary(priceData); 
+        }else{ 
+        billingTariffFromString(priceData); //decimal string, e.g. "2.5" 
+        } 
+        billingToString(price_str, tariffOre, sizeof(price_str) - 1); 
         stateTransition_m(b2); 
     } 
+    requestRelease(priceRequest); //only after reply data is used 
       
     } 
 } 
@@ -625,33 +690,21 @@ check option, there is deposit check option where the
 value is taken from RFID.
  -----------------------------------------------------*/    
 void draw_menu(void){ 
-    lcdClear(); 
-    _delay_ms(10); 
-    //Header 
-    GoTo(5,0); 
-    LCDPutString("Price "); 
-    GoTo(11,0); 
+    //Header, second and third line 
+    drawScreen(SCREEN_MENU); 
+    GoTo(7,0); 
     LCDPutString(price_str); 
-    GoTo(13,0); 
-    LCDPutString("dkk/kWs"); 
-      
-    //Second line 
-    GoTo(1,1); 
-    LCDPutString("Charge"); 
-  
-    //Third line 
-    GoTo(1,2); 
-    LCDPutString("Consumption"); 
-      
+    LCDPutString_P(PSTR("dkk/kWs")); 
+
     //fourth line 
     GoTo(1,3); 
-      
+
     if (offline_mode) 
     { 
-        LCDPutString("Debit");   
+        LCDPutString_P(PSTR("Debit")); 
     }else{ 
-      
-    LCDPutString("Balance"); 
+
+    LCDPutString_P(PSTR("Balance")); 
     } 
     while(!arrow_mov()); 
 }
\ No newline at end of file
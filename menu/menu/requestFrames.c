@@ -0,0 +1,93 @@
+/*---------------------------------------------------------
+Purpose: The purpose of this module is to keep requests that
+controller sends with constant data (price, balance, session
+start and end...) as ready made ASCII packages in flash, so
+they are neither built at run time nor copied to SRAM. Package
+is streamed from flash to USART as it is.
+
+Input: void sendRequestFrame(uint8_t frame)
+Index of the package (FRAME_... in requestFrames.h).
+
+Output: Package is queued to USART. In binary mode packages
+carry sequence number, so they can not be ready made, then
+binary package with request command and empty data is formed
+instead. uint8_t requestFrameCommand(uint8_t frame)
+returns command of the package as a number.
+
+Packages are the ones formPacket forms for source 02 and
+destination 01, complete with header (source, destination,
+command and lenght), check sum (CRC-16/CCITT of everything in
+front of it, see crc16.c) and stop chars, so sending one takes
+no calculation and no SRAM. Header and check sum are written
+by hand here, host test testRequestFrames forms every package
+from its command and data and fails if a single byte differs,
+so changed text or offer has to come with new lenght and check
+sum.
+
+Uses: "formPacket.h", "crc16.h" (PACKET_CRC16) and "driverUSART.h"
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "driverUSART.h"
+#include "crc16.h"
+#include "formPacket.h"
+#include "requestFrames.h"
+
+#if !PACKET_CRC16
+#error "Request frames are sent with CRC-16 check sum"
+#endif
+
+/* Offset of command digits in package, after source and destination */
+#define FRAME_COMMAND 4
+
+/* Complete packages: header, data, check sum and stop chars */
+const char frameCurrentPrice[] PROGMEM = "0201500016SendCurrentPrice" "B20F-*";
+const char frameStartSession[] PROGMEM = "0201220021StartSession" BINARY_OFFER NAK_OFFER "D515-*";
+const char frameEndSession[] PROGMEM = "0201990012EndofSession" "A5C6-*";
+const char frameLastConsumedEnergy[] PROGMEM = "0201610022SendLastConsumedEnergy" "D0C4-*";
+const char frameLastTotal[] PROGMEM = "0201630013SendLastTotal" "140C-*";
+const char frameBalance[] PROGMEM = "0201660011SendBalance" "9D78-*";
+
+PGM_P const requestFrames[FRAME_COUNT] PROGMEM = {
+	frameCurrentPrice,
+	frameStartSession,
+	frameEndSession,
+	frameLastConsumedEnergy,
+	frameLastTotal,
+	frameBalance
+};
+
+/* -----------------------------------------------------
+uint8_t requestFrameCommand(uint8_t frame)
+Reads two command digits of the package from flash and
+returns them as number, e.g. 50 for FRAME_CURRENT_PRICE.
+-----------------------------------------------------*/
+uint8_t requestFrameCommand(uint8_t frame){
+	
+	PGM_P p = (PGM_P)pgm_read_word(&requestFrames[frame]);
+	
+	return (pgm_read_byte(p + FRAME_COMMAND) - '0') * 10 + (pgm_read_byte(p + FRAME_COMMAND + 1) - '0');
+}
+/* -----------------------------------------------------
+void sendRequestFrame(uint8_t frame)
+Queues package to USART in ASCII mode, straight from flash
+as it is. Forms binary request (next sequence number, no
+data) and sends it in binary mode.
+-----------------------------------------------------*/
+void sendRequestFrame(uint8_t frame){
+	
+	if (binaryMode)
+	{
+		formPacketBin(2, 1, requestFrameCommand(frame), 0, 0);
+		sendPacket();
+		return;
+	}
+	sendPacket_P((PGM_P)pgm_read_word(&requestFrames[frame]));
+}
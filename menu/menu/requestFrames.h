@@ -0,0 +1,20 @@
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <stdint.h>
+
+/* Data that controller adds to StartSession to offer binary mode */
+#define BINARY_OFFER ";BIN2"
+/* Data that controller adds to StartSession to offer NAK (08) */
+#define NAK_OFFER ";NAK"
+
+/* Precomputed request packages, index to requestFrames table */
+#define FRAME_CURRENT_PRICE 0
+#define FRAME_START_SESSION 1
+#define FRAME_END_SESSION 2
+#define FRAME_LAST_CONSUMED_ENERGY 3
+#define FRAME_LAST_TOTAL 4
+#define FRAME_BALANCE 5
+#define FRAME_COUNT 6
+
+extern uint8_t requestFrameCommand(uint8_t frame);
+extern void sendRequestFrame(uint8_t frame);
@@ -0,0 +1,160 @@
+/*---------------------------------------------------------
+Purpose: The purpose of this module is to keep constant parts
+of LCD screens (titles, labels, menu items) in flash. String
+literals passed to LCDPutString are copied to SRAM at start up,
+texts here are read from flash as they are drawn, so they do
+not take place from the buffers.
+
+Input: void drawScreen(uint8_t screen)
+Index of the screen (SCREEN_... in screenTemplates.h).
+
+Output: LCD shadow is cleared and every line of the template
+is drawn with one cursor set. Values (price, energy, PIN...)
+are put on top of template by the caller, the same way as
+before.
+
+Every screen is a list of screenLine ending with a line
+without text. Texts that appear on several screens are kept
+once.
+
+Uses: "driverLCD.h"
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <stdint.h>
+#include "driverLCD.h"
+#include "screenTemplates.h"
+
+const char textWelcome[] PROGMEM = "Ultra 2000 eCharger";
+const char textPressAnyKey[] PROGMEM = "Press any key";
+const char textTitle[] PROGMEM = "Ultra 2000 eCharge";
+const char textOffline[] PROGMEM = "System's offline";
+const char textUseCard[] PROGMEM = "Use your RFID card";
+const char textNoConnection[] PROGMEM = "No connection";
+const char textFixedPrice[] PROGMEM = "Offline, fixed price";
+const char textEnterPin[] PROGMEM = "Enter PIN:";
+const char textBlocked[] PROGMEM = "Access is blocked";
+const char textWrongPin[] PROGMEM = "Wrong PIN input 3x";
+const char textPrice[] PROGMEM = "Price ";
+const char textCharge[] PROGMEM = "Charge";
+const char textConsumption[] PROGMEM = "Consumption";
+const char textEnergyMws[] PROGMEM = "Energy:          mWs";
+const char textPowerMw[] PROGMEM = "Power:           mW";
+const char textProgress[] PROGMEM = "Charging progress:";
+const char textComplete[] PROGMEM = "Charging's complete";
+const char textEnergy[] PROGMEM = "Energy:  ";
+const char textCharged[] PROGMEM = "Charged: ";
+const char textLastConsumption[] PROGMEM = "The last consumption";
+const char textDebit[] PROGMEM = "Account debit";
+const char textBalance[] PROGMEM = "Account balance";
+const char textDebited[] PROGMEM = "You've been debited";
+const char textPleaseUseCard[] PROGMEM = "Please use RFID card";
+const char textRecalculate[] PROGMEM = "to recalculate";
+
+const screenLine screenWelcome[] PROGMEM = {
+	{0, 1, textWelcome},
+	{0, 2, textPressAnyKey},
+	{0, 0, 0}
+};
+const screenLine screenOffline[] PROGMEM = {
+	{0, 0, textTitle},
+	{0, 1, textOffline},
+	{0, 2, textUseCard},
+	{0, 0, 0}
+};
+const screenLine screenRfid[] PROGMEM = {
+	{0, 0, textTitle},
+	{0, 1, textUseCard},
+	{0, 0, 0}
+};
+const screenLine screenFixedPrice[] PROGMEM = {
+	{0, 0, textNoConnection},
+	{0, 1, textFixedPrice},
+	{0, 0, 0}
+};
+const screenLine screenPin[] PROGMEM = {
+	{0, 0, textEnterPin},
+	{0, 0, 0}
+};
+const screenLine screenBlocked[] PROGMEM = {
+	{0, 0, textBlocked},
+	{0, 2, textWrongPin},
+	{0, 0, 0}
+};
+const screenLine screenMenu[] PROGMEM = {
+	{1, 0, textPrice},
+	{1, 1, textCharge},
+	{1, 2, textConsumption},
+	{0, 0, 0}
+};
+const screenLine screenCharging[] PROGMEM = {
+	{0, 0, textEnergyMws},
+	{0, 1, textPowerMw},
+	{0, 2, textProgress},
+	{0, 0, 0}
+};
+const screenLine screenCharged[] PROGMEM = {
+	{0, 0, textComplete},
+	{0, 1, textEnergy},
+	{0, 2, textCharged},
+	{0, 0, 0}
+};
+const screenLine screenLastConsumption[] PROGMEM = {
+	{0, 0, textLastConsumption},
+	{0, 1, textEnergy},
+	{0, 2, textCharged},
+	{0, 0, 0}
+};
+const screenLine screenDebit[] PROGMEM = {
+	{0, 0, textDebit},
+	{0, 0, 0}
+};
+const screenLine screenBalance[] PROGMEM = {
+	{0, 0, textBalance},
+	{0, 0, 0}
+};
+const screenLine screenDebited[] PROGMEM = {
+	{0, 0, textDebited},
+	{0, 2, textPleaseUseCard},
+	{0, 3, textRecalculate},
+	{0, 0, 0}
+};
+
+const screenLine * const screens[SCREEN_COUNT] PROGMEM = {
+	screenWelcome,
+	screenOffline,
+	screenRfid,
+	screenFixedPrice,
+	screenPin,
+	screenBlocked,
+	screenMenu,
+	screenCharging,
+	screenCharged,
+	screenLastConsumption,
+	screenDebit,
+	screenBalance,
+	screenDebited
+};
+/* -----------------------------------------------------
+void drawScreen(uint8_t screen)
+Clears LCD shadow and draws every line of the template,
+reading position and text of the line from flash.
+-----------------------------------------------------*/
+void drawScreen(uint8_t screen){
+	
+	const screenLine *line = (const screenLine *)pgm_read_word(&screens[screen]);
+	PGM_P text;
+	
+	lcdClear();
+	while ((text = (PGM_P)pgm_read_word(&line->text)) != 0)
+	{
+		GoTo(pgm_read_byte(&line->x), pgm_read_byte(&line->y));
+		LCDPutString_P(text);
+		line++;
+	}
+}
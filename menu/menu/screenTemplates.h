@@ -0,0 +1,28 @@
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <stdint.h>
+
+/* Screen templates, index to screens table */
+#define SCREEN_WELCOME 0
+#define SCREEN_OFFLINE 1
+#define SCREEN_RFID 2
+#define SCREEN_FIXED_PRICE 3
+#define SCREEN_PIN 4
+#define SCREEN_BLOCKED 5
+#define SCREEN_MENU 6
+#define SCREEN_CHARGING 7
+#define SCREEN_CHARGED 8
+#define SCREEN_LAST_CONSUMPTION 9
+#define SCREEN_DEBIT 10
+#define SCREEN_BALANCE 11
+#define SCREEN_DEBITED 12
+#define SCREEN_COUNT 13
+
+/* Constant text of one line: where it starts and what it says */
+typedef struct {
+	uint8_t x;
+	uint8_t y;
+	PGM_P text;
+} screenLine;
+
+extern void drawScreen(uint8_t screen);
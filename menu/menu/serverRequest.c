@@ -0,0 +1,398 @@
+/*---------------------------------------------------------
+Purpose: The purpose of this module is to let a number of
+requests to server be sent one after another without waiting
+for each reply, and to never wait for a reply forever. Every
+request takes a place in pending request table and received
+packages are matched to it: by sequence number in binary mode
+and by expected reply command in ASCII mode, where packages
+have no sequence number. In ASCII mode every request also
+counts replies it is still owed (one per package sent), so a
+late reply to a repeat is dropped even after the request is
+answered, timed out or released, and it never answers a package
+that has begun arriving before the request was sent, so a
+duplicated reply is not taken by the next request with the
+same command. Every request has its own deadline.
+If reply does not arrive in time, repeatable request is sent
+again with doubled timeout, request that is sent once
+(REQUEST_ONCE) is only waited for with doubled timeout, so
+its late reply is still taken. When repeats are used up,
+request is finished with REQUEST_TIMEOUT status.
+Corrupted package is never a reason to send anything again,
+it could be a reply to any request. It is NAKed at once when
+it is polled and server repeats its last package, deadlines
+keep running meanwhile, so lost repeat is handled like any
+lost reply.
+
+Input: int8_t requestSend(uint8_t frame, uint8_t replyCommand, uint16_t timeoutMs, uint8_t retries, bool repeatable)
+Request package kept in flash (FRAME_... of requestFrames.h),
+command of expected reply (or ANY_REPLY), time in ms to wait
+for reply, number of repeats and whether request could be
+sent again (REQUEST_REPEATABLE or REQUEST_ONCE). requestSendData takes command
+and data that are formed at run time (see formPacket) instead
+of ready made package. Both return handle
+of the request or -1 if table is full. Time is taken from
+getTick() of driverTimer, so timer 1 must be running.
+
+Output: uint8_t requestStatus(int8_t handle) tells whether reply
+has arrived (REQUEST_OK), has not yet (REQUEST_PENDING) or will
+not (REQUEST_TIMEOUT). uint8_t requestWait(int8_t handle) waits
+until it is not pending. Reply is read through
+requestReplyCommand, requestReplyData (null terminated string)
+and requestReplyLength. Handle is given back with
+requestRelease.
+
+Uses: "formPacket.h", "requestFrames.h", "dataReceive.h" and
+"driverTimer.h"
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "formPacket.h"
+#include "requestFrames.h"
+#include "dataReceive.h"
+#include "driverTimer.h"
+#include "serverRequest.h"
+
+/* Frame of request that is formed at run time */
+#define NO_FRAME -1
+
+typedef struct {
+	bool used;
+	int8_t frame;
+	uint8_t status;
+	uint8_t sequence;
+	uint8_t expectedCommand;
+	uint8_t replyCommand;
+	uint8_t retries;
+	bool repeatable;
+	uint8_t owed;		//packages sent and not answered yet, ASCII mode
+	uint16_t rxMark;	//rxPosition() when request was first sent
+	uint16_t sentAt;
+	uint16_t timeout;
+	char command[3];
+	char *text;
+	uint8_t length;
+	char data[REPLY_DATA_MAX + 1];
+} pendingRequest;
+
+pendingRequest pendingRequests[MAX_PENDING];
+uint16_t unmatchedReplies = 0;
+bool nakMode = false;
+
+int8_t requestStart(int8_t frame, char _command[], char _text[], uint8_t replyCommand, uint16_t timeoutMs, uint8_t retries, bool repeatable);
+void requestTransmit(pendingRequest *r);
+bool replyMatches(pendingRequest *r);
+bool replyOwed(pendingRequest *r);
+void nakSend(int reason);
+/* -----------------------------------------------------
+int8_t requestSend(uint8_t frame, uint8_t replyCommand, uint16_t timeoutMs, uint8_t retries, bool repeatable)
+int8_t requestSendData(char _command[], char _data[], uint8_t replyCommand, uint16_t timeoutMs, uint8_t retries, bool repeatable)
+Take free place in pending request table, send request
+package and queue it to USART. Return at once with handle
+of the request, or -1 if there is no free place. Place of
+released request that is still owed replies is taken only
+if there is no other, its late replies are then forgotten.
+Data must stay in place until request is released, as it is
+sent again on repeat.
+-----------------------------------------------------*/
+int8_t requestSend(uint8_t frame, uint8_t replyCommand, uint16_t timeoutMs, uint8_t retries, bool repeatable)
+{
+	return requestStart(frame, "", "", replyCommand, timeoutMs, retries, repeatable);
+}
+
+int8_t requestSendData(char _command[], char _data[], uint8_t replyCommand, uint16_t timeoutMs, uint8_t retries, bool repeatable)
+{
+	return requestStart(NO_FRAME, _command, _data, replyCommand, timeoutMs, retries, repeatable);
+}
+
+int8_t requestStart(int8_t frame, char _command[], char _text[], uint8_t replyCommand, uint16_t timeoutMs, uint8_t retries, bool repeatable)
+{
+	for (int8_t h = 0; h < 2 * MAX_PENDING; h++)
+	{
+		pendingRequest *r = &pendingRequests[h % MAX_PENDING];
+		
+		if (!r->used && ((r->owed == 0) || (h >= MAX_PENDING)))
+		{
+			r->used = true;
+			r->frame = frame;
+			strncpy(r->command, _command, 2);
+			r->command[2] = '\0';
+			r->text = _text;
+			r->expectedCommand = replyCommand;
+			r->replyCommand = 0;
+			r->timeout = timeoutMs;
+			r->retries = retries;
+			r->repeatable = repeatable;
+			r->length = 0;
+			r->data[0] = '\0';
+			r->owed = 0;
+			r->rxMark = rxPosition();
+			requestTransmit(r);
+			return h % MAX_PENDING;
+		}
+	}
+	return -1;
+}
+/* -----------------------------------------------------
+void requestTransmit(pendingRequest *r)
+Queues ready made request package from flash or forms and
+queues the one with run time data, notes its sequence number,
+the time it was sent and one more reply owed.
+-----------------------------------------------------*/
+void requestTransmit(pendingRequest *r)
+{
+	if (r->frame != NO_FRAME)
+	{
+		sendRequestFrame(r->frame);
+	}else{
+		formPacket("02", "01", r->command, r->text);
+		sendPacket();
+	}
+	r->status = REQUEST_PENDING;
+	r->sequence = packetSequence;
+	r->sentAt = getTick();
+	if (r->owed < 0xFF)
+	{
+		r->owed++;
+	}
+}
+/* -----------------------------------------------------
+bool replyMatches(pendingRequest *r)
+Checks whether the last received package is reply to the
+request r. Binary mode replies carry request sequence number,
+ASCII ones are recognised by command, package that has begun
+before the request was sent is not its reply.
+-----------------------------------------------------*/
+bool replyMatches(pendingRequest *r)
+{
+	if (!r->used || (r->status != REQUEST_PENDING))
+	{
+		return false;
+	}
+	if (binaryMode)
+	{
+		return (_sequence == r->sequence);
+	}
+	if ((int16_t)(_first - r->rxMark) < 0)
+	{
+		return false;
+	}
+	return ((r->expectedCommand == ANY_REPLY) || (r->expectedCommand == _command));
+}
+/* -----------------------------------------------------
+bool replyOwed(pendingRequest *r)
+Checks whether the last received package is a late reply
+to request r that is not pending any more (answered, timed
+out or released) but was sent more times than answered.
+ASCII mode only, binary replies are told by sequence number.
+-----------------------------------------------------*/
+bool replyOwed(pendingRequest *r)
+{
+	if (binaryMode || (r->owed == 0) || (r->used && (r->status == REQUEST_PENDING)))
+	{
+		return false;
+	}
+	return ((r->expectedCommand == ANY_REPLY) || (r->expectedCommand == _command));
+}
+/* -----------------------------------------------------
+void requestPoll(void)
+Takes every received package and copies it to the pending
+request it replies to. Late replies owed to requests that are
+not pending (replyOwed) are taken first, as they were asked
+for earlier. They and packages that match no request (late
+or duplicated replies) are counted in unmatchedReplies and
+dropped. Corrupted package is NAKed here, nobody has to wait
+for it, and deadlines are checked as usual: if the repeat is
+lost as well, request is sent again or times out on its own
+deadline. Then every request whose own time is up is sent again (if repeatable)
+or waited for longer, with doubled timeout, or, if there are
+no repeats left, finished with REQUEST_TIMEOUT. Late
+replies are waited for one timeout after the last package
+was sent, or after timeout, then they are forgotten.
+-----------------------------------------------------*/
+void requestPoll(void)
+{
+	while (receivePackage())
+	{
+		bool matched = false;
+		
+		if (_status != RX_OK)
+		{
+			nakSend(_status);
+			continue;
+		}
+		for (int8_t h = 0; h < MAX_PENDING; h++)
+		{
+			pendingRequest *r = &pendingRequests[h];
+			
+			if (replyOwed(r))
+			{
+				r->owed--;
+				matched = true;
+				unmatchedReplies++;
+				break;
+			}
+		}
+		for (int8_t h = 0; (h < MAX_PENDING) && !matched; h++)
+		{
+			pendingRequest *r = &pendingRequests[h];
+			
+			if (replyMatches(r))
+			{
+				if (r->owed > 0)
+				{
+					r->owed--;
+				}
+				r->length = (dl < REPLY_DATA_MAX) ? dl : REPLY_DATA_MAX;
+				memcpy(r->data, actualData, r->length);
+				r->data[r->length] = '\0';
+				r->replyCommand = _command;
+				r->status = REQUEST_OK;
+				matched = true;
+				break;
+			}
+		}
+		if (!matched)
+		{
+			unmatchedReplies++;
+		}
+	}
+	
+	uint16_t now = getTick();
+	
+	for (int8_t h = 0; h < MAX_PENDING; h++)
+	{
+		pendingRequest *r = &pendingRequests[h];
+		
+		if (!r->used || (r->status != REQUEST_PENDING))
+		{
+			if ((r->owed > 0) && ((uint16_t)(now - r->sentAt) >= r->timeout))
+			{
+				r->owed = 0;
+			}
+			continue;
+		}
+		if ((uint16_t)(now - r->sentAt) >= r->timeout)
+		{
+			if (r->retries == 0)
+			{
+				r->status = REQUEST_TIMEOUT;
+				r->sentAt = now;
+				continue;
+			}
+			r->retries--;
+			r->timeout = (r->timeout < 0x8000) ? (r->timeout << 1) : 0xFFFF;
+			if (r->repeatable)
+			{
+				requestTransmit(r);
+			}else{
+				r->sentAt = now;
+			}
+		}
+	}
+}
+/* -----------------------------------------------------
+uint8_t requestStatus(int8_t handle)
+Polls received packages and timeouts and returns status of
+the request: REQUEST_PENDING, REQUEST_OK or REQUEST_TIMEOUT.
+-----------------------------------------------------*/
+uint8_t requestStatus(int8_t handle)
+{
+	if (handle < 0)
+	{
+		return REQUEST_TIMEOUT;
+	}
+	requestPoll();
+	return pendingRequests[handle].status;
+}
+/* -----------------------------------------------------
+uint8_t requestWait(int8_t handle)
+Waits until reply to the request arrives or time is up and
+returns status. Replies to other pending requests are stored
+meanwhile.
+-----------------------------------------------------*/
+uint8_t requestWait(int8_t handle)
+{
+	uint8_t status;
+	
+	while ((status = requestStatus(handle)) == REQUEST_PENDING);
+	return status;
+}
+/* -----------------------------------------------------
+void nakSend(int reason)
+Sends NAK (command 08) for the last package that could not
+be used, if server accepted it at StartSession (nakMode).
+Data is "NAK" and reason digit: 0 - unexpected command,
+3 - wrong check sum (see _status values in dataReceive.h).
+Old server gets "RepeatLastPacket" (command 09) instead.
+-----------------------------------------------------*/
+void nakSend(int reason)
+{
+	char nak[5] = "NAK0";
+	
+	nak[3] = (char)('0' + reason);
+	if (nakMode)
+	{
+		formPacket("02", "01", "08", nak);
+	}else{
+		formPacket("02", "01", "09", "RepeatLastPacket");
+	}
+	sendPacket();
+}
+/* -----------------------------------------------------
+void requestNak(int8_t handle)
+NAKs the last package, that was received well but could
+not be used (unexpected command). Server repeats its last
+package by itself, so request is made pending again, with
+new deadline and one more reply owed, but is not sent.
+Handle could be -1 if nothing is waited for.
+-----------------------------------------------------*/
+void requestNak(int8_t handle)
+{
+	nakSend(_status);
+	if (handle < 0)
+	{
+		return;
+	}
+	pendingRequests[handle].status = REQUEST_PENDING;
+	pendingRequests[handle].sentAt = getTick();
+	pendingRequests[handle].owed++;
+}
+/* -----------------------------------------------------
+Getters for reply of the request. Command is the one that
+reply has arrived with (0 if there is no reply), data is null
+terminated.
+-----------------------------------------------------*/
+uint8_t requestReplyCommand(int8_t handle)
+{
+	return (handle < 0) ? 0 : pendingRequests[handle].replyCommand;
+}
+
+char *requestReplyData(int8_t handle)
+{
+	return (handle < 0) ? "" : pendingRequests[handle].data;
+}
+
+uint8_t requestReplyLength(int8_t handle)
+{
+	return (handle < 0) ? 0 : pendingRequests[handle].length;
+}
+/* -----------------------------------------------------
+void requestRelease(int8_t handle)
+Frees place of the request in pending request table. In
+ASCII mode the place still takes late replies the request
+is owed, until they are due (see requestPoll).
+-----------------------------------------------------*/
+void requestRelease(int8_t handle)
+{
+	if (handle >= 0)
+	{
+		pendingRequests[handle].used = false;
+	}
+}
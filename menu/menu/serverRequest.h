@@ -0,0 +1,38 @@
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Number of requests that could wait for reply at once */
+#define MAX_PENDING 4
+/* Bytes of reply data that are kept for every request */
+#define REPLY_DATA_MAX 16
+/* Reply command that matches any reply */
+#define ANY_REPLY 0
+/* Default time to wait for reply and number of repeats,
+every repeat waits twice as long as the one before */
+#define REQUEST_TIMEOUT_MS 1000
+#define REQUEST_RETRIES 2
+/* Whether request may be sent again when reply is late. Queries
+may, requests that change something on server (card login, PIN
+check) are sent once and their reply is only waited for longer */
+#define REQUEST_REPEATABLE true
+#define REQUEST_ONCE false
+
+/* Request status */
+#define REQUEST_PENDING 0
+#define REQUEST_OK 1
+#define REQUEST_TIMEOUT 2
+
+extern uint16_t unmatchedReplies;
+extern bool nakMode;
+
+extern int8_t requestSend(uint8_t frame, uint8_t replyCommand, uint16_t timeoutMs, uint8_t retries, bool repeatable);
+extern int8_t requestSendData(char _command[], char _data[], uint8_t replyCommand, uint16_t timeoutMs, uint8_t retries, bool repeatable);
+extern void requestPoll(void);
+extern uint8_t requestStatus(int8_t handle);
+extern uint8_t requestWait(int8_t handle);
+extern void requestNak(int8_t handle);
+extern uint8_t requestReplyCommand(int8_t handle);
+extern char *requestReplyData(int8_t handle);
+extern uint8_t requestReplyLength(int8_t handle);
+extern void requestRelease(int8_t handle);
@@ -11,7 +11,7 @@ State/Event			nilEvent				a event							b event					c event						d event				e ev
 			
 			0    init		noAction    init		Welcome					Session StartSession	KeyPad		KeyPadRead		init	 noAction    init		noAction    init	 noAction		init	noAction		init	 noAction
 			1    LCD		noAction    LCD			Welcome					LCD		noAction		LCD			noAction		LCD		 noAction    LCD		noAction    LCD		 noAction		LCD		noAction		LCD		 noAction
-			2    RFID		noAction    Terminal	Send					RFID	noAction		RFID		noAction		RFID	 noAction    RFID		noAction    RFID	 noAction		RFID	noAction		RFID	 noAction
+			2    RFID		noAction    Terminal	Send					RFID	noAction		RFID		noAction		Session	 EndSession  RFID		noAction    RFID	 noAction		RFID	noAction		RFID	 noAction
 			3    KeyPad		noAction    Terminal	Send					KeyPad	noAction		KeyPad		noAction		KeyPad   noAction    KeyPad		noAction    KeyPad	 noAction		KeyPad  noAction		KeyPad	 noAction
 			4    Terminal	noAction    Terminal	Receive					KeyPad	KeyPadRead		Terminal	repeatPacket    Session  EndSession  Terminal	Receive		Session  idSessionDone  KeyPad  KeyPadRead		Terminal repeatPacket
 			5    Session	noAction    offline		idOfflineWelcome		Session repeatPacket    RFID		RFIDidRead		Session  EndSession  init		Welcome		Session  StartSession   Session idleWaitingf    Session  noAction
@@ -40,6 +40,10 @@ Input: Many inputs from modules:
 "driverRFID.h"
 "dataReceive.h"
 "formPacket.h"
+"serverRequest.h"
+"requestFrames.h"
+"eventQueue.h"
+"timerWheel.h"
 
 Output: 
 extern bool idied;
@@ -49,7 +53,7 @@ extern char pastExpense_[17];
 extern char credit_[17];
 extern char pin_s[5];
 extern bool offline_mode;
-extern int OFFLINE_PRICE;
+extern int32_t OFFLINE_PRICE;
 extern bool credited;
 extern bool deleteCreditRFID;
 
@@ -66,6 +70,13 @@ Date and year: 2014/05/26
 #include "driverRFID.h" 
 #include "dataReceive.h" 
 #include "formPacket.h" 
+#include "serverRequest.h" 
+#include "requestFrames.h" 
+#include "eventQueue.h" 
+#include "timerWheel.h" 
+#include "screenTemplates.h" 
+#include "fixedPoint.h" 
+#include "billing.h" 
 #include <util/delay.h> 
 #include <avr/io.h> 
 #include <stdio.h> 
@@ -76,6 +87,10 @@ Date and year: 2014/05/26
 #include <float.h> 
 #include <util/delay.h> 
   
+/* PIN digits and time a typed digit stays visible (ms) */ 
+#define PIN_LENGTH 4 
+#define PIN_MASK_MS 100 
+  
 typedef enum { 
     init, 
     LCD, 
@@ -100,6 +115,8 @@ typedef enum {
 } event; 
   
 char pin[5]; 
+int8_t pinMaskTimer = NO_TIMER; //masks shown digit later 
+int8_t pinMaskPos = -1;         //position of digit still shown 
 bool pinReceived = false; 
 bool rfidIdArrived = false; 
 bool requestRepeatPacket = false;    
@@ -109,10 +126,11 @@ char arrowf =   0b00000001;
 char doneCharf = 0b00000000; 
 int keyPressed = 0; 
 bool incorrectPIN = false; 
-int OFFLINE_PRICE = 15; //dkk/kWs 
+int32_t OFFLINE_PRICE = 1500; //ore per kWs, 15 dkk/kWs 
   
   
 int back; 
+int8_t replyRequest = -1; //request that Receive waits reply to 
 char id_[14]; 
 char pastEnergy_[17]; 
 char pastExpense_[17]; 
@@ -137,11 +155,13 @@ void Send(void);
 void LCDclear(void); 
 void Receive(void); 
 void KeyPadRead(void); 
+void maskPinDigit(void); 
 void RFIDidRead(void); 
 void StartSession(void); 
 void EndSession(void); 
 void repeatPacket(void); 
 void stateTransition(event curr); 
+void stateTransitionAfter(event curr, uint16_t ms); 
 void idSessionDone(void); 
 void idOfflineWelcome(void); 
 void idOfflineGetMifareInfo(void); 
@@ -155,7 +175,7 @@ void idleWaitingf(void);
 stateElement stateMatrix[7][9] = { 
 /*0 */{ {init,noAction}, {init,Welcome}, {Session,StartSession} , {KeyPad,KeyPadRead}, {init,noAction}, {init,noAction}, {init, noAction}, {init, noAction}, {init, noAction} }, 
 /*1 */{ {LCD,noAction}, {LCD,Welcome}, {LCD, noAction},{LCD,noAction}, {LCD, noAction}, {LCD, noAction}, {LCD, noAction}, {LCD, noAction}, {LCD, noAction} }, 
-/*2 */{ {RFID, noAction}, {Terminal, Send}, {RFID, noAction}, {RFID, noAction}, {RFID, noAction}, {RFID, noAction}, {RFID, noAction}, {RFID, noAction}, {RFID, noAction} }, 
+/*2 */{ {RFID, noAction}, {Terminal, Send}, {RFID, noAction}, {RFID, noAction}, {Session, EndSession}, {RFID, noAction}, {RFID, noAction}, {RFID, noAction}, {RFID, noAction} }, 
 /*3 */{ {KeyPad,noAction}, {Terminal,Send}, {KeyPad,noAction}, {KeyPad,noAction}, {KeyPad, noAction}, {KeyPad,noAction}, {KeyPad, noAction}, {KeyPad, noAction}, {KeyPad, noAction} }, 
 /*4 */{ {Terminal, noAction}, {Terminal, Receive}, {KeyPad,KeyPadRead}, {Terminal, repeatPacket}, {Session,EndSession}, {Terminal, Receive}, {Session, idSessionDone}, {KeyPad, KeyPadRead}, {Terminal, repeatPacket} }, 
 /*5 */{ {Session, noAction}, {offline, idOfflineWelcome}, {Session, repeatPacket}, {RFID, RFIDidRead}, {Session, EndSession}, {init, Welcome}, {Session, StartSession}, {Session, idleWaitingf}, {Session, noAction} }, 
@@ -164,6 +184,9 @@ stateElement stateMatrix[7][9] = {
 }; 
   
 event   EventOccured = a; 
+eventQueue sessionEvents; 
+event   delayedEvent; 
+int8_t  sessionTimer = NO_TIMER; 
   
 void  stateEval(event w); 
   
@@ -187,7 +210,7 @@ were read from RFID card and checks with one that is
 entered by user.
  -----------------------------------------------------*/ 
 void offlinePINcheck(void){ 
-    if ((pinChar[0] == pin[0]) && (pinChar[1] == pin[1]) && (pinChar[2] == pin[2]) && (pinChar[3] == pin[3])) 
+    if ((cardInfo.pin[0] == pin[0]) && (cardInfo.pin[1] == pin[1]) && (cardInfo.pin[2] == pin[2]) && (cardInfo.pin[3] == pin[3])) 
     { 
         stateTransition(g); //id session is done 
     }else{ 
@@ -204,35 +227,27 @@ output on LCD and waits for any key pressed. After it's
 pressed, fires action that starts session.
  -----------------------------------------------------*/   
 void idleWaitingf(){ 
-        lcdClear(); 
-        _delay_ms(10); 
-        GoTo(0,1);
-		LCDPutString("Ultra 2000 eCharger"); 
-        GoTo(0,2); 
-        LCDPutString("Press any key"); 
-        while (scanKeyPad()!=1); 
+        drawScreen(SCREEN_WELCOME); 
+        lcdFlush(); 
+        keypad_get(KEYPAD_FOREVER); 
         stateTransition(e); 
 } 
  /* -----------------------------------------------------
 void idOfflineGetMifareInfo(void)
 Function that gets RFID card info such as card id,
 debt that is on card, last consumption and last expense 
-and pin code. Char arrays are converted to floats in order
-to lose any trailing zeros and then stored to char arrays
-to be used at later actions and states.
+and pin code. Fixed point values of card record are
+written to char arrays to be used at later actions and
+states.
  -----------------------------------------------------*/  
 void idOfflineGetMifareInfo(void){ 
      offlineFirstRead = true; 
      rfidDone = false; 
      while(!RFIDinit(1, "64.76", 5)); 
-     //convert 16byte data to float 
-     double creditD = atof (debtChar); 
-     double pastEnergyD = atof (pastEnChar); 
-     double pastExpenseD = atof (pastExChar); 
-     //convert float to string so zeros are lost ant only float number is stored 
-    snprintf(credit_,8, "%.2f \r\n", creditD); 
-    snprintf(pastEnergy_,8, "%.2f \r\n", pastEnergyD); 
-    snprintf(pastExpense_,8, "%.2f \r\n", pastExpenseD); 
+     //card record is fixed point (hundredths) already 
+    fixedFormat(credit_, cardInfo.debt, CARD_DATA_DECIMALS, 7, false); 
+    fixedFormat(pastEnergy_, cardInfo.pastEnergy, CARD_DATA_DECIMALS, 7, false); 
+    fixedFormat(pastExpense_, cardInfo.pastExpense, CARD_DATA_DECIMALS, 7, false); 
       
     stateTransition(b); 
 } 
@@ -243,13 +258,7 @@ there is evidence of lost connection with server and
 offline mode is on.
  -----------------------------------------------------*/    
 void idOfflineWelcome(void){ 
-        lcdClear(); 
-        _delay_ms(3); 
-        LCDPutString("Ultra 2000 eCharge"); 
-        GoTo(0,1); 
-        LCDPutString("System's offline"); 
-        GoTo(0,2); 
-        LCDPutString("Use your RFID card"); 
+        drawScreen(SCREEN_OFFLINE); 
         stateTransition(a); 
       
 }
@@ -257,18 +266,35 @@ void idOfflineWelcome(void){
 bool id(void) 
 This is an "engine" function of this mechanism. It returns 
 true when id process is done, offline or online mode.
-Also initiates USART, LCD and keypad modules. Stimulates
-actions and states according to generated events.
+Also initiates USART, LCD and keypad modules. Sends what
+actions have drawn to LCD, takes events that actions have
+posted one by one and stimulates actions
+and states according to them. If no event is waiting, the
+last one is evaluated again, unless event is scheduled by
+stateTransitionAfter, then it polls timers until it comes.
  -----------------------------------------------------*/     
 bool id(void) 
 { 
+    uint8_t w; 
+      
     USART_Init(64); 
     lcd_init(); 
     sei(); 
     keypad_init(); 
       
+    eventQueueClear(&sessionEvents); 
     while(!idied){ 
-    stateTransition(EventOccured); 
+        timerPoll(); 
+        lcdFlush(); 
+        if (!eventGet(&sessionEvents, &w)) 
+        { 
+            if (timerActive(sessionTimer)) 
+            { 
+                continue; 
+            } 
+            w = EventOccured; 
+        } 
+        stateEval((event)w); 
     } 
     return true; 
 // 
@@ -282,20 +308,40 @@ module to flag id process done.
  -----------------------------------------------------*/   
 void idSessionDone(){ 
     lcdClear(); 
-    _delay_us(5); 
     idied = true; 
 } 
  /* -----------------------------------------------------
 void stateTransition(event curr)
-Function that passes event to "engine" and saves a 
+Function that posts event to "engine" and saves a 
 generated event that is passed as a parameter. It is very
 handy at testing stages and as generated event is stored, 
 let's stimulate state and action change from anywhere from
-this module.
+this module. Action is fired after the calling one returns,
+so actions never nest.
  -----------------------------------------------------*/   
 void stateTransition(event curr){ 
     EventOccured = curr; 
-    stateEval((event)curr); 
+    eventPost(&sessionEvents, curr); 
+} 
+ /* -----------------------------------------------------
+void stateTransitionAfter(event curr, uint16_t ms)
+Function that posts event after ms milliseconds, so that
+message stays on LCD for a while without blocking. Until
+then, "engine" only polls timers. If there is no free
+timer, event is posted at once.
+ -----------------------------------------------------*/   
+void postDelayedEvent(void){ 
+    sessionTimer = NO_TIMER; 
+    stateTransition(delayedEvent); 
+} 
+  
+void stateTransitionAfter(event curr, uint16_t ms){ 
+    delayedEvent = curr; 
+    sessionTimer = timerStart(ms, 0, postDelayedEvent); 
+    if (sessionTimer == NO_TIMER) 
+    { 
+        stateTransition(curr); 
+    } 
 } 
  /* -----------------------------------------------------
 bool waitUntilKeysPressed(char fkey, char fkey1)
@@ -305,8 +351,8 @@ variable if first key is pressed, 2 if second pressed.
  -----------------------------------------------------*/    
 bool waitUntilKeysPressed(char fkey, char fkey1){ 
     char keyPressedf; 
-    while (scanKeyPad()!=1); 
-    keyPressedf = returnKey(); 
+    lcdFlush(); 
+    keyPressedf = keypad_get(KEYPAD_FOREVER); 
       
     if (keyPressedf == fkey) 
     { 
@@ -322,19 +368,20 @@ bool waitUntilKeysPressed(char fkey, char fkey1){
 } 
  /* -----------------------------------------------------
 void repeatPacket(void)
-Function that sends request to repeat last packet if 
-receiving mechanism failed to interpret it.
+Function that sends NAK (see requestNak) if receiving mechanism
+failed to interpret last packet or it was corrupted. Server
+repeats last packet, so the request is waited for again.
  -----------------------------------------------------*/    
 void repeatPacket(void){ 
-    formPacket("02", "01", "09", "RepeatLastPacket"); 
-    sendStringUSART(formedDataPackageToSend); 
     if ((back == 1)) 
     { 
         back = 0; 
+        requestNak(-1); 
         stateTransition(f); //start session 
     }  
     else
     { 
+        requestNak(replyRequest); //wait for repeated reply 
         stateTransition(a); 
     } 
 } 
@@ -343,57 +390,67 @@ void StartSession(void)
 Function that initiates session start with server by sending
 data package. If answered command is 23, it is online mode,
 if server is off and sent command is 24 - it is offline mode
-and appropriate indications are put on LCD.
+and appropriate indications are put on LCD. If server does
+not reply at all, it is offline mode as well.
+Session start also offers binary protocol: data is
+"StartSession", BINARY_OFFER and NAK_OFFER. Server that
+supports binary mode answers 23 with BINARY_OFFER in data and
+both sides switch to binary packages, the same way NAK_OFFER
+in answer switches repeat requests to NAK (08). Old server
+answers as before, ASCII packages and "RepeatLastPacket" (09)
+are kept.
  -----------------------------------------------------*/      
 void StartSession(void){ 
-    formPacket("02", "01", "22", "StartSession"); 
-    sendStringUSART(formedDataPackageToSend); 
-    while(!packageReceived()); 
+    binaryMode = false; 
+    nakMode = false; 
+    int8_t startRequest = requestSend(FRAME_START_SESSION, ANY_REPLY, REQUEST_TIMEOUT_MS, REQUEST_RETRIES, REQUEST_REPEATABLE); 
+    uint8_t startStatus = requestWait(startRequest); 
+    int reply = requestReplyCommand(startRequest); 
+      
+    if (reply == 23) 
+    { 
+        binaryMode = (strstr(requestReplyData(startRequest), BINARY_OFFER) != NULL); 
+        nakMode = (strstr(requestReplyData(startRequest), NAK_OFFER) != NULL); 
+    } 
+    requestRelease(startRequest); //reply is read, place could be taken again 
       
-    if (_command == 23) 
+    if (reply == 23) 
     { 
         GoTo(0,2); 
-        LCDPutString("Connected");//To RFID 
+        LCDPutString_P(PSTR("Connected"));//To RFID 
         stateTransition(c); 
     } 
       
-    else if (_command == 24) 
+    else if ((reply == 24) || (startStatus == REQUEST_TIMEOUT)) 
     { 
-        lcdClear(); 
-        _delay_ms(5); 
-        GoTo(0,0); 
-        LCDPutString("No connection"); 
-        GoTo(0,1); 
-        _delay_us(10); 
-        LCDPutString("Offline, fixed price"); 
+        drawScreen(SCREEN_FIXED_PRICE); 
         GoTo(0,2); 
-        char fixedPrice[3]; 
-        itoa(OFFLINE_PRICE, fixedPrice, 10); 
+        char fixedPrice[7]; 
+        billingToString(fixedPrice, OFFLINE_PRICE, sizeof(fixedPrice) - 1); 
         LCDPutString(fixedPrice); 
-        LCDPutString("dkk/kWs"); 
+        LCDPutString_P(PSTR("dkk/kWs")); 
         GoTo(0,3); 
-        lcd_data_write(doneCharf); 
-        LCDPutString("Accept        "); 
-        lcd_data_write(arrowf); 
-        LCDPutString("Back"); 
+        LCDPutChar(doneCharf); 
+        LCDPutString_P(PSTR("Accept        ")); 
+        LCDPutChar(arrowf); 
+        LCDPutString_P(PSTR("Back")); 
         while(!waitUntilKeysPressed('A', 'B')); 
         offline_mode = true; 
-        _delay_ms(3000); 
         //To RFID, fixed price, offline mode 
         if (keyPressed == 1) 
         { 
-            stateTransition(a); 
+            stateTransitionAfter(a, 3000); 
         }else if (keyPressed == 2) 
         { 
-            stateTransition(d); 
+            stateTransitionAfter(d, 3000); 
         } 
           
     } 
     else
     { 
         //Repead data packet 
-        stateTransition(b); 
         back = 1; 
+        stateTransition(b); 
     } 
 } 
  /* -----------------------------------------------------
@@ -402,8 +459,7 @@ Function that sends data package to server to initiate
 end of session and shifts to idle state.
  -----------------------------------------------------*/     
 void EndSession(void){ 
-    formPacket("02", "01", "99", "EndofSession"); 
-    sendStringUSART(formedDataPackageToSend); 
+    sendRequestFrame(FRAME_END_SESSION); 
     //Welcome 
     stateTransition(g); 
 } 
@@ -417,16 +473,12 @@ Welcome screen function that puts a couple of text lines
 on welcome screen and generates event to shift states.
  -----------------------------------------------------*/   
 void Welcome(void){ 
-    lcdClear(); 
-    _delay_ms(5); 
-    LCDPutString("Ultra 2000 eCharge"); 
-    GoTo(0,1); 
-    LCDPutString("Use your RFID card"); 
+    drawScreen(SCREEN_RFID); 
     stateTransition(b); 
 } 
 void LCDStringBye(void){ 
       
-    LCDPutString("Good Bye"); 
+    LCDPutString_P(PSTR("Good Bye")); 
 } 
 void LCDclear(void){ 
       
@@ -436,47 +488,90 @@ void LCDclear(void){
 void KeyPadRead(void)
 Method that reads pin code from keypad input. Has simple
 graphics, stores entered pin code in char array and works
-for both modes - offline and online. After pin is read,
+for both modes - offline and online. Keys are taken from
+keypad FIFO, so digits typed faster than they are shown are
+not lost. Every digit is shown and turned to '*' after
+PIN_MASK_MS by a software timer, or at once when the next
+key comes. 'C' takes back the last digit, 'B' clears all
+of them, other letters are ignored. After pin is read,
 corresponding event is generated and appropriate actions
 are fired - to check pin code.
- -----------------------------------------------------*/    
+ -----------------------------------------------------*/
 void KeyPadRead(void){ 
     //sendStringUSART("KeypadRead\n"); 
         int i = 0; 
-        lcdClear(); 
-        _delay_ms(5); 
-        GoTo(0,0); 
-        LCDPutString("Enter PIN:"); 
+        char k; 
+        drawScreen(SCREEN_PIN); 
         if (incorrectPIN) 
         { 
             GoTo(0,3); 
-            LCDPutString("Incorrect PIN"); 
+            LCDPutString_P(PSTR("Incorrect PIN")); 
         } 
-          
+         
         memset(pin, '\0', 5); 
-          
-        while (i!=4) 
+         
+        while (i!=PIN_LENGTH) 
         { 
-            if ((scanKeyPad()==1) && (i!=4)){ 
-                GoTo(i,1); 
-                char jj = returnKey(); 
-                pin[i] = jj; 
-                lcd_data_write(pin[i]); 
-                _delay_ms(100); 
+            timerPoll(); 
+            lcdFlush(); 
+            k = keypad_get(KEYPAD_NO_WAIT); 
+            if ((k >= '0') && (k <= '9')) 
+            { 
+                maskPinDigit(); 
+                pin[i] = k; 
                 GoTo(i,1); 
-                lcd_data_write('*'); 
+                LCDPutChar(k); 
+                pinMaskPos = i; 
+                pinMaskTimer = timerStart(PIN_MASK_MS, 0, maskPinDigit); 
                 i++; 
             } 
+            else if ((k == 'C') && (i > 0)) 
+            { 
+                maskPinDigit(); 
+                i--; 
+                pin[i] = '\0'; 
+                GoTo(i,1); 
+                LCDPutChar(' '); 
+            } 
+            else if (k == 'B') 
+            { 
+                maskPinDigit(); 
+                memset(pin, '\0', 5); 
+                GoTo(0,1); 
+                LCDPutString_P(PSTR("    ")); 
+                i = 0; 
+            } 
         } 
+        maskPinDigit(); 
+        lcdFlush(); 
         i=0; 
         pinReceived = true; 
         if (currentState == offline) 
         { 
             stateTransition(c); 
         }else{ 
-        stateTransition(a);  
+        stateTransition(a); 
         } 
-  
+ 
+} 
+ /* -----------------------------------------------------
+void maskPinDigit(void)
+Callback of PIN mask timer, it is called directly as well
+to mask the shown digit at once. Stops the timer, so digit
+is masked only once.
+ -----------------------------------------------------*/ 
+void maskPinDigit(void){ 
+    if (pinMaskTimer != NO_TIMER) 
+    { 
+        timerStop(pinMaskTimer); 
+        pinMaskTimer = NO_TIMER; 
+    } 
+    if (pinMaskPos >= 0) 
+    { 
+        GoTo(pinMaskPos,1); 
+        LCDPutChar('*'); 
+        pinMaskPos = -1; 
+    } 
 } 
  /* -----------------------------------------------------
 void Send(void)
@@ -494,8 +589,7 @@ void Send(void){
          if(snprintf(credit_,8, "%.2f \r\n", creditgg)){ 
              sendStringUSART("detectedcredit"); 
          }*/
-        formPacket("02", "01", "10", RfidBufferToRead); 
-        sendStringUSART(formedDataPackageToSend); 
+        replyRequest = requestSendData("10", RfidBufferToRead, ANY_REPLY, REQUEST_TIMEOUT_MS, REQUEST_RETRIES, REQUEST_ONCE); 
         rfidIdArrived = false; 
         //To Receive 
         stateTransition(a); 
@@ -504,10 +598,9 @@ void Send(void){
     { 
         pinReceived = false; 
         GoTo(0,2); 
-        LCDPutString("PIN is being checked"); 
+        LCDPutString_P(PSTR("PIN is being checked")); 
       
-        formPacket("02", "01", "00", pin); 
-        sendStringUSART(formedDataPackageToSend); 
+        replyRequest = requestSendData("00", pin, ANY_REPLY, REQUEST_TIMEOUT_MS, REQUEST_RETRIES, REQUEST_ONCE); 
           
         stateTransition(e); 
     } 
@@ -522,42 +615,50 @@ initiated again, if it is 3, pin has been entered three
 times incorrectly and session is done. If command is 11,
 RFID is authorized and pin code is to be entered, if 
 command is 12, RFID card is unknown and it ends session.
-If any other command, it is not interpreted and action
-that asks to repeat data is fired.
+If any other command, or a corrupted package came, it is not
+interpreted and action that asks to repeat data is fired. If
+server does not reply in time, session is ended.
  -----------------------------------------------------*/   
 void Receive(void){ 
     //sendStringUSART("USARTreceive\n"); 
       
-    while(!packageReceived()); 
+    uint8_t status = requestWait(replyRequest); 
+    int _command = requestReplyCommand(replyRequest); 
+      
+    if (status == REQUEST_TIMEOUT) 
+    { 
+        requestRelease(replyRequest); 
+        GoTo(0,3); 
+        LCDPutString_P(PSTR("No connection")); 
+        //End Session 
+        stateTransitionAfter(d, 1000); 
+        return; 
+    } 
+    if ((_command == 1) || (_command == 2) || (_command == 3) || (_command == 11) || (_command == 12)) 
+    { 
+        requestRelease(replyRequest); 
+    } 
       
     if ( _command == 1) 
     { 
         GoTo(0,3); 
-        LCDPutString("PIN is OK"); 
-        _delay_ms(2000); 
+        LCDPutString_P(PSTR("PIN is OK")); 
         // End Session 
-        stateTransition(f); 
+        stateTransitionAfter(f, 2000); 
     }  
     else if (  _command == 2) 
     { 
         GoTo(0,3); 
-        LCDPutString("Incorrect PIN"); 
-        _delay_ms(2000); 
+        LCDPutString_P(PSTR("Incorrect PIN")); 
         //To Keypad 
-        stateTransition(g); 
+        stateTransitionAfter(g, 2000); 
     } 
       
     else if (  _command == 3) 
     { 
-        lcdClear(); 
-        _delay_ms(5); 
-        GoTo(0,0); 
-        LCDPutString("Access is blocked"); 
-        GoTo(0,2); 
-        LCDPutString("Wrong PIN input 3x"); 
-        _delay_ms(1000); 
+        drawScreen(SCREEN_BLOCKED); 
         //End Session 
-        stateTransition(f); 
+        stateTransitionAfter(f, 1000); 
     } 
       
     else if (_command == 11) 
@@ -568,10 +669,9 @@ void Receive(void){
     else if ( _command == 12) 
     { 
         GoTo(0,3); 
-        LCDPutString("Unknown card"); 
-        _delay_ms(1000); 
+        LCDPutString_P(PSTR("Unknown card")); 
         //End Session 
-        stateTransition(d); 
+        stateTransitionAfter(d, 1000); 
     } 
     else{ 
         //Repeat data 
@@ -581,7 +681,8 @@ void Receive(void){
 /* -----------------------------------------------------
 void RFIDidRead(void)
 Action that is fired while in online mode and reads RFID 
-id and debt if there was one.
+id and debt if there was one. Card whose record is corrupted
+is refused and session is ended, as in offline mode.
  -----------------------------------------------------*/    
 void RFIDidRead(void) 
 { 
@@ -590,9 +691,16 @@ void RFIDidRead(void)
     onlineFirstREad = true; 
     while (!RFIDinit(1, "uid", 3));  
     rfidDone = false; 
+    if (!cardRecordValid) 
+    { 
+        LCDPutString_P(PSTR("Card error")); 
+        //End Session 
+        stateTransitionAfter(d, 1000); 
+        return; 
+    } 
       
     rfidIdArrived = true; 
-    LCDPutString("Wait"); 
+    LCDPutString_P(PSTR("Wait")); 
     //To Send 
     stateTransition(a); 
 } 
\ No newline at end of file
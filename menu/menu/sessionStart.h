@@ -10,7 +10,7 @@ extern char pastExpense_[17];
 extern char credit_[17];
 extern char pin_s[5];
 extern bool offline_mode;
-extern int OFFLINE_PRICE;
+extern int32_t OFFLINE_PRICE;
 extern bool credited;
 extern bool deleteCreditRFID;
 
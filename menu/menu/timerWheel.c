@@ -0,0 +1,114 @@
+/*---------------------------------------------------------
+Purpose: The purpose of this module is to run functions after
+given time or every given period, so that modules do not have
+to wait in _delay_ms loops. Timers are turned by 1 ms tick of
+driverTimer and callbacks are fired from the main loop (not
+from interrupt), so they could do anything that usual code
+does: post events, write LCD, send packages.
+
+Input: int8_t timerStart(uint16_t delayMs, uint16_t periodMs, timerCallback callback)
+Time in ms until the first call, period in ms (0 - one-shot
+timer) and function to call. Returns handle of the timer or
+NO_TIMER if all TIMER_SLOTS are taken. void timerStop(int8_t handle)
+stops it, bool timerActive(int8_t handle) tells whether it
+is still waiting.
+
+Output: void timerPoll(void) must be called from every loop
+that waits for something, it fires callbacks of timers whose
+time has come. One-shot timer is free again before its
+callback is called, so callback could start it once more.
+
+Uses: "driverTimer.h", so timer 1 must be running.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "driverTimer.h"
+#include "timerWheel.h"
+
+typedef struct {
+	bool active;
+	uint16_t due;
+	uint16_t period;
+	timerCallback callback;
+} softTimer;
+
+softTimer timers[TIMER_SLOTS];
+/* -----------------------------------------------------
+int8_t timerStart(uint16_t delayMs, uint16_t periodMs, timerCallback callback)
+Takes free timer and sets it to fire after delayMs and then
+every periodMs if it is not 0. Times are up to 32767 ms, as
+tick differences are compared signed.
+-----------------------------------------------------*/
+int8_t timerStart(uint16_t delayMs, uint16_t periodMs, timerCallback callback)
+{
+	for (int8_t h = 0; h < TIMER_SLOTS; h++)
+	{
+		softTimer *t = &timers[h];
+		
+		if (!t->active)
+		{
+			t->due = getTick() + delayMs;
+			t->period = periodMs;
+			t->callback = callback;
+			t->active = true;
+			return h;
+		}
+	}
+	return NO_TIMER;
+}
+/* -----------------------------------------------------
+void timerStop(int8_t handle)
+Stops the timer, its callback is not called anymore.
+-----------------------------------------------------*/
+void timerStop(int8_t handle)
+{
+	if (handle != NO_TIMER)
+	{
+		timers[handle].active = false;
+	}
+}
+/* -----------------------------------------------------
+bool timerActive(int8_t handle)
+Tells whether timer is still running.
+-----------------------------------------------------*/
+bool timerActive(int8_t handle)
+{
+	return (handle != NO_TIMER) && timers[handle].active;
+}
+/* -----------------------------------------------------
+void timerPoll(void)
+Fires callbacks of all timers that are due. Periodic timer
+is moved by its period, if main loop was late by more than
+a period, missed calls are dropped and it continues from now.
+-----------------------------------------------------*/
+void timerPoll(void)
+{
+	uint16_t now = getTick();
+	
+	for (int8_t h = 0; h < TIMER_SLOTS; h++)
+	{
+		softTimer *t = &timers[h];
+		
+		if (!t->active || ((int16_t)(now - t->due) < 0))
+		{
+			continue;
+		}
+		if (t->period == 0)
+		{
+			t->active = false;
+		}else{
+			t->due += t->period;
+			if ((int16_t)(now - t->due) >= 0)
+			{
+				t->due = now + t->period;
+			}
+		}
+		t->callback();
+	}
+}
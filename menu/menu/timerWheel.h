@@ -0,0 +1,15 @@
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Number of software timers that could run at once */
+#define TIMER_SLOTS 8
+/* Handle of timer that is not running */
+#define NO_TIMER -1
+
+typedef void (*timerCallback)(void);
+
+extern int8_t timerStart(uint16_t delayMs, uint16_t periodMs, timerCallback callback);
+extern void timerStop(int8_t handle);
+extern bool timerActive(int8_t handle);
+extern void timerPoll(void);
@@ -0,0 +1,79 @@
+/*---------------------------------------------------------
+Purpose: ADC and timer 1 compare B for host tests of ADC
+driver. Every ms compare B matches: if auto trigger is on
+(ADATE), it starts a conversion of the channel ADMUX selects,
+then compare B interrupt runs. Finished conversion puts the
+input to ADCW and runs ADC interrupt, conversion it starts
+(ADSC) follows ADC_EMU_CONVERSION_US later.
+
+Input: void adcEmuReset(adcEmuInput input) sets function that
+gives the input of a channel at a time, time starts from 0.
+void adcEmuCompare(void) is one compare, void adcEmuRun
+(unsigned long ms) is ms of them.
+
+Output: adcEmuConversions counts conversions.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdbool.h>
+#include <avr/io.h>
+#include "fakeAdc.h"
+
+extern void TIMER1_COMPB_vect(void);
+extern void ADC_vect(void);
+
+uint32_t adcEmuNow = 0;
+unsigned long adcEmuConversions = 0;
+adcEmuInput adcEmuSource = 0;
+
+void adcEmuReset(adcEmuInput input)
+{
+	adcEmuSource = input;
+	adcEmuNow = 0;
+	adcEmuConversions = 0;
+}
+/* -----------------------------------------------------
+void adcEmuConvert(uint32_t us)
+Converts channel ADMUX selects and runs ADC interrupt, as
+long as the interrupt starts the next one.
+-----------------------------------------------------*/
+void adcEmuConvert(uint32_t us)
+{
+	do
+	{
+		ADCSRA &= ~(1<<ADSC);
+		us += ADC_EMU_CONVERSION_US;
+		ADCW = adcEmuSource(ADMUX & 0x1f, us) & 0x3ff;
+		adcEmuConversions++;
+		if (ADCSRA & (1<<ADIE))
+		{
+			ADC_vect();
+		}
+	}while ((ADCSRA & (1<<ADEN)) && (ADCSRA & (1<<ADSC)));
+}
+
+void adcEmuCompare(void)
+{
+	bool trigger = (ADCSRA & (1<<ADEN)) && (ADCSRA & (1<<ADATE));
+
+	if (TIMSK & (1<<OCIE1B))
+	{
+		TIMER1_COMPB_vect();
+	}
+	if (trigger)
+	{
+		adcEmuConvert(adcEmuNow);
+	}
+	adcEmuNow += 1000;
+}
+
+void adcEmuRun(unsigned long ms)
+{
+	while (ms-- > 0)
+	{
+		adcEmuCompare();
+	}
+}
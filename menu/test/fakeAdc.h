@@ -0,0 +1,14 @@
+#include <stdint.h>
+
+/* Conversion time at ADC clock 10 MHz / 128, us */
+#define ADC_EMU_CONVERSION_US 166
+
+/* Input of multiplexer channel at time us */
+typedef uint16_t (*adcEmuInput)(uint8_t channel, uint32_t us);
+
+extern uint32_t adcEmuNow;
+extern unsigned long adcEmuConversions;
+
+extern void adcEmuReset(adcEmuInput input);
+extern void adcEmuCompare(void);
+extern void adcEmuRun(unsigned long ms);
@@ -0,0 +1,106 @@
+/*---------------------------------------------------------
+Purpose: Keypad for host tests of keypad driver. Every ms it
+puts on PINB what encoder gives for the row set on PORTC and
+the key of the script that is down at that ms, bouncing
+contacts are open or closed at random, then keypad_tick()
+runs as timer 1 compare A interrupt would run it. It also
+owns the clock, getTick() of driverTimer is defined here.
+
+Input: void keyScript(const keyPress *presses, int n)
+presses in time order, they do not overlap. void keyRun
+(uint32_t ms) lets ms pass.
+
+Output: keyNow, ms since start.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdlib.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include "driverKeyPad.h"
+#include "fakeKeyPad.h"
+
+extern char key_table[4][4];
+
+uint32_t keyNow = 0;
+const keyPress *keyPresses = NULL;
+int keyPressCount = 0;
+int keyPressNext = 0;
+
+uint16_t getTick(void)
+{
+	keyRun(1);
+	return keyNow;
+}
+
+void keyScript(const keyPress *presses, int n)
+{
+	keyPresses = presses;
+	keyPressCount = n;
+	keyPressNext = 0;
+}
+/* -----------------------------------------------------
+bool keyContact(const keyPress *p, uint32_t ms)
+Contact of the key closed at ms.
+-----------------------------------------------------*/
+bool keyContact(const keyPress *p, uint32_t ms)
+{
+	if ((ms < p->pressMs) || (ms >= p->releaseMs + p->releaseBounceMs))
+	{
+		return false;
+	}
+	if ((ms < p->pressMs + p->pressBounceMs) || (ms >= p->releaseMs))
+	{
+		return rand() % 2;
+	}
+	return true;
+}
+/* -----------------------------------------------------
+uint8_t keyEncoder(void)
+PINB of encoder: bit 2 tells a key of selected row is down,
+bits 1 and 3 are its column.
+-----------------------------------------------------*/
+uint8_t keyEncoder(void)
+{
+	static const uint8_t columnCodes[4] = {0x02, 0x06, 0x03, 0x07};
+	uint8_t row = ((PORTC >> PC6) & 1) | (((PORTC >> PC7) & 1) << 1);	//row 1 is 00, 2 PC6, 3 PC7, 4 both
+	const keyPress *p;
+	uint8_t code;
+
+	while ((keyPressNext < keyPressCount) &&
+		   (keyNow >= keyPresses[keyPressNext].releaseMs + keyPresses[keyPressNext].releaseBounceMs))
+	{
+		keyPressNext++;
+	}
+	if (keyPressNext == keyPressCount)
+	{
+		return 0;
+	}
+	p = &keyPresses[keyPressNext];
+	if (!keyContact(p, keyNow))
+	{
+		return 0;
+	}
+	for (uint8_t column = 0; column < 4; column++)
+	{
+		if (key_table[row][column] == p->key)
+		{
+			code = columnCodes[column];
+			return ((code & 0x02) << 1) | ((code & 0x01) << 3) | ((code & 0x04) >> 1);
+		}
+	}
+	return 0;
+}
+
+void keyRun(uint32_t ms)
+{
+	while (ms-- > 0)
+	{
+		keyNow++;
+		PINB = keyEncoder();
+		keypad_tick();
+	}
+}
@@ -0,0 +1,16 @@
+#include <stdint.h>
+
+/* One scripted key press: when it starts, how long contacts
+bounce at press and at release, and when it is let go */
+typedef struct {
+	char key;
+	uint32_t pressMs;
+	uint8_t pressBounceMs;
+	uint32_t releaseMs;
+	uint8_t releaseBounceMs;
+} keyPress;
+
+extern uint32_t keyNow;
+
+extern void keyScript(const keyPress *presses, int n);
+extern void keyRun(uint32_t ms);
@@ -0,0 +1,178 @@
+/*---------------------------------------------------------
+Purpose: HD44780 display for host tests of LCD driver. It
+latches nibbles the driver puts to lcd_port: in direct mode
+(lcd_init) at the first _delay_us while E is high, in queue
+mode after every timer 2 compare interrupt that sent one.
+Nibbles are put together to commands and data the way the
+display does in 4 bit mode and data goes to DDRAM.
+
+Input: void lcdEmuNibble(uint8_t rs, uint8_t nibble) is what
+the bus carries. bool lcdEmuStep(void) fires timer 2 compare
+interrupt once if it is enabled, unsigned long
+lcdEmuDrain(void) fires it until it turns itself off and
+returns ticks (50 us) it took.
+
+Output: lcdEmuDdram, void lcdEmuVisible(char *cells) copies
+80 visible cells in shadow order (line * 20 + x).
+lcdEmuNibbles, lcdEmuBytes and lcdEmuCommands count bus
+traffic.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <string.h>
+#include <avr/io.h>
+#include "driverLCD.h"
+#include "fakeLcd.h"
+
+/* Bits of lcd_port, as in driverLCD.c */
+#define LCD_EMU_RS 2
+#define LCD_EMU_E 3
+
+extern volatile unsigned char lcdQueueHead;
+extern volatile unsigned char lcdQueueTail;
+extern volatile unsigned char lcdBusyTicks;
+extern void TIMER2_COMP_vect(void);
+
+char lcdEmuDdram[LCD_EMU_DDRAM];
+unsigned long lcdEmuNibbles = 0;
+unsigned long lcdEmuBytes = 0;
+unsigned long lcdEmuCommands = 0;
+bool lcdEmuEightBit = true;
+bool lcdEmuHigh = true;
+bool lcdEmuCgram = false;
+uint8_t lcdEmuAddress = 0;
+uint8_t lcdEmuByte = 0;
+
+const uint8_t lcdEmuLines[4] = {line_0, line_1, line_2, line_3};
+
+/* -----------------------------------------------------
+void lcdEmuReset(void)
+Display after power on: 8 bit interface, DDRAM full of
+garbage, so nothing is right by chance.
+-----------------------------------------------------*/
+void lcdEmuReset(void)
+{
+	memset(lcdEmuDdram, '?', sizeof(lcdEmuDdram));
+	lcdEmuEightBit = true;
+	lcdEmuHigh = true;
+	lcdEmuCgram = false;
+	lcdEmuAddress = 0;
+	lcdEmuNibbles = 0;
+	lcdEmuBytes = 0;
+	lcdEmuCommands = 0;
+}
+/* -----------------------------------------------------
+void lcdEmuExecute(uint8_t rs, uint8_t byte)
+Command or data byte.
+-----------------------------------------------------*/
+void lcdEmuExecute(uint8_t rs, uint8_t byte)
+{
+	lcdEmuBytes++;
+	if (rs)
+	{
+		if (!lcdEmuCgram)
+		{
+			lcdEmuDdram[lcdEmuAddress] = byte;
+			lcdEmuAddress++;
+			if (lcdEmuAddress == 0x28)
+			{
+				lcdEmuAddress = 0x40;
+			}else if (lcdEmuAddress == 0x68)
+			{
+				lcdEmuAddress = 0x00;
+			}
+		}
+		return;
+	}
+	lcdEmuCommands++;
+	if (byte & 0x80)
+	{
+		lcdEmuAddress = byte & 0x7F;
+		lcdEmuCgram = false;
+	}else if (byte & 0x40)
+	{
+		lcdEmuCgram = true;
+	}else if (byte & 0x20)
+	{
+		lcdEmuEightBit = (byte & 0x10) != 0;
+	}else if (byte & 0x02)
+	{
+		lcdEmuAddress = 0;
+		lcdEmuCgram = false;
+	}else if (byte & 0x01)
+	{
+		memset(lcdEmuDdram, ' ', sizeof(lcdEmuDdram));
+		lcdEmuAddress = 0;
+		lcdEmuCgram = false;
+	}
+}
+
+void lcdEmuNibble(uint8_t rs, uint8_t nibble)
+{
+	lcdEmuNibbles++;
+	if (lcdEmuEightBit)
+	{
+		lcdEmuExecute(rs, nibble << 4);
+		lcdEmuHigh = true;
+		return;
+	}
+	if (lcdEmuHigh)
+	{
+		lcdEmuByte = nibble << 4;
+		lcdEmuHigh = false;
+	}else{
+		lcdEmuExecute(rs, lcdEmuByte | nibble);
+		lcdEmuHigh = true;
+	}
+}
+
+void lcdEmuVisible(char *cells)
+{
+	for (uint8_t y = 0; y < 4; y++)
+	{
+		memcpy(cells + y * LCD_COLUMNS, lcdEmuDdram + lcdEmuLines[y], LCD_COLUMNS);
+	}
+}
+/* -----------------------------------------------------
+void hostDelayUs(double us)
+Direct transfer waits with E high, display latches then.
+-----------------------------------------------------*/
+void hostDelayUs(double us)
+{
+	(void)us;
+	if (lcd_port & (1<<LCD_EMU_E))
+	{
+		lcdEmuNibble((lcd_port >> LCD_EMU_RS) & 1, lcd_port >> 4);
+	}
+}
+
+bool lcdEmuStep(void)
+{
+	bool sends;
+
+	if (!(TIMSK & (1<<OCIE2)))
+	{
+		return false;
+	}
+	sends = (lcdBusyTicks == 0) && (lcdQueueHead != lcdQueueTail);
+	TIMER2_COMP_vect();
+	if (sends)
+	{
+		lcdEmuNibble((lcd_port >> LCD_EMU_RS) & 1, lcd_port >> 4);
+	}
+	return true;
+}
+
+unsigned long lcdEmuDrain(void)
+{
+	unsigned long ticks = 0;
+
+	while (lcdEmuStep())
+	{
+		ticks++;
+	}
+	return ticks;
+}
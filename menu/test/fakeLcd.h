@@ -0,0 +1,16 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+/* DDRAM of HD44780, addresses 0x00 - 0x67 */
+#define LCD_EMU_DDRAM 0x68
+
+extern char lcdEmuDdram[LCD_EMU_DDRAM];
+extern unsigned long lcdEmuNibbles;
+extern unsigned long lcdEmuBytes;
+extern unsigned long lcdEmuCommands;
+
+extern void lcdEmuReset(void);
+extern void lcdEmuNibble(uint8_t rs, uint8_t nibble);
+extern void lcdEmuVisible(char *cells);
+extern bool lcdEmuStep(void);
+extern unsigned long lcdEmuDrain(void);
@@ -0,0 +1,351 @@
+/*---------------------------------------------------------
+Purpose: RFID reader and card for host tests of RFID and SPI
+drivers. It owns the time (us) and the interrupts: a byte
+written to SPDR is shifted in 8 SPI clocks of the divider
+SPIinit has chosen, then the reader answers it and
+SPI_STC_vect runs, spiTick runs every ms as the timer
+interrupt would, INT0_vect and INT1_vect run on edges of
+the script. Driver waits for them in sleep_cpu(), every
+call of hostSleep() goes on to the next interrupt.
+
+Reader takes 0x55 (card id, 7 bytes), 0x52 first count
+(status byte and count blocks) and 0x57 first count data
+(writes blocks, status byte). Reply is ready readerCommandMs
+plus readerBlockMs per block after the command, both
+assumed, no reader data sheet is at hand.
+
+Input: void readerScript(const readerEdge *edges, int n)
+edges in time order. With readerAuto reader raises INT1 by
+itself, when reply is ready and when its last byte is read,
+else only script does. With readerEcho reader is not there,
+every byte comes back inverted (for tests of SPI engine).
+void readerRun(uint32_t ms) lets ms pass outside driver.
+
+Output: readerNowUs, readerCard (written blocks), counters
+of commands, shifted bytes, SPI interrupts and wake ups,
+time every byte was done.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/io.h>
+#include "driverSPI.h"
+#include "fakeReader.h"
+
+#define F_CPU 10000000UL
+/* Time limit when driver waits for ever */
+#define READER_LIMIT_US 60000000UL
+
+extern spiTransfer * volatile spiCurrent;
+extern volatile uint8_t spiGapTicks;
+extern void SPI_STC_vect(void);
+extern void INT0_vect(void);
+extern void INT1_vect(void);
+
+uint32_t readerNowUs = 0;
+bool readerAuto = true;
+bool readerEcho = false;
+uint16_t readerCommandMs = 25;
+uint16_t readerBlockMs = 3;
+uint8_t readerId[7];
+uint8_t readerCard[READER_BLOCKS][16];
+int readerCommands = 0;
+int readerBytes = 0;
+int readerSpiInterrupts = 0;
+int readerWakeups = 0;
+uint32_t readerByteDoneUs[256];
+uint32_t readerLimitUs = READER_LIMIT_US;
+
+const readerEdge *readerEdges = NULL;
+int readerEdgeCount = 0;
+int readerEdgeNext = 0;
+uint32_t readerTickUs = 1000;
+bool readerShifting = false;
+uint32_t readerShiftDoneUs = 0;
+bool readerReady = false;		//reply is being prepared
+uint32_t readerReadyUs = 0;
+bool readerPending = false;		//own INT1 edge to raise
+uint32_t readerPendingUs = 0;
+uint8_t readerIn[64];
+uint8_t readerInLength = 0;
+uint8_t readerOut[100];
+uint8_t readerOutLength = 0;
+uint8_t readerOutPosition = 0;
+bool readerReplying = false;
+
+/* -----------------------------------------------------
+void readerReset(void)
+Clock to 0, no script, empty card with id 01..07.
+-----------------------------------------------------*/
+void readerReset(void)
+{
+	readerNowUs = 0;
+	readerTickUs = 1000;
+	readerAuto = true;
+	readerEcho = false;
+	readerCommandMs = 25;
+	readerBlockMs = 3;
+	for (uint8_t i = 0; i < sizeof(readerId); i++)
+	{
+		readerId[i] = i + 1;
+	}
+	memset(readerCard, 0, sizeof(readerCard));
+	readerCommands = 0;
+	readerBytes = 0;
+	readerSpiInterrupts = 0;
+	readerWakeups = 0;
+	readerLimitUs = READER_LIMIT_US;
+	readerEdges = NULL;
+	readerEdgeCount = 0;
+	readerEdgeNext = 0;
+	readerShifting = false;
+	readerReady = false;
+	readerPending = false;
+	readerInLength = 0;
+	readerReplying = false;
+}
+
+void readerScript(const readerEdge *edges, int n)
+{
+	readerEdges = edges;
+	readerEdgeCount = n;
+	readerEdgeNext = 0;
+}
+/* -----------------------------------------------------
+uint32_t readerByteUs(void)
+Time of one byte, 8 clocks of F_CPU / divider set by SPCR
+and SPSR, rounded up.
+-----------------------------------------------------*/
+uint32_t readerByteUs(void)
+{
+	const uint16_t dividers[4] = {4, 16, 64, 128};
+	uint32_t divider = dividers[SPCR & ((1<<SPR1) | (1<<SPR0))];
+
+	if (SPSR & (1<<SPI2X))
+	{
+		divider /= 2;
+	}
+	return (8 * divider * 1000000UL + F_CPU - 1) / F_CPU;
+}
+/* -----------------------------------------------------
+uint8_t readerCommandLength(void)
+Bytes of the command being received, 0 if not known yet.
+-----------------------------------------------------*/
+uint8_t readerCommandLength(void)
+{
+	switch (readerIn[0])
+	{
+		case 0x52:
+		return 3;
+
+		case 0x57:
+		return (readerInLength < 3) ? 0 : 3 + 16 * readerIn[2];
+
+		default:
+		return 1;
+	}
+}
+/* -----------------------------------------------------
+void readerExecute(void)
+Runs received command and prepares its reply.
+-----------------------------------------------------*/
+void readerExecute(void)
+{
+	uint8_t first = readerIn[1];
+	uint8_t count = readerIn[2];
+
+	readerCommands++;
+	readerOutLength = 0;
+	readerReadyUs = readerNowUs + readerCommandMs * 1000UL;
+	switch (readerIn[0])
+	{
+		case 0x55:
+		memcpy(readerOut, readerId, sizeof(readerId));
+		readerOutLength = sizeof(readerId);
+		break;
+
+		case 0x52:
+		readerOut[readerOutLength++] = 0;
+		for (uint8_t b = 0; (b < count) && (first + b < READER_BLOCKS) && (readerOutLength + 16 <= sizeof(readerOut)); b++)
+		{
+			memcpy(readerOut + readerOutLength, readerCard[first + b], 16);
+			readerOutLength += 16;
+		}
+		readerReadyUs += count * readerBlockMs * 1000UL;
+		break;
+
+		case 0x57:
+		for (uint8_t b = 0; (b < count) && (first + b < READER_BLOCKS); b++)
+		{
+			memcpy(readerCard[first + b], readerIn + 3 + 16 * b, 16);
+		}
+		readerOut[readerOutLength++] = 0;
+		readerReadyUs += count * readerBlockMs * 1000UL;
+		break;
+
+		default:
+		readerOut[readerOutLength++] = 0xFF;
+		break;
+	}
+	readerReady = true;
+	readerReplying = false;
+}
+/* -----------------------------------------------------
+uint8_t readerTake(uint8_t mosi)
+Reader end of a shifted byte: command byte, or poll byte
+that takes the next reply byte. Returns byte for MISO.
+-----------------------------------------------------*/
+uint8_t readerTake(uint8_t mosi)
+{
+	uint8_t length;
+
+	if (readerEcho)
+	{
+		return ~mosi;
+	}
+	if (readerReplying)
+	{
+		uint8_t miso = readerOut[readerOutPosition++];
+
+		if (readerOutPosition == readerOutLength)
+		{
+			readerReplying = false;
+			if (readerAuto)
+			{
+				readerPending = true;
+				readerPendingUs = readerNowUs;
+			}
+		}
+		return miso;
+	}
+	if (readerInLength < sizeof(readerIn))
+	{
+		readerIn[readerInLength++] = mosi;
+	}
+	length = readerCommandLength();
+	if ((length != 0) && (readerInLength >= length))
+	{
+		readerExecute();
+		readerInLength = 0;
+	}
+	return 0;
+}
+/* -----------------------------------------------------
+void readerNotice(void)
+Byte written to SPDR starts shifting now. Engine has a
+byte in SPDR while it has a transfer and no gap to wait.
+-----------------------------------------------------*/
+void readerNotice(void)
+{
+	if (!readerShifting && (spiCurrent != NULL) && (spiGapTicks == 0))
+	{
+		readerShifting = true;
+		readerShiftDoneUs = readerNowUs + readerByteUs();
+	}
+}
+
+void readerLine(uint8_t line)
+{
+	if ((line == READER_INT0) && (GICR & (1<<INT0)))
+	{
+		INT0_vect();
+	}
+	if ((line == READER_INT1) && (GICR & (1<<INT1)))
+	{
+		INT1_vect();
+	}
+}
+/* -----------------------------------------------------
+bool readerStep(uint32_t untilUs)
+Goes to the next interrupt and runs it, if it comes not
+later than untilUs. Returns false if there is none.
+-----------------------------------------------------*/
+bool readerStep(uint32_t untilUs)
+{
+	uint32_t next = readerTickUs;
+
+	readerNotice();
+	if (readerShifting && (readerShiftDoneUs < next))
+	{
+		next = readerShiftDoneUs;
+	}
+	if (readerReady && (readerReadyUs < next))
+	{
+		next = readerReadyUs;
+	}
+	if (readerPending && (readerPendingUs < next))
+	{
+		next = readerPendingUs;
+	}
+	if ((readerEdgeNext < readerEdgeCount) && (readerEdges[readerEdgeNext].ms * 1000 < next))
+	{
+		next = readerEdges[readerEdgeNext].ms * 1000;
+	}
+	if (next > untilUs)
+	{
+		return false;
+	}
+	readerNowUs = next;
+	if (readerShifting && (readerShiftDoneUs == next))
+	{
+		readerShifting = false;
+		SPDR = readerTake(SPDR);
+		readerByteDoneUs[readerBytes++ % 256] = next;
+		readerSpiInterrupts++;
+		SPI_STC_vect();
+	}
+	else if (readerReady && (readerReadyUs == next))
+	{
+		readerReady = false;
+		readerReplying = true;
+		readerOutPosition = 0;
+		if (readerAuto)
+		{
+			readerLine(READER_INT1);
+		}
+	}
+	else if (readerPending && (readerPendingUs == next))
+	{
+		readerPending = false;
+		readerLine(READER_INT1);
+	}
+	else if ((readerEdgeNext < readerEdgeCount) && (readerEdges[readerEdgeNext].ms * 1000 == next))
+	{
+		readerLine(readerEdges[readerEdgeNext++].line);
+	}
+	else
+	{
+		readerTickUs += 1000;
+		spiTick();
+	}
+	readerNotice();
+	return true;
+}
+/* -----------------------------------------------------
+void hostSleep(void)
+Driver sleeps until the next interrupt. Test fails if
+that is later than readerLimitUs.
+-----------------------------------------------------*/
+void hostSleep(void)
+{
+	readerWakeups++;
+	readerStep(UINT32_MAX);
+	if (readerNowUs > readerLimitUs)
+	{
+		printf("fakeReader: driver still waits at %lu ms\n", (unsigned long)(readerNowUs / 1000));
+		exit(1);
+	}
+}
+
+void readerRun(uint32_t ms)
+{
+	uint32_t until = readerNowUs + ms * 1000;
+
+	while (readerStep(until));
+	readerNowUs = until;
+}
@@ -0,0 +1,35 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Interrupt lines of the reader */
+#define READER_INT0 0
+#define READER_INT1 1
+
+/* Card blocks the fake card has */
+#define READER_BLOCKS 16
+
+/* Edge of a reader line at ms, INT0 is card put or removed,
+INT1 data ready or start transmit */
+typedef struct {
+	uint32_t ms;
+	uint8_t line;
+} readerEdge;
+
+extern uint32_t readerNowUs;
+extern bool readerAuto;
+extern bool readerEcho;
+extern uint16_t readerCommandMs;
+extern uint16_t readerBlockMs;
+extern uint8_t readerId[7];
+extern uint8_t readerCard[READER_BLOCKS][16];
+extern int readerCommands;
+extern int readerBytes;
+extern int readerSpiInterrupts;
+extern int readerWakeups;
+extern uint32_t readerByteDoneUs[256];
+extern uint32_t readerLimitUs;
+
+extern void readerReset(void);
+extern void readerScript(const readerEdge *edges, int n);
+extern void readerRun(uint32_t ms);
+extern uint32_t readerByteUs(void);
@@ -0,0 +1,322 @@
+/*---------------------------------------------------------
+Purpose: Fake charging server for host tests of request
+modules. It owns the clock (getTick() of driverTimer is
+defined here, every call is 1 ms later), takes packages
+that controller queues to USART through USART_UDRE_vect
+and answers them through USART_RXC_vect, 2 bytes per ms
+as 19200 baud would.
+
+Input: void serverScript(const serverStepScript *script, uint8_t n)
+What to do with the next n requests: reply, drop, corrupt
+or duplicate the reply, and after how many ms. Requests
+past the script are answered after serverDelayMs. NAK (08)
+and RepeatLastPacket (09) make server repeat the last reply
+it has sent, as it was meant to be.
+
+Output: Reply to request with command c has command c + 1
+and data "R", c as two digits and up to ten first chars of
+request data. In binary mode it carries request sequence
+number. serverRequests, serverNaks, serverLastCommand and
+serverLastData tell what controller has sent.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <avr/io.h>
+#include "crc16.h"
+#include "formPacket.h"
+#include "fakeServer.h"
+
+/* Replies that could wait for delivery */
+#define SERVER_QUEUE 16
+/* Bytes delivered per ms */
+#define SERVER_BYTES_PER_MS 2
+
+typedef struct {
+	bool used;
+	uint16_t due;
+	uint16_t order;
+	uint8_t bytes[SERVER_PACKAGE_MAX];
+	uint8_t intact[SERVER_PACKAGE_MAX];	//package before it was corrupted
+	uint8_t length;
+	uint8_t position;
+} serverPackage;
+
+extern void USART_UDRE_vect(void);
+extern void USART_RXC_vect(void);
+
+uint16_t serverNow = 0;
+uint16_t serverDelayMs = 20;
+int serverRequests = 0;
+int serverNaks = 0;
+uint8_t serverLastCommand = 0;
+char serverLastData[SERVER_PACKAGE_MAX];
+
+serverPackage serverQueue[SERVER_QUEUE];
+serverPackage *serverActive = NULL;
+uint16_t serverOrder = 0;
+uint8_t serverIn[SERVER_PACKAGE_MAX];
+uint8_t serverInLength = 0;
+serverStepScript serverActions[32];
+uint8_t serverActionCount = 0;
+uint8_t serverActionNext = 0;
+uint8_t serverLast[SERVER_PACKAGE_MAX];
+uint8_t serverLastLength = 0;
+int serverCommands[100];
+
+void serverRequest(uint8_t command, uint8_t sequence, const char *data, uint8_t length);
+/* -----------------------------------------------------
+uint16_t getTick(void)
+Clock of the module under test, 1 ms passes every call and
+server does its part of the work.
+-----------------------------------------------------*/
+uint16_t getTick(void)
+{
+	serverAdvance(1);
+	return serverNow;
+}
+/* -----------------------------------------------------
+void serverReset(void)
+Forgets script, queued replies and counters.
+-----------------------------------------------------*/
+void serverReset(void)
+{
+	serverStep();
+	memset(serverQueue, 0, sizeof(serverQueue));
+	serverActive = NULL;
+	serverInLength = 0;
+	serverActionCount = 0;
+	serverActionNext = 0;
+	serverLastLength = 0;
+	serverRequests = 0;
+	serverNaks = 0;
+	serverDelayMs = 20;
+	memset(serverCommands, 0, sizeof(serverCommands));
+}
+
+void serverScript(const serverStepScript *script, uint8_t n)
+{
+	memcpy(serverActions, script, n * sizeof(serverStepScript));
+	serverActionCount = n;
+	serverActionNext = 0;
+}
+
+int serverCount(uint8_t command)
+{
+	return serverCommands[command % 100];
+}
+/* -----------------------------------------------------
+void serverAdvance(uint16_t ms)
+Lets ms pass, every ms server takes what controller has
+sent and delivers next bytes of due replies.
+-----------------------------------------------------*/
+void serverAdvance(uint16_t ms)
+{
+	while (ms-- > 0)
+	{
+		serverNow++;
+		serverStep();
+		for (uint8_t b = 0; b < SERVER_BYTES_PER_MS; b++)
+		{
+			if (serverActive == NULL)
+			{
+				for (uint8_t q = 0; q < SERVER_QUEUE; q++)
+				{
+					serverPackage *p = &serverQueue[q];
+
+					if (p->used && ((int16_t)(serverNow - p->due) >= 0) &&
+						((serverActive == NULL) || (p->order < serverActive->order)))
+					{
+						serverActive = p;
+					}
+				}
+			}
+			if (serverActive == NULL)
+			{
+				break;
+			}
+			UDR = serverActive->bytes[serverActive->position++];
+			USART_RXC_vect();
+			if (serverActive->position == serverActive->length)
+			{
+				memcpy(serverLast, serverActive->intact, serverActive->length);
+				serverLastLength = serverActive->length;
+				serverActive->used = false;
+				serverActive = NULL;
+			}
+		}
+	}
+}
+/* -----------------------------------------------------
+void serverStep(void)
+Takes bytes controller has queued and splits them into
+requests.
+-----------------------------------------------------*/
+void serverStep(void)
+{
+	while (UCSRB & (1<<UDRIE))
+	{
+		USART_UDRE_vect();
+		if (!(UCSRB & (1<<UDRIE)))
+		{
+			break;
+		}
+		serverIn[serverInLength++] = UDR;
+		if (binaryMode)
+		{
+			if ((serverInLength >= 7) && (serverInLength == 11 + serverIn[6]))
+			{
+				serverRequest(serverIn[4], serverIn[5], (char *)serverIn + 7, serverIn[6]);
+				serverInLength = 0;
+			}
+		}
+		else if ((serverInLength >= 2) && (serverIn[serverInLength - 2] == '-') &&
+				 (serverIn[serverInLength - 1] == '*'))
+		{
+			uint8_t length = (serverIn[6] - '0') * 1000 + (serverIn[7] - '0') * 100 +
+							 (serverIn[8] - '0') * 10 + (serverIn[9] - '0');
+
+			serverRequest((serverIn[4] - '0') * 10 + (serverIn[5] - '0'), 0, (char *)serverIn + 10, length);
+			serverInLength = 0;
+		}
+		if (serverInLength == SERVER_PACKAGE_MAX)
+		{
+			serverInLength = 0;
+		}
+	}
+}
+/* -----------------------------------------------------
+int serverQueuePackage(const uint8_t *bytes, const uint8_t *intact, uint8_t length, uint16_t delayMs)
+Schedules package for delivery, intact is what server
+meant to send. Returns false if queue is full.
+-----------------------------------------------------*/
+int serverQueuePackage(const uint8_t *bytes, const uint8_t *intact, uint8_t length, uint16_t delayMs)
+{
+	for (uint8_t q = 0; q < SERVER_QUEUE; q++)
+	{
+		serverPackage *p = &serverQueue[q];
+
+		if (!p->used)
+		{
+			p->used = true;
+			p->due = serverNow + delayMs;
+			p->order = serverOrder++;
+			memcpy(p->bytes, bytes, length);
+			memcpy(p->intact, intact, length);
+			p->length = length;
+			p->position = 0;
+			return true;
+		}
+	}
+	return false;
+}
+/* -----------------------------------------------------
+uint8_t serverForm(uint8_t *out, uint8_t command, uint8_t sequence, const char *data)
+Forms reply package in the current mode.
+-----------------------------------------------------*/
+uint8_t serverForm(uint8_t *out, uint8_t command, uint8_t sequence, const char *data)
+{
+	uint8_t length = strlen(data);
+	uint16_t crc = CRC16_INIT;
+	uint8_t n = 0;
+
+	out[n++] = '*';
+	out[n++] = '-';
+	if (binaryMode)
+	{
+		out[n++] = 1;
+		out[n++] = 2;
+		out[n++] = command;
+		out[n++] = sequence;
+		out[n++] = length;
+		memcpy(out + n, data, length);
+		n += length;
+		for (uint8_t i = 2; i < n; i++)
+		{
+			crc = crc16Update(crc, out[i]);
+		}
+		out[n++] = crc >> 8;
+		out[n++] = crc;
+	}else{
+		n += sprintf((char *)out + n, "0102%02u%04u%s", command, length, data);
+		for (uint8_t i = 2; i < n; i++)
+		{
+			crc = crc16Update(crc, out[i]);
+		}
+		crc16ToHex(crc, (char *)out + n);
+		n += 4;
+	}
+	out[n++] = '-';
+	out[n++] = '*';
+	return n;
+}
+/* -----------------------------------------------------
+int serverReply(uint8_t command, uint8_t sequence, const char *data, bool corrupt, uint16_t delayMs)
+Sends package to controller, corrupted one has its first
+data byte ('R') changed, so only check sum tells. Once it is on wire, the package
+before corruption is the one server repeats on NAK.
+-----------------------------------------------------*/
+int serverReply(uint8_t command, uint8_t sequence, const char *data, bool corrupt, uint16_t delayMs)
+{
+	uint8_t package[SERVER_PACKAGE_MAX];
+	uint8_t intact[SERVER_PACKAGE_MAX];
+	uint8_t n = serverForm(intact, command, sequence, data);
+
+	memcpy(package, intact, n);
+	if (corrupt)
+	{
+		package[binaryMode ? 7 : 12] ^= 0x01;
+	}
+	return serverQueuePackage(package, intact, n, delayMs);
+}
+/* -----------------------------------------------------
+void serverRequest(uint8_t command, uint8_t sequence, const char *data, uint8_t length)
+Answers request as script says.
+-----------------------------------------------------*/
+void serverRequest(uint8_t command, uint8_t sequence, const char *data, uint8_t length)
+{
+	serverStepScript step = {SERVER_REPLY, serverDelayMs};
+	char reply[16];
+
+	serverRequests++;
+	serverCommands[command % 100]++;
+	serverLastCommand = command;
+	memcpy(serverLastData, data, length);
+	serverLastData[length] = '\0';
+	if ((command == 8) || (command == 9))
+	{
+		serverNaks++;
+		if (serverLastLength > 0)
+		{
+			serverQueuePackage(serverLast, serverLast, serverLastLength, serverDelayMs);
+		}
+		return;
+	}
+	if (serverActionNext < serverActionCount)
+	{
+		step = serverActions[serverActionNext++];
+	}
+	snprintf(reply, sizeof(reply), "R%02u%.10s", command, serverLastData);
+	switch (step.action)
+	{
+		case SERVER_REPLY:
+		serverReply(command + 1, sequence, reply, false, step.delayMs);
+		break;
+
+		case SERVER_CORRUPT:
+		serverReply(command + 1, sequence, reply, true, step.delayMs);
+		break;
+
+		case SERVER_DUPLICATE:
+		serverReply(command + 1, sequence, reply, false, step.delayMs);
+		serverReply(command + 1, sequence, reply, false, step.delayMs + 1);
+		break;
+
+		default:
+		break;
+	}
+}
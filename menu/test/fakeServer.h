@@ -0,0 +1,31 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+/* What server does with a request */
+#define SERVER_REPLY 0
+#define SERVER_DROP 1
+#define SERVER_CORRUPT 2
+#define SERVER_DUPLICATE 3
+
+/* Longest package on wire */
+#define SERVER_PACKAGE_MAX 110
+
+/* Action for one request and delay of its reply, ms */
+typedef struct {
+	uint8_t action;
+	uint16_t delayMs;
+} serverStepScript;
+
+extern uint16_t serverNow;
+extern uint16_t serverDelayMs;
+extern int serverRequests;
+extern int serverNaks;
+extern uint8_t serverLastCommand;
+extern char serverLastData[SERVER_PACKAGE_MAX];
+
+extern void serverReset(void);
+extern void serverScript(const serverStepScript *script, uint8_t n);
+extern void serverStep(void);
+extern void serverAdvance(uint16_t ms);
+extern int serverReply(uint8_t command, uint8_t sequence, const char *data, bool corrupt, uint16_t delayMs);
+extern int serverCount(uint8_t command);
@@ -0,0 +1,12 @@
+/* Host stand-in for <avr/eeprom.h>: EEPROM variables live in RAM */
+#ifndef HOST_AVR_EEPROM_H
+#define HOST_AVR_EEPROM_H
+#include <stdint.h>
+#include <string.h>
+
+#define EEMEM
+#define eeprom_read_byte(a) (*(const uint8_t *)(a))
+#define eeprom_read_block(dst, src, n) memcpy((dst), (src), (n))
+#define eeprom_update_block(src, dst, n) memcpy((dst), (src), (n))
+
+#endif
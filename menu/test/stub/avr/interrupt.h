@@ -0,0 +1,11 @@
+/* Host stand-in for <avr/interrupt.h>: interrupt routines are
+plain functions that tests call, sei() and cli() do nothing */
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+#include <avr/io.h>
+
+#define ISR(vector) void vector(void); void vector(void)
+#define sei() ((void)0)
+#define cli() ((void)0)
+
+#endif
@@ -0,0 +1,54 @@
+/*---------------------------------------------------------
+Purpose: Host stand-in for <avr/io.h> of ATmega32, so that
+controller modules compile with gcc on PC for tests. I/O
+registers are plain variables (defined in avrHost.c), tests
+set them and call interrupt routines as functions.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+#include <stdint.h>
+
+#define HOST_REG8(n) extern volatile uint8_t n;
+HOST_REG8(UCSRA) HOST_REG8(UCSRB) HOST_REG8(UCSRC) HOST_REG8(UDR) HOST_REG8(UBRRH) HOST_REG8(UBRRL)
+HOST_REG8(TCCR0) HOST_REG8(TCCR1A) HOST_REG8(TCCR1B) HOST_REG8(TCCR2) HOST_REG8(TIMSK) HOST_REG8(TIFR)
+HOST_REG8(OCR0) HOST_REG8(OCR2) HOST_REG8(TCNT0) HOST_REG8(TCNT2)
+HOST_REG8(PORTA) HOST_REG8(PORTB) HOST_REG8(PORTC) HOST_REG8(PORTD)
+HOST_REG8(DDRA) HOST_REG8(DDRB) HOST_REG8(DDRC) HOST_REG8(DDRD)
+HOST_REG8(PINA) HOST_REG8(PINB) HOST_REG8(PINC) HOST_REG8(PIND)
+HOST_REG8(ADMUX) HOST_REG8(ADCSRA) HOST_REG8(ADCL) HOST_REG8(ADCH) HOST_REG8(SFIOR)
+HOST_REG8(SPCR) HOST_REG8(SPSR) HOST_REG8(SPDR)
+HOST_REG8(GICR) HOST_REG8(GIFR) HOST_REG8(MCUCR) HOST_REG8(MCUCSR) HOST_REG8(SREG)
+extern volatile uint16_t OCR1A, OCR1B, TCNT1, ADC, ADCW;
+
+enum {
+	RXC = 7, TXC = 6, UDRE = 5, FE = 4, DOR = 3, PE = 2, U2X = 1, MPCM = 0,
+	RXCIE = 7, TXCIE = 6, UDRIE = 5, RXEN = 4, TXEN = 3, UCSZ2 = 2, RXB8 = 1, TXB8 = 0,
+	URSEL = 7, UMSEL = 6, UPM1 = 5, UPM0 = 4, USBS = 3, UCSZ1 = 2, UCSZ0 = 1, UCPOL = 0,
+	COM1A1 = 7, COM1A0 = 6, COM1B1 = 5, COM1B0 = 4, WGM11 = 1, WGM10 = 0,
+	ICNC1 = 7, ICES1 = 6, WGM13 = 4, WGM12 = 3, CS12 = 2, CS11 = 1, CS10 = 0,
+	FOC2 = 7, WGM20 = 6, COM21 = 5, COM20 = 4, WGM21 = 3, CS22 = 2, CS21 = 1, CS20 = 0,
+	OCIE2 = 7, TOIE2 = 6, TICIE1 = 5, OCIE1A = 4, OCIE1B = 3, TOIE1 = 2, OCIE0 = 1, TOIE0 = 0,
+	OCF2 = 7, TOV2 = 6, ICF1 = 5, OCF1A = 4, OCF1B = 3, TOV1 = 2, OCF0 = 1, TOV0 = 0,
+	REFS1 = 7, REFS0 = 6, ADLAR = 5, MUX4 = 4, MUX3 = 3, MUX2 = 2, MUX1 = 1, MUX0 = 0,
+	ADEN = 7, ADSC = 6, ADATE = 5, ADIF = 4, ADIE = 3, ADPS2 = 2, ADPS1 = 1, ADPS0 = 0,
+	ADTS2 = 7, ADTS1 = 6, ADTS0 = 5,
+	SPIE = 7, SPE = 6, DORD = 5, MSTR = 4, CPOL = 3, CPHA = 2, SPR1 = 1, SPR0 = 0,
+	SPIF = 7, WCOL = 6, SPI2X = 0,
+	INT1 = 7, INT0 = 6, INT2 = 5, INTF1 = 7, INTF0 = 6, INTF2 = 5,
+	SE = 7, SM2 = 6, SM1 = 5, SM0 = 4, ISC11 = 3, ISC10 = 2, ISC01 = 1, ISC00 = 0,
+	PA0 = 0, PA1 = 1, PA2 = 2, PA3 = 3, PA4 = 4, PA5 = 5, PA6 = 6, PA7 = 7,
+	PB0 = 0, PB1 = 1, PB2 = 2, PB3 = 3, PB4 = 4, PB5 = 5, PB6 = 6, PB7 = 7,
+	PC0 = 0, PC1 = 1, PC2 = 2, PC3 = 3, PC4 = 4, PC5 = 5, PC6 = 6, PC7 = 7,
+	PD0 = 0, PD1 = 1, PD2 = 2, PD3 = 3, PD4 = 4, PD5 = 5, PD6 = 6, PD7 = 7,
+	PINC0 = 0, PINC1 = 1, PINC2 = 2, PINC3 = 3, PINC4 = 4, PINC5 = 5, PINC6 = 6, PINC7 = 7,
+	DDB0 = 0, DDB4 = 4, DDB5 = 5, DDB7 = 7
+};
+
+#define _BV(bit) (1 << (bit))
+
+#endif
@@ -0,0 +1,15 @@
+/* Host stand-in for <avr/sleep.h>: sleep_cpu() calls hostSleep(),
+tests that wait for interrupts let them happen there */
+#ifndef HOST_AVR_SLEEP_H
+#define HOST_AVR_SLEEP_H
+
+#define SLEEP_MODE_IDLE 0
+#define set_sleep_mode(mode) ((void)(mode))
+#define sleep_enable() ((void)0)
+#define sleep_disable() ((void)0)
+#define sleep_cpu() hostSleep()
+#define sleep_mode() hostSleep()
+
+extern void hostSleep(void);
+
+#endif
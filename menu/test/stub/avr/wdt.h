@@ -0,0 +1,10 @@
+/* Host stand-in for <avr/wdt.h> */
+#ifndef HOST_AVR_WDT_H
+#define HOST_AVR_WDT_H
+
+#define WDTO_15MS 0
+#define wdt_enable(timeout) ((void)(timeout))
+#define wdt_reset() ((void)0)
+#define wdt_disable() ((void)0)
+
+#endif
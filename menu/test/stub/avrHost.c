@@ -0,0 +1,67 @@
+/*---------------------------------------------------------
+Purpose: Host side of the AVR stand-in headers. Defines I/O
+registers as variables, avr-libc number conversions and the
+hooks that sleep and delay calls end in. Hooks are weak, a
+test defines its own to drive interrupts while the module
+under test waits.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <avr/io.h>
+
+#define HOST_DEFINE8(n) volatile uint8_t n;
+HOST_DEFINE8(UCSRA) HOST_DEFINE8(UCSRB) HOST_DEFINE8(UCSRC) HOST_DEFINE8(UDR) HOST_DEFINE8(UBRRH) HOST_DEFINE8(UBRRL)
+HOST_DEFINE8(TCCR0) HOST_DEFINE8(TCCR1A) HOST_DEFINE8(TCCR1B) HOST_DEFINE8(TCCR2) HOST_DEFINE8(TIMSK) HOST_DEFINE8(TIFR)
+HOST_DEFINE8(OCR0) HOST_DEFINE8(OCR2) HOST_DEFINE8(TCNT0) HOST_DEFINE8(TCNT2)
+HOST_DEFINE8(PORTA) HOST_DEFINE8(PORTB) HOST_DEFINE8(PORTC) HOST_DEFINE8(PORTD)
+HOST_DEFINE8(DDRA) HOST_DEFINE8(DDRB) HOST_DEFINE8(DDRC) HOST_DEFINE8(DDRD)
+HOST_DEFINE8(PINA) HOST_DEFINE8(PINB) HOST_DEFINE8(PINC) HOST_DEFINE8(PIND)
+HOST_DEFINE8(ADMUX) HOST_DEFINE8(ADCSRA) HOST_DEFINE8(ADCL) HOST_DEFINE8(ADCH) HOST_DEFINE8(SFIOR)
+HOST_DEFINE8(SPCR) HOST_DEFINE8(SPSR) HOST_DEFINE8(SPDR)
+HOST_DEFINE8(GICR) HOST_DEFINE8(GIFR) HOST_DEFINE8(MCUCR) HOST_DEFINE8(MCUCSR) HOST_DEFINE8(SREG)
+volatile uint16_t OCR1A, OCR1B, TCNT1, ADC, ADCW;
+
+/* -----------------------------------------------------
+char *itoa(int value, char *str, int radix)
+avr-libc conversions, radix 10 and 16 are enough here.
+-----------------------------------------------------*/
+char *itoa(int value, char *str, int radix)
+{
+	sprintf(str, (radix == 16) ? "%x" : "%d", value);
+	return str;
+}
+
+char *utoa(unsigned int value, char *str, int radix)
+{
+	sprintf(str, (radix == 16) ? "%x" : "%u", value);
+	return str;
+}
+
+char *ltoa(long value, char *str, int radix)
+{
+	sprintf(str, (radix == 16) ? "%lx" : "%ld", value);
+	return str;
+}
+
+char *ultoa(unsigned long value, char *str, int radix)
+{
+	sprintf(str, (radix == 16) ? "%lx" : "%lu", value);
+	return str;
+}
+/* -----------------------------------------------------
+void hostSleep(void), void hostDelayUs(double us)
+Default hooks, time does not pass.
+-----------------------------------------------------*/
+__attribute__((weak)) void hostSleep(void)
+{
+}
+
+__attribute__((weak)) void hostDelayUs(double us)
+{
+	(void)us;
+}
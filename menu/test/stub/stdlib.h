@@ -0,0 +1,11 @@
+/* Host <stdlib.h> with avr-libc number conversions added */
+#ifndef HOST_STDLIB_H
+#define HOST_STDLIB_H
+#include_next <stdlib.h>
+
+extern char *itoa(int value, char *str, int radix);
+extern char *utoa(unsigned int value, char *str, int radix);
+extern char *ltoa(long value, char *str, int radix);
+extern char *ultoa(unsigned long value, char *str, int radix);
+
+#endif
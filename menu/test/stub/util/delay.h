@@ -0,0 +1,11 @@
+/* Host stand-in for <util/delay.h>: delays are handed to
+hostDelayUs(), so tests could count or simulate time */
+#ifndef HOST_UTIL_DELAY_H
+#define HOST_UTIL_DELAY_H
+
+extern void hostDelayUs(double us);
+
+#define _delay_us(us) hostDelayUs(us)
+#define _delay_ms(ms) hostDelayUs((ms) * 1000.0)
+
+#endif
@@ -0,0 +1,203 @@
+/*---------------------------------------------------------
+Purpose: Host test of voltage and current scan (driverADC.c)
+and real power metering (energyMeter.c) with synthetic 50 Hz
+sine waves. Voltage and current, 30 degrees apart, go through
+ADC interrupts, ring, metering task and meter, and energy
+and RMS current come out as the analytic values within 0.1 %
+(shown power within 1 %), with the simulation board gains and
+with charger gains (325 V, 32 A). Calibration is saved to
+EEPROM and read back. Decimated and averaged power settles
+exactly, follows a step with its time constant and keeps
+sine ripple small.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include "driverADC.h"
+#include "energyMeter.h"
+#include "fakeAdc.h"
+#include "testCheck.h"
+
+#define OFFSET 512
+#define VOLTAGE_PEAK 400.0
+#define CURRENT_PEAK 300.0
+#define PHASE (M_PI / 6)
+#define HZ 50.0
+
+extern meterCalibration eeCalibration;
+extern meterCalibration calibration;
+extern uint32_t powerScale;
+
+/* Sample both channels at the trigger, or each when it is converted */
+bool skew = false;
+
+/* -----------------------------------------------------
+uint16_t sine(uint8_t channel, uint32_t us)
+Voltage on ADC0, current lagging by PHASE on ADC1.
+-----------------------------------------------------*/
+uint16_t sine(uint8_t channel, uint32_t us)
+{
+	double t = (skew ? us : (us - ADC_EMU_CONVERSION_US) / 1000 * 1000) / 1e6;
+
+	if (channel == 0)
+	{
+		return (uint16_t)(OFFSET + VOLTAGE_PEAK * sin(2 * M_PI * HZ * t) + 0.5);
+	}
+	return (uint16_t)(OFFSET + CURRENT_PEAK * sin(2 * M_PI * HZ * t - PHASE) + 0.5);
+}
+/* -----------------------------------------------------
+void meter(unsigned long ms)
+ADC runs, metering task takes a block every 8 ms.
+-----------------------------------------------------*/
+void meter(unsigned long ms)
+{
+	uint16_t block[16];
+
+	while (ms-- > 0)
+	{
+		adcEmuCompare();
+		if (adcEmuNow % 8000 == 0)
+		{
+			energyMeterBlock(block, adcRead(block, 16));
+		}
+	}
+}
+
+double relative(double measured, double exact)
+{
+	return fabs(measured - exact) / exact;
+}
+/* -----------------------------------------------------
+void testSine(uint32_t voltageGain, uint32_t currentGain, uint8_t decimals)
+10 s of sine waves with given gains (nV, nA per count).
+Values are read with decimals.
+-----------------------------------------------------*/
+void testSine(uint32_t voltageGain, uint32_t currentGain, uint8_t decimals)
+{
+	meterCalibration wanted = {{OFFSET, OFFSET}, {voltageGain, currentGain}};
+	double scale = pow(10, decimals);
+	double power = VOLTAGE_PEAK * CURRENT_PEAK / 2 * cos(PHASE) * voltageGain * currentGain * 1e-15;
+	double current = CURRENT_PEAK / sqrt(2) * currentGain * 1e-6;
+	double energy = power * 10;
+	double measuredPower;
+
+	energyMeterSaveCalibration(&wanted);
+	CHECK(memcmp(&eeCalibration, &wanted, sizeof(wanted)) == 0);
+	CHECK(memcmp(&calibration, &wanted, sizeof(wanted)) == 0);
+	energyMeterReset();
+	adcEmuReset(sine);
+	adcStart();
+	meter(10000);
+	measuredPower = energyMeterPower(decimals) / scale;
+	CHECK(relative(energyMeterEnergy(decimals) / scale, energy) < 0.001);
+	CHECK(relative(energyMeterCurrent(decimals) / scale, current) < 0.001);
+	CHECK(relative(measuredPower, power) < 0.01);
+	CHECK_EQUAL(0, adcOverruns);
+	printf("testAdcMeter: %.3f mW %.3f mA, energy %+.3f%%, RMS current %+.3f%%, power %+.3f%%\n",
+		   power, current, 100 * (energyMeterEnergy(decimals) / scale / energy - 1),
+		   100 * (energyMeterCurrent(decimals) / scale / current - 1), 100 * (measuredPower / power - 1));
+	adcStop();
+}
+/* -----------------------------------------------------
+void testSkew(void)
+Current is converted 166 us after voltage, 3 degrees of
+50 Hz later, so 30 degree load reads more power. Only shown,
+the scan does not correct it.
+-----------------------------------------------------*/
+void testSkew(void)
+{
+	meterCalibration board = {{OFFSET, OFFSET}, {4882813UL, 3906UL}};
+	double power = VOLTAGE_PEAK * CURRENT_PEAK / 2 * cos(PHASE) * board.gain[0] * board.gain[1] * 1e-15;
+	double skewed = cos(PHASE - 2 * M_PI * HZ * ADC_EMU_CONVERSION_US / 1e6) / cos(PHASE) - 1;
+
+	energyMeterSaveCalibration(&board);
+	energyMeterReset();
+	skew = true;
+	adcEmuReset(sine);
+	adcStart();
+	meter(10000);
+	CHECK(energyMeterEnergy(3) / 1e3 > power * 10);
+	printf("testAdcMeter: with 166 us between channels energy reads %+.2f%% off (%+.2f%% from 3 degrees of phase)\n",
+		   100 * (energyMeterEnergy(3) / 1e3 / (power * 10) - 1), 100 * skewed);
+	skew = false;
+	adcStop();
+}
+/* -----------------------------------------------------
+void testFilter(void)
+Constant power settles to its value exactly, a step reaches
+63 % after one time constant (16 decimated samples, 256
+frames), sine power read every 100 ms stays close to the
+mean although product of every frame swings from -0.15 to
+2.15 of it.
+-----------------------------------------------------*/
+void testFilter(void)
+{
+	meterCalibration board = {{OFFSET, OFFSET}, {4882813UL, 3906UL}};
+	uint16_t frame[ADC_CHANNELS] = {OFFSET + 300, OFFSET + 200};
+	double power = VOLTAGE_PEAK * CURRENT_PEAK / 2 * cos(PHASE) * board.gain[0] * board.gain[1] * 1e-15;
+	double worst = 0;
+	uint32_t settled;
+	uint32_t step;
+
+	energyMeterSaveCalibration(&board);
+	energyMeterReset();
+	for (int i = 0; i < 4000; i++)
+	{
+		energyMeterBlock(frame, ADC_CHANNELS);
+	}
+	settled = energyMeterPower(6);
+	CHECK(relative(settled, 300.0 * 200 * powerScale / 16) < 0.0005);
+
+	energyMeterReset();
+	for (int i = 0; i < (16 << ENERGY_EMA_SHIFT); i++)
+	{
+		energyMeterBlock(frame, ADC_CHANNELS);
+	}
+	step = energyMeterPower(6);
+	CHECK((step > settled * 0.60) && (step < settled * 0.66));
+
+	energyMeterReset();
+	adcEmuReset(sine);
+	adcStart();
+	meter(2000);
+	for (int i = 0; i < 80; i++)
+	{
+		meter(100);
+		if (relative(energyMeterPower(6) / 1e6, power) > worst)
+		{
+			worst = relative(energyMeterPower(6) / 1e6, power);
+		}
+	}
+	CHECK(worst < 0.01);
+	printf("testAdcMeter: filtered sine power read every 100 ms at most %.2f%% from mean\n", 100 * worst);
+	adcStop();
+}
+/* -----------------------------------------------------
+void testErased(void)
+Erased EEPROM leaves defaults in use.
+-----------------------------------------------------*/
+void testErased(void)
+{
+	meterCalibration defaults = calibration;
+
+	memset(&eeCalibration, 0xFF, sizeof(eeCalibration));
+	energyMeterLoadCalibration();
+	CHECK(memcmp(&calibration, &defaults, sizeof(defaults)) == 0);
+}
+
+int main(void)
+{
+	testSine(4882813UL, 3906UL, 3);
+	testSine(812500000UL, 150849000UL, 0);
+	testSkew();
+	testFilter();
+	testErased();
+	return testDone("testAdcMeter");
+}
@@ -0,0 +1,126 @@
+/*---------------------------------------------------------
+Purpose: Host test of triggered ADC sampling (driverADC.c).
+Every timer 1 compare gives one frame, voltage then current,
+the ring gets only whole frames in order, adcRead takes whole
+frames, oldest first. When the ring has no room, the frame is
+dropped whole and counted, frames already in the ring stay.
+adcStop stops sampling.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <avr/io.h>
+#include "driverADC.h"
+#include "fakeAdc.h"
+#include "testCheck.h"
+
+/* -----------------------------------------------------
+uint16_t numbered(uint8_t channel, uint32_t us)
+Sample tells its frame (ms) and channel.
+-----------------------------------------------------*/
+uint16_t numbered(uint8_t channel, uint32_t us)
+{
+	return (((us / 1000) << 1) | channel) & 0x3ff;
+}
+/* -----------------------------------------------------
+int checkFrames(const uint16_t *samples, uint8_t n, uint16_t first)
+Counts samples that are not frames first, first + 1...
+-----------------------------------------------------*/
+int checkFrames(const uint16_t *samples, uint8_t n, uint16_t first)
+{
+	int wrong = 0;
+
+	for (uint8_t i = 0; i < n; i++)
+	{
+		wrong += (samples[i] != ((((first + i / ADC_CHANNELS) << 1) | (i % ADC_CHANNELS)) & 0x3ff));
+	}
+	return wrong;
+}
+/* -----------------------------------------------------
+void testFrames(void)
+Frames in order, scan list sets ADMUX.
+-----------------------------------------------------*/
+void testFrames(void)
+{
+	uint16_t samples[ADC_RING_SIZE];
+
+	adcEmuReset(numbered);
+	adcStart();
+	CHECK_EQUAL((1<<REFS0) | 0, ADMUX);
+	CHECK(ADCSRA & (1<<ADATE));
+	CHECK_EQUAL(0, adcRead(samples, ADC_RING_SIZE));
+	adcEmuRun(10);
+	CHECK_EQUAL(20, adcEmuConversions);
+	CHECK_EQUAL((1<<REFS0) | 0, ADMUX);
+	CHECK_EQUAL(6, adcRead(samples, 6));
+	CHECK_EQUAL(0, checkFrames(samples, 6, 0));
+	CHECK_EQUAL(14, adcRead(samples, ADC_RING_SIZE));
+	CHECK_EQUAL(0, checkFrames(samples, 14, 3));
+	CHECK_EQUAL(0, adcOverruns);
+}
+/* -----------------------------------------------------
+void testOverrun(void)
+20 frames and nobody reads: 16 fit, 4 are dropped.
+-----------------------------------------------------*/
+void testOverrun(void)
+{
+	uint16_t samples[ADC_RING_SIZE];
+	uint16_t first = adcEmuNow / 1000;
+
+	adcEmuRun(20);
+	CHECK_EQUAL(4, adcOverruns);
+	CHECK_EQUAL(ADC_RING_SIZE, adcRead(samples, ADC_RING_SIZE));
+	CHECK_EQUAL(0, checkFrames(samples, ADC_RING_SIZE, first));
+	adcEmuRun(1);
+	CHECK_EQUAL(2, adcRead(samples, ADC_RING_SIZE));
+	CHECK_EQUAL(0, checkFrames(samples, 2, first + 20));
+	CHECK_EQUAL(4, adcOverruns);
+}
+/* -----------------------------------------------------
+void testLong(void)
+Reads of random size keep up (at least 8 frames every 8 ms,
+sometimes more in between), indexes wrap, no frame is lost.
+-----------------------------------------------------*/
+void testLong(void)
+{
+	uint16_t samples[ADC_RING_SIZE];
+	long next;
+	int wrong = 0;
+	uint8_t overruns = adcOverruns;
+
+	adcStart();
+	next = adcEmuNow / 1000;
+	srand(17);
+	for (long ms = 0; ms < 100000; ms++)
+	{
+		adcEmuCompare();
+		if ((ms % 8 == 7) || (rand() % 4 == 0))
+		{
+			uint8_t frames = (ms % 8 == 7) ? 8 + rand() % 9 : rand() % 4;
+			uint8_t n = adcRead(samples, ADC_CHANNELS * frames);
+
+			wrong += checkFrames(samples, n, next) + (n % ADC_CHANNELS);
+			next += n / ADC_CHANNELS;
+		}
+	}
+	CHECK_EQUAL(0, wrong);
+	CHECK_EQUAL(overruns, adcOverruns);
+	CHECK(next > 99000);
+
+	adcStop();
+	adcEmuRun(5);
+	CHECK(adcRead(samples, ADC_RING_SIZE) <= ADC_RING_SIZE);
+	CHECK_EQUAL(0, adcRead(samples, ADC_RING_SIZE));
+}
+
+int main(void)
+{
+	testFrames();
+	testOverrun();
+	testLong();
+	return testDone("testAdcRing");
+}
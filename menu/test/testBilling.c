@@ -0,0 +1,134 @@
+/*---------------------------------------------------------
+Purpose: Host test of billing in ore (billing.c). Tariff is
+read from decimal string and from binary fixed point, the
+session total is energy times tariff rounded once to the
+nearest ore, half up, and the same total comes out in ASCII
+("250.49") and binary form, on its own and in package 87.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fixedPoint.h"
+#include "formPacket.h"
+#include "energyMeter.h"
+#include "billing.h"
+#include "testCheck.h"
+
+extern uint32_t powerScale;
+
+/* -----------------------------------------------------
+void feed(uint16_t voltage, uint16_t current, long frames)
+Adds constant frames one at a time.
+-----------------------------------------------------*/
+void feed(uint16_t voltage, uint16_t current, long frames)
+{
+	uint16_t frame[ADC_CHANNELS];
+
+	frame[ADC_VOLTAGE] = voltage;
+	frame[ADC_CURRENT] = current;
+	while (frames-- > 0)
+	{
+		energyMeterBlock(frame, ADC_CHANNELS);
+	}
+}
+/* -----------------------------------------------------
+void testTariff(void)
+Decimal strings, rounding of the third decimal, binary.
+-----------------------------------------------------*/
+void testTariff(void)
+{
+	const char binary[4] = {0, 0, 0x05, 0xDC};
+
+	billingTariffFromString("2.5");
+	CHECK_EQUAL(250, tariffOre);
+	billingTariffFromString("15");
+	CHECK_EQUAL(1500, tariffOre);
+	billingTariffFromString("1.255");
+	CHECK_EQUAL(126, tariffOre);
+	billingTariffFromString("1.254");
+	CHECK_EQUAL(125, tariffOre);
+	billingTariffFromString(" 0.07dkk");
+	CHECK_EQUAL(7, tariffOre);
+	billingTariffFromString("-3");
+	CHECK_EQUAL(0, tariffOre);
+	billingTariffFromBinary(binary);
+	CHECK_EQUAL(1500, tariffOre);
+}
+/* -----------------------------------------------------
+void testClose(void)
+Random sessions against exact product of the meter sum and
+tariff, rounded once.
+-----------------------------------------------------*/
+void testClose(void)
+{
+	int wrong = 0;
+
+	energyMeterLoadCalibration();
+	srand(17);
+	for (int n = 0; n < 3000; n++)
+	{
+		uint16_t voltage = rand() % 1024;
+		uint16_t current = rand() % 1024;
+		long frames = rand() % 3000;
+		int32_t tariff = rand() % 5000;
+		unsigned __int128 product;
+
+		energyMeterReset();
+		feed(voltage, current, frames);
+		billingSetTariff(tariff);
+		product = (unsigned __int128)((uint64_t)voltage * current * frames * powerScale / 16000) * tariff;
+		wrong += ((uint64_t)billingClose() != (uint64_t)((product + 500000) / 1000000));
+		wrong += (totalOre != billingClose());
+	}
+	CHECK_EQUAL(0, wrong);
+}
+/* -----------------------------------------------------
+void testSession(void)
+41 frames of 1000 * 1000 counts at 2.50: total in ASCII,
+binary and package 87 is the same number.
+-----------------------------------------------------*/
+void testSession(void)
+{
+	uint64_t nano;
+	int32_t total;
+	char str[FIXED_LENGTH_MAX + 1];
+	uint8_t bin[4];
+	char expected[24];
+
+	energyMeterReset();
+	feed(1000, 1000, 41);
+	billingTariffFromString("2.50");
+	total = billingClose();
+	nano = (uint64_t)1000 * 1000 * 41 * powerScale / 16000;
+	CHECK_EQUAL((nano * 250 + 500000) / 1000000, total);
+
+	billingToString(str, total, 0);
+	snprintf(expected, sizeof(expected), "%ld.%02ld", (long)total / 100, (long)total % 100);
+	CHECK(strcmp(str, expected) == 0);
+	billingToBinary(bin, total);
+	CHECK_EQUAL(total, getFixed32((char *)bin));
+
+	binaryMode = false;
+	CHECK(formPacketFixed("87", total));
+	CHECK(memcmp(formedDataPackageToSend, "020187", 6) == 0);
+	CHECK(memcmp(formedDataPackageToSend + 10, expected, strlen(expected)) == 0);
+	binaryMode = true;
+	CHECK(formPacketFixed("87", total));
+	CHECK_EQUAL(87, formedDataPackageToSend[4]);
+	CHECK_EQUAL(total, getFixed32(formedDataPackageToSend + 7));
+	binaryMode = false;
+	printf("testBilling: 41 frames of 1000 x 1000 counts at 2.50 dkk bill %ld ore (%s)\n", (long)total, str);
+}
+
+int main(void)
+{
+	testTariff();
+	testClose();
+	testSession();
+	return testDone("testBilling");
+}
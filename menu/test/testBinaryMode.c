@@ -0,0 +1,138 @@
+/*---------------------------------------------------------
+Purpose: Host test of binary package mode (formPacket.c and
+dataReceive.c). Packages are looped back: sendPacket queues
+them, USART_UDRE_vect moves bytes to UDR, the same byte is
+given to USART_RXC_vect and parser decodes it. Values in
+fixed point arrive unchanged in both modes and binary
+package of a value is shorter on wire than ASCII one.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <avr/io.h>
+#include "driverUSART.h"
+#include "dataReceive.h"
+#include "formPacket.h"
+#include "fixedPoint.h"
+#include "testCheck.h"
+
+extern void USART_UDRE_vect(void);
+extern void USART_RXC_vect(void);
+
+/* -----------------------------------------------------
+int loopback(void)
+Sends formed package, every byte that leaves UDR comes
+back to receiver. Returns bytes on wire.
+-----------------------------------------------------*/
+int loopback(void)
+{
+	int bytes = 0;
+
+	if (!binaryMode)
+	{
+		transmitUSART('*');
+		transmitUSART('-');
+	}
+	sendPacket();
+	while (UCSRB & (1<<UDRIE))
+	{
+		USART_UDRE_vect();
+		if (UCSRB & (1<<UDRIE))
+		{
+			USART_RXC_vect();
+			bytes++;
+		}
+	}
+	return bytes;
+}
+/* -----------------------------------------------------
+int32_t valueArrived(void)
+Value of received package in hundredths, whatever mode.
+-----------------------------------------------------*/
+int32_t valueArrived(void)
+{
+	if (binaryMode)
+	{
+		return (dl == 4) ? getFixed32(actualData) : -1;
+	}
+	return fixedParse(actualData, 2);
+}
+/* -----------------------------------------------------
+void testValues(bool binary)
+Values across int32 range survive the loop, sequence of
+binary package is the one it was sent with.
+-----------------------------------------------------*/
+void testValues(bool binary)
+{
+	const int32_t values[] = {0, 1, -1, 99, 10220, -10220, 123456789, 2147483647, -2147483647};
+
+	binaryMode = binary;
+	for (unsigned int i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+	{
+		formPacketFixed("86", values[i]);
+		loopback();
+		CHECK(receivePackage());
+		CHECK_EQUAL(RX_OK, _status);
+		CHECK_EQUAL(86, _command);
+		CHECK_EQUAL(2, _source);
+		CHECK_EQUAL(1, _destination);
+		CHECK_EQUAL(values[i], valueArrived());
+		if (binary)
+		{
+			CHECK_EQUAL(packetSequence, _sequence);
+		}
+	}
+	binaryMode = false;
+}
+/* -----------------------------------------------------
+void testSequenceWraps(void)
+Sequence number goes on through 255 to 0.
+-----------------------------------------------------*/
+void testSequenceWraps(void)
+{
+	binaryMode = true;
+	packetSequence = 250;
+	for (int i = 0; i < 10; i++)
+	{
+		formPacketBin(2, 1, 50, NULL, 0);
+		loopback();
+		CHECK(receivePackage());
+		CHECK_EQUAL((uint8_t)(251 + i), _sequence);
+		CHECK_EQUAL(0, dl);
+	}
+	binaryMode = false;
+}
+/* -----------------------------------------------------
+void testBytesOnWire(void)
+Binary package of a value is shorter than ASCII one.
+-----------------------------------------------------*/
+void testBytesOnWire(void)
+{
+	int ascii;
+	int binary;
+
+	binaryMode = false;
+	formPacketFixed("86", 1234567);
+	ascii = loopback();
+	CHECK(receivePackage());
+	binaryMode = true;
+	formPacketFixed("86", 1234567);
+	binary = loopback();
+	CHECK(receivePackage());
+	binaryMode = false;
+	CHECK(binary < ascii);
+	printf("testBinaryMode: 12345.67 takes %d bytes on wire in ASCII, %d in binary\n", ascii, binary);
+}
+
+int main(void)
+{
+	testValues(false);
+	testValues(true);
+	testSequenceWraps();
+	testBytesOnWire();
+	return testDone("testBinaryMode");
+}
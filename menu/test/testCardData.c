@@ -0,0 +1,259 @@
+/*---------------------------------------------------------
+Purpose: Host test of binary card record (cardData.c) and
+of writing it by fake reader. Random records go through
+encode and decode unchanged, block has the layout of
+cardData.c. Every wrong version byte and every bit flip is
+refused, legacy ASCII blocks are parsed and blank block is
+0 debt. Log out writes record by one 0x57 command, card
+read after it gives the same record, legacy card is binary
+after its first write. Prints tap to written time.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "crc16.h"
+#include "driverRFID.h"
+#include "fakeReader.h"
+#include "testCheck.h"
+
+bool sameRecord(const cardRecord *a, const cardRecord *b)
+{
+	return (a->sequence == b->sequence) && (a->debt == b->debt) &&
+		   (a->pastEnergy == b->pastEnergy) && (a->pastExpense == b->pastExpense);
+}
+
+int32_t randomValue(void)
+{
+	switch (rand() % 4)
+	{
+		case 0:
+		return rand() % 100000;
+
+		case 1:
+		return -(rand() % 100000);
+
+		case 2:
+		return (rand() % 2) ? INT32_MAX : INT32_MIN;
+
+		default:
+		return ((uint32_t)rand() << 16) ^ rand();
+	}
+}
+/* -----------------------------------------------------
+void testLayout(void)
+Version, sequence, values most significant first, check
+sum of bytes 0..13.
+-----------------------------------------------------*/
+void testLayout(void)
+{
+	const cardRecord record = {"", 0x2A, 0x01020304, -2, 6476};
+	const uint8_t values[12] = {0x01, 0x02, 0x03, 0x04, 0xFF, 0xFF, 0xFF, 0xFE, 0x00, 0x00, 0x19, 0x4C};
+	uint8_t block[CARD_BLOCK_SIZE];
+	uint16_t crc = CRC16_INIT;
+
+	cardDataEncode(&record, block);
+	CHECK_EQUAL(CARD_DATA_VERSION, block[0]);
+	CHECK_EQUAL(0x2A, block[1]);
+	CHECK(memcmp(block + 2, values, sizeof(values)) == 0);
+	for (uint8_t i = 0; i < 14; i++)
+	{
+		crc = crc16Update(crc, block[i]);
+	}
+	CHECK_EQUAL(crc >> 8, block[14]);
+	CHECK_EQUAL(crc & 0xFF, block[15]);
+}
+/* -----------------------------------------------------
+void testRoundTrip(void)
+100000 random records.
+-----------------------------------------------------*/
+void testRoundTrip(void)
+{
+	int wrong = 0;
+
+	srand(25);
+	for (long i = 0; i < 100000; i++)
+	{
+		cardRecord record = {"", rand() % 256, randomValue(), randomValue(), randomValue()};
+		cardRecord back;
+		uint8_t block[CARD_BLOCK_SIZE];
+
+		cardDataEncode(&record, block);
+		wrong += !cardDataDecode(&back, (char *)block, NULL, NULL) || !sameRecord(&record, &back);
+	}
+	CHECK_EQUAL(0, wrong);
+}
+/* -----------------------------------------------------
+void testCorrupted(void)
+Each of 255 wrong version bytes and each single bit flip
+of bytes 1..15 is refused with zero values.
+-----------------------------------------------------*/
+void testCorrupted(void)
+{
+	const cardRecord record = {"", 7, 6476, 123456, 9900};
+	uint8_t block[CARD_BLOCK_SIZE];
+	cardRecord back;
+	int taken = 0;
+	int nonZero = 0;
+
+	for (int v = 0; v < 256; v++)
+	{
+		if (v != CARD_DATA_VERSION)
+		{
+			cardDataEncode(&record, block);
+			block[0] = v;
+			taken += cardDataDecode(&back, (char *)block, NULL, NULL);
+			nonZero += (back.debt != 0);
+		}
+	}
+	for (uint8_t i = 1; i < CARD_BLOCK_SIZE; i++)
+	{
+		for (uint8_t bit = 0; bit < 8; bit++)
+		{
+			cardDataEncode(&record, block);
+			block[i] ^= 1 << bit;
+			taken += cardDataDecode(&back, (char *)block, NULL, NULL);
+			nonZero += (back.debt != 0);
+		}
+	}
+	CHECK_EQUAL(0, taken);
+	CHECK_EQUAL(0, nonZero);
+}
+/* -----------------------------------------------------
+void testLegacy(void)
+ASCII blocks padded with zero bytes, blank block, block
+that is neither, block with no zero byte at the end.
+-----------------------------------------------------*/
+void testLegacy(void)
+{
+	char debt[CARD_BLOCK_SIZE] = "64.76";
+	char energy[CARD_BLOCK_SIZE] = "1234.5";
+	char expense[CARD_BLOCK_SIZE] = " 12.50";
+	char blank[CARD_BLOCK_SIZE] = {0};
+	char other[CARD_BLOCK_SIZE] = "64.76x";
+	cardRecord back;
+
+	CHECK(cardDataDecode(&back, debt, energy, expense));
+	CHECK_EQUAL(0, back.sequence);
+	CHECK_EQUAL(6476, back.debt);
+	CHECK_EQUAL(123450, back.pastEnergy);
+	CHECK_EQUAL(1250, back.pastExpense);
+	CHECK(cardDataDecode(&back, debt, NULL, NULL));
+	CHECK_EQUAL(6476, back.debt);
+	CHECK_EQUAL(0, back.pastEnergy);
+	CHECK(cardDataDecode(&back, blank, NULL, NULL));
+	CHECK_EQUAL(0, back.debt);
+	CHECK(!cardDataDecode(&back, other, NULL, NULL));
+	memcpy(debt, "00000000064.7600", CARD_BLOCK_SIZE);
+	CHECK(cardDataDecode(&back, debt, NULL, NULL));
+	CHECK_EQUAL(6476, back.debt);
+}
+
+readerEdge edges[2];
+
+/* -----------------------------------------------------
+void put(void), void takeAway(void)
+Card is put 10 ms from now, taken away 10 ms after driver
+has done.
+-----------------------------------------------------*/
+void put(void)
+{
+	edges[0].ms = readerNowUs / 1000 + 10;
+	edges[0].line = READER_INT0;
+	readerScript(edges, 1);
+	readerCommands = 0;
+	rfidDone = false;
+}
+
+void takeAway(void)
+{
+	edges[1].ms = readerNowUs / 1000 + 10;
+	edges[1].line = READER_INT0;
+	readerScript(edges + 1, 1);
+	readerRun(20);
+}
+
+void readCard(void)
+{
+	put();
+	offlineFirstRead = true;
+	RFIDinit(1, "64.76", 5);
+	takeAway();
+}
+/* -----------------------------------------------------
+uint32_t writeCard(void)
+Log out as endSessionm does it, returns ms from tap to
+written.
+-----------------------------------------------------*/
+uint32_t writeCard(void)
+{
+	uint32_t tapMs;
+
+	put();
+	tapMs = edges[0].ms;
+	offlineWrite = true;
+	RFIDinit(5, "write", 5);
+	offlineWrite = false;
+	tapMs = readerNowUs / 1000 - tapMs;
+	takeAway();
+	return tapMs;
+}
+/* -----------------------------------------------------
+void testWriteAndRead(void)
+Record written by one command is read back, also from a
+legacy card.
+-----------------------------------------------------*/
+void testWriteAndRead(void)
+{
+	cardRecord written = {"", 9, 2550, 36000, 2550};
+	uint8_t block[CARD_BLOCK_SIZE];
+	uint32_t took;
+
+	readerReset();
+	memcpy(readerCard[1], "4321", 4);
+	cardInfo = written;
+	took = writeCard();
+	CHECK_EQUAL(1, readerCommands);
+	cardDataEncode(&written, block);
+	CHECK(memcmp(readerCard[CARD_DATA_BLOCK], block, CARD_BLOCK_SIZE) == 0);
+	memset(&cardInfo, 0, sizeof(cardInfo));
+	readCard();
+	CHECK(cardRecordValid);
+	CHECK(sameRecord(&written, &cardInfo));
+	printf("log out: 1 command, tap to written %lu ms\n", (unsigned long)took);
+
+	readerReset();
+	memcpy(readerCard[1], "1111", 4);
+	strcpy((char *)readerCard[CARD_DATA_BLOCK], "64.76");
+	strcpy((char *)readerCard[CARD_LEGACY_EXPENSE_BLOCK], "3.10");
+	strcpy((char *)readerCard[CARD_LEGACY_ENERGY_BLOCK], "12.5");
+	readCard();
+	CHECK(cardRecordValid);
+	CHECK_EQUAL(6476, cardInfo.debt);
+	cardInfo.debt += 310;
+	cardInfo.sequence++;
+	written = cardInfo;
+	writeCard();
+	CHECK_EQUAL(CARD_DATA_VERSION, readerCard[CARD_DATA_BLOCK][0]);
+	readCard();
+	CHECK(cardRecordValid);
+	CHECK_EQUAL(1, cardInfo.sequence);
+	CHECK_EQUAL(6786, cardInfo.debt);
+	CHECK_EQUAL(1250, cardInfo.pastEnergy);
+	CHECK_EQUAL(310, cardInfo.pastExpense);
+	CHECK(sameRecord(&written, &cardInfo));
+}
+
+int main(void)
+{
+	testLayout();
+	testRoundTrip();
+	testCorrupted();
+	testLegacy();
+	testWriteAndRead();
+	return testDone("testCardData");
+}
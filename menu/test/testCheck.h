@@ -0,0 +1,42 @@
+/*---------------------------------------------------------
+Purpose: Minimal check macros for host tests. CHECK counts
+failed conditions and prints where they are, testDone()
+prints the summary and gives the exit code for make.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+#include <stdio.h>
+
+static int testChecks = 0;
+static int testFailures = 0;
+
+#define CHECK(condition) do { \
+	testChecks++; \
+	if (!(condition)) { \
+		testFailures++; \
+		printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+	} \
+} while (0)
+
+#define CHECK_EQUAL(expected, actual) do { \
+	long long testExpected = (long long)(expected); \
+	long long testActual = (long long)(actual); \
+	testChecks++; \
+	if (testExpected != testActual) { \
+		testFailures++; \
+		printf("%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, testActual, testExpected); \
+	} \
+} while (0)
+
+static inline int testDone(const char *name)
+{
+	printf("%s: %d checks, %d failed\n", name, testChecks, testFailures);
+	return (testFailures == 0) ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,190 @@
+/*---------------------------------------------------------
+Purpose: Host test of CRC-16/CCITT (crc16.c). Nibble table
+version is compared with bit by bit calculation for every
+byte value and register state, standard check value of
+"123456789" is 0x29B1. Package formed by formPacket carries
+check sum of its header and data as four hex digits.
+Prints cost per byte of CRC-16 and of the xor check sum it
+replaced, measured on PC and counted for the AVR.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "crc16.h"
+#include "formPacket.h"
+#include "testCheck.h"
+
+/* AVR cycles per byte counted by hand from the C code. CRC:
+two nibbles, each 16 bit shift by 4, index, lpm of the table
+word and eor, with call and return. Xor: load, eor, loop.
+Byte on the 9600 baud line at 10 MHz is 10 bits long. */
+#define CRC_CYCLES 64
+#define XOR_CYCLES 7
+#define LINE_BYTE_CYCLES (10000000UL * 10 / 9600)
+
+/* -----------------------------------------------------
+uint16_t crc16Bitwise(uint16_t crc, uint8_t byte)
+Reference, polynomial 0x1021 one bit at a time.
+-----------------------------------------------------*/
+uint16_t crc16Bitwise(uint16_t crc, uint8_t byte)
+{
+	crc ^= (uint16_t)byte << 8;
+	for (int i = 0; i < 8; i++)
+	{
+		crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+	}
+	return crc;
+}
+/* -----------------------------------------------------
+void testTable(void)
+Every register state and byte gives the same as reference.
+-----------------------------------------------------*/
+void testTable(void)
+{
+	int wrong = 0;
+
+	for (uint32_t crc = 0; crc < 0x10000; crc += 0x0101)
+	{
+		for (int byte = 0; byte < 256; byte++)
+		{
+			wrong += (crc16Update(crc, byte) != crc16Bitwise(crc, byte));
+		}
+	}
+	CHECK_EQUAL(0, wrong);
+}
+/* -----------------------------------------------------
+void testCheckValue(void)
+CRC-16/CCITT-FALSE of "123456789".
+-----------------------------------------------------*/
+void testCheckValue(void)
+{
+	const char *text = "123456789";
+	uint16_t crc = CRC16_INIT;
+	char hex[5] = {0};
+
+	while (*text)
+	{
+		crc = crc16Update(crc, *text++);
+	}
+	CHECK_EQUAL(0x29B1, crc);
+	crc16ToHex(crc, hex);
+	CHECK(strcmp(hex, "29B1") == 0);
+	crc16ToHex(0x0A0F, hex);
+	CHECK(strcmp(hex, "0A0F") == 0);
+}
+/* -----------------------------------------------------
+void testPackage(void)
+Check sum of formed package covers header and data.
+-----------------------------------------------------*/
+void testPackage(void)
+{
+	uint16_t crc = CRC16_INIT;
+	char hex[5] = {0};
+
+	binaryMode = false;
+	formPacket("02", "01", "86", "102.20");
+	CHECK_EQUAL(22, formedPacketLength);
+	CHECK(strncmp(formedDataPackageToSend, "0201860006102.20", 16) == 0);
+	for (int i = 0; i < 16; i++)
+	{
+		crc = crc16Update(crc, formedDataPackageToSend[i]);
+	}
+	crc16ToHex(crc, hex);
+	CHECK(strncmp(formedDataPackageToSend + 16, hex, 4) == 0);
+	CHECK(strcmp(formedDataPackageToSend + 20, "-*") == 0);
+}
+/* -----------------------------------------------------
+void testSingleErrors(void)
+Every single bit error in a package changes check sum.
+-----------------------------------------------------*/
+void testSingleErrors(void)
+{
+	char package[] = "0201860006102.20";
+	int n = strlen(package);
+	uint16_t good = CRC16_INIT;
+	int undetected = 0;
+
+	for (int i = 0; i < n; i++)
+	{
+		good = crc16Update(good, package[i]);
+	}
+	for (int bit = 0; bit < n * 8; bit++)
+	{
+		uint16_t crc = CRC16_INIT;
+
+		package[bit / 8] ^= 1 << (bit % 8);
+		for (int i = 0; i < n; i++)
+		{
+			crc = crc16Update(crc, package[i]);
+		}
+		package[bit / 8] ^= 1 << (bit % 8);
+		undetected += (crc == good);
+	}
+	CHECK_EQUAL(0, undetected);
+}
+
+/* -----------------------------------------------------
+void testCost(void)
+CRC-16 and xor loop of formPacket before it over the same
+bytes, time per byte on PC. Both estimates for the AVR must
+be small part of the time the byte is on the line.
+-----------------------------------------------------*/
+void testCost(void)
+{
+	static uint8_t bytes[4096];
+	const int rounds = 2000;
+	volatile uint16_t crcSink;
+	volatile uint8_t xorSink;
+	clock_t start;
+	double crcNs;
+	double xorNs;
+
+	for (unsigned i = 0; i < sizeof(bytes); i++)
+	{
+		bytes[i] = i * 7;
+	}
+	start = clock();
+	for (int r = 0; r < rounds; r++)
+	{
+		uint16_t crc = CRC16_INIT;
+
+		for (unsigned i = 0; i < sizeof(bytes); i++)
+		{
+			crc = crc16Update(crc, bytes[i]);
+		}
+		crcSink = crc;
+	}
+	crcNs = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / rounds / sizeof(bytes);
+	start = clock();
+	for (int r = 0; r < rounds; r++)
+	{
+		char xor = 0;
+
+		for (unsigned i = 0; i < sizeof(bytes); i++)
+		{
+			xor = xor ^ ((volatile uint8_t *)bytes)[i];
+		}
+		xorSink = xor;
+	}
+	xorNs = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / rounds / sizeof(bytes);
+	(void)crcSink;
+	(void)xorSink;
+	CHECK(CRC_CYCLES * 100 < LINE_BYTE_CYCLES);
+	printf("per byte: CRC-16 %.2f ns, xor %.2f ns on PC; about %d and %d cycles on AVR, of %lu a byte takes on the line\n",
+		   crcNs, xorNs, CRC_CYCLES, XOR_CYCLES, (unsigned long)LINE_BYTE_CYCLES);
+}
+
+int main(void)
+{
+	testTable();
+	testCheckValue();
+	testPackage();
+	testSingleErrors();
+	testCost();
+	return testDone("testCrc16");
+}
@@ -0,0 +1,169 @@
+/*---------------------------------------------------------
+Purpose: Host test of integer energy meter (energyMeter.c).
+Energy of random frames is exactly the rounded sum of
+products times the precomputed power scale, and it stays
+within scale rounding of the exact value over a session of
+ten million frames (2.8 hours at 1 kHz), where 32 bit float
+accumulation drifts. Scaled energy (price) is rounded only
+once, negative energy reads 0, power and RMS current of
+constant frames are right.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "energyMeter.h"
+#include "testCheck.h"
+
+extern meterCalibration calibration;
+extern uint32_t powerScale;
+
+/* nWs in one unit of the last decimal */
+const uint32_t units[ENERGY_NANO_DECIMALS + 1] = {1000000, 100000, 10000, 1000, 100, 10, 1};
+
+/* -----------------------------------------------------
+uint64_t rounded(unsigned __int128 value, uint64_t divisor)
+Value / divisor rounded to nearest, half up.
+-----------------------------------------------------*/
+uint64_t rounded(unsigned __int128 value, uint64_t divisor)
+{
+	return (value + divisor / 2) / divisor;
+}
+/* -----------------------------------------------------
+void feed(uint16_t voltage, uint16_t current, long frames)
+Adds constant frames in blocks of 16.
+-----------------------------------------------------*/
+void feed(uint16_t voltage, uint16_t current, long frames)
+{
+	uint16_t block[ADC_RING_SIZE];
+
+	for (uint8_t i = 0; i < ADC_RING_SIZE; i += ADC_CHANNELS)
+	{
+		block[i + ADC_VOLTAGE] = voltage;
+		block[i + ADC_CURRENT] = current;
+	}
+	while (frames >= ADC_RING_SIZE / ADC_CHANNELS)
+	{
+		energyMeterBlock(block, ADC_RING_SIZE);
+		frames -= ADC_RING_SIZE / ADC_CHANNELS;
+	}
+	energyMeterBlock(block, frames * ADC_CHANNELS);
+}
+/* -----------------------------------------------------
+void testSession(void)
+Random blocks of random frames, exact sum kept aside.
+-----------------------------------------------------*/
+void testSession(void)
+{
+	uint16_t block[ADC_RING_SIZE];
+	uint64_t sum = 0;
+	float floatEnergy = 0;
+	double exact;
+	double meter;
+	long frames = 0;
+	int wrong = 0;
+
+	energyMeterLoadCalibration();
+	energyMeterReset();
+	srand(15);
+	while (frames < 10000000)
+	{
+		uint8_t n = ADC_CHANNELS * (1 + rand() % (ADC_RING_SIZE / ADC_CHANNELS));
+
+		for (uint8_t i = 0; i < n; i += ADC_CHANNELS)
+		{
+			block[i + ADC_VOLTAGE] = rand() % 1024;
+			block[i + ADC_CURRENT] = rand() % 1024;
+			sum += (uint32_t)block[i + ADC_VOLTAGE] * block[i + ADC_CURRENT];
+			floatEnergy += (float)block[i + ADC_VOLTAGE] * block[i + ADC_CURRENT] * powerScale / 16.0f / ENERGY_SAMPLE_HZ / 1e6f;
+		}
+		energyMeterBlock(block, n);
+		frames += n / ADC_CHANNELS;
+		if (rand() % 1000 == 0)
+		{
+			uint8_t decimals = rand() % 4;
+			uint64_t nano = (unsigned __int128)sum * powerScale / ((uint32_t)ENERGY_SAMPLE_HZ << ENERGY_FRACTION_BITS);
+
+			wrong += (energyMeterEnergy(decimals) != rounded(nano, units[decimals]));
+		}
+	}
+	CHECK_EQUAL(0, wrong);
+
+	exact = (double)sum * calibration.gain[ADC_VOLTAGE] * calibration.gain[ADC_CURRENT] / ENERGY_SAMPLE_HZ / 1e15;
+	meter = energyMeterEnergy(3) / 1e3;
+	CHECK((meter - exact) / exact < 0.5 / powerScale);
+	CHECK((exact - meter) / exact < 0.5 / powerScale);
+	printf("testEnergyMeter: %ld frames, exact %.3f mWs, meter %+.3f mWs off (scale rounding), 32 bit float %+.0f mWs off\n",
+		   frames, exact, meter - exact, floatEnergy - meter);
+}
+/* -----------------------------------------------------
+void testScaled(void)
+Energy times price, rounded once.
+-----------------------------------------------------*/
+void testScaled(void)
+{
+	int wrong = 0;
+	int tried = 0;
+
+	srand(16);
+	for (int n = 0; n < 4000; n++)
+	{
+		uint16_t voltage = rand() % 1024;
+		uint16_t current = rand() % 1024;
+		long frames = rand() % 5000;
+		uint32_t factor = rand() % (1UL << 24);
+		uint8_t decimals = rand() % 3;
+		uint64_t nano;
+		uint64_t expected;
+
+		energyMeterReset();
+		feed(voltage, current, frames);
+		nano = (unsigned __int128)voltage * current * frames * powerScale / ((uint32_t)ENERGY_SAMPLE_HZ << ENERGY_FRACTION_BITS);
+		expected = rounded((unsigned __int128)nano * factor, units[decimals]);
+		if (expected > UINT32_MAX)
+		{
+			continue;											//sum does not fit the result
+		}
+		tried++;
+		wrong += (energyMeterScaled(factor, decimals) != expected);
+	}
+	CHECK_EQUAL(0, wrong);
+	CHECK(tried > 1000);
+}
+/* -----------------------------------------------------
+void testPowerAndCurrent(void)
+Constant frames: power after filter has settled, RMS
+current is the current, energy back to grid reads 0.
+-----------------------------------------------------*/
+void testPowerAndCurrent(void)
+{
+	meterCalibration offsetVoltage = {{512, 0}, {4882813UL, 3906UL}};
+	uint32_t expected;
+
+	energyMeterReset();
+	feed(700, 300, 4000);
+	expected = rounded((uint64_t)700 * 300 * powerScale, 16 * 1000);
+	CHECK(labs((long)energyMeterPower(3) - (long)expected) <= (long)expected / 1000);
+	CHECK_EQUAL(rounded((uint64_t)300 * 3906, 1000), energyMeterCurrent(3));
+	CHECK_EQUAL(0, energyMeterPower(3) - energyMeterPower(3));
+
+	energyMeterSaveCalibration(&offsetVoltage);
+	energyMeterReset();
+	feed(400, 300, 1000);
+	CHECK_EQUAL(0, energyMeterEnergy(3));
+	CHECK_EQUAL(0, energyMeterPower(3));
+	feed(700, 300, 1000);
+	CHECK_EQUAL(rounded((uint64_t)(188 - 112) * 300 * 1000 * powerScale, 16 * 1000 * 1000), energyMeterEnergy(3));
+}
+
+int main(void)
+{
+	testSession();
+	testScaled();
+	testPowerAndCurrent();
+	return testDone("testEnergyMeter");
+}
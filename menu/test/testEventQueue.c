@@ -0,0 +1,133 @@
+/*---------------------------------------------------------
+Purpose: Host test of event queue (eventQueue.c). Events
+come out in the order they were posted, full queue drops
+and counts the newest event, clear drops all waiting ones.
+Soak: million random posts and gets compared with a plain
+array model, indexes wrap all the time.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "eventQueue.h"
+#include "testCheck.h"
+
+/* -----------------------------------------------------
+void testOrder(void)
+FIFO order, empty queue gives nothing.
+-----------------------------------------------------*/
+void testOrder(void)
+{
+	eventQueue q = {{0}, 0, 0, 0};
+	uint8_t event;
+
+	CHECK(eventQueueEmpty(&q));
+	CHECK(!eventGet(&q, &event));
+	for (uint8_t e = 1; e <= 5; e++)
+	{
+		CHECK(eventPost(&q, e));
+	}
+	CHECK(!eventQueueEmpty(&q));
+	for (uint8_t e = 1; e <= 5; e++)
+	{
+		CHECK(eventGet(&q, &event));
+		CHECK_EQUAL(e, event);
+	}
+	CHECK(eventQueueEmpty(&q));
+}
+/* -----------------------------------------------------
+void testFull(void)
+EVENT_QUEUE_SIZE events fit, the next is refused and
+counted, the ones in queue stay.
+-----------------------------------------------------*/
+void testFull(void)
+{
+	eventQueue q = {{0}, 250, 250, 0};
+	uint8_t event;
+
+	for (uint8_t e = 0; e < EVENT_QUEUE_SIZE; e++)
+	{
+		CHECK(eventPost(&q, e));
+	}
+	CHECK(!eventPost(&q, 99));
+	CHECK(!eventPost(&q, 98));
+	CHECK_EQUAL(2, q.overflows);
+	for (uint8_t e = 0; e < EVENT_QUEUE_SIZE; e++)
+	{
+		CHECK(eventGet(&q, &event));
+		CHECK_EQUAL(e, event);
+	}
+	CHECK(!eventGet(&q, &event));
+}
+/* -----------------------------------------------------
+void testClear(void)
+Clear empties queue, posting works after it.
+-----------------------------------------------------*/
+void testClear(void)
+{
+	eventQueue q = {{0}, 0, 0, 0};
+	uint8_t event;
+
+	eventPost(&q, 1);
+	eventPost(&q, 2);
+	eventQueueClear(&q);
+	CHECK(eventQueueEmpty(&q));
+	CHECK(eventPost(&q, 3));
+	CHECK(eventGet(&q, &event) && (event == 3));
+}
+/* -----------------------------------------------------
+void testSoak(void)
+Random posts and gets against model.
+-----------------------------------------------------*/
+void testSoak(void)
+{
+	eventQueue q = {{0}, 0, 0, 0};
+	uint8_t model[EVENT_QUEUE_SIZE];
+	int count = 0;
+	int first = 0;
+	int mismatches = 0;
+	int overflows = 0;
+
+	srand(9);
+	for (long i = 0; i < 1000000; i++)
+	{
+		uint8_t event = rand() % 256;
+
+		if (rand() % 2)
+		{
+			bool fits = (count < EVENT_QUEUE_SIZE);
+
+			mismatches += (eventPost(&q, event) != fits);
+			if (fits)
+			{
+				model[(first + count++) % EVENT_QUEUE_SIZE] = event;
+			}else{
+				overflows++;
+			}
+		}else{
+			bool got = eventGet(&q, &event);
+
+			mismatches += (got != (count > 0));
+			if (got && (count > 0))
+			{
+				mismatches += (event != model[first]);
+				first = (first + 1) % EVENT_QUEUE_SIZE;
+				count--;
+			}
+		}
+	}
+	CHECK_EQUAL(0, mismatches);
+	CHECK_EQUAL((uint8_t)overflows, q.overflows);
+}
+
+int main(void)
+{
+	testOrder();
+	testFull();
+	testClear();
+	testSoak();
+	return testDone("testEventQueue");
+}
@@ -0,0 +1,172 @@
+/*---------------------------------------------------------
+Purpose: Host test of fixed point conversions (fixedPoint.c).
+fixedFormat gives the same string as snprintf("%*.*f") of
+the same number for random values, decimals and widths, and
+stars when number does not fit. fixedParse rounds on the
+first digit that does not fit, as decimal rounding half away
+from zero does, skips spaces, stops on other chars and
+saturates. Formatted value parses back to itself.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "fixedPoint.h"
+#include "testCheck.h"
+
+const double scales[10] = {1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+/* -----------------------------------------------------
+int32_t randomValue(void)
+Values of all lengths, both signs, and the ends of range.
+-----------------------------------------------------*/
+int32_t randomValue(void)
+{
+	int32_t value;
+
+	switch (rand() % 8)
+	{
+		case 0:
+		return (rand() % 2) ? INT32_MAX : INT32_MIN;
+
+		case 1:
+		value = rand() % 10;
+		break;
+
+		default:
+		value = (((int32_t)rand() << 16) ^ rand()) % (int32_t)scales[rand() % 10];
+		break;
+	}
+	return (rand() % 2) ? -value : value;
+}
+/* -----------------------------------------------------
+void testFormat(void)
+Against snprintf, right aligned, left aligned and width 0.
+-----------------------------------------------------*/
+void testFormat(void)
+{
+	char expected[40];
+	char str[FIXED_LENGTH_MAX + 8];
+	int wrong = 0;
+	int stars = 0;
+
+	srand(14);
+	for (long n = 0; n < 200000; n++)
+	{
+		int32_t value = randomValue();
+		uint8_t decimals = rand() % 10;
+		uint8_t width = rand() % (FIXED_LENGTH_MAX + 1);
+		bool right = rand() % 2;
+		uint8_t length;
+		int needed;
+
+		needed = snprintf(expected, sizeof(expected), "%.*f", decimals, value / scales[decimals]);
+		if (width == 0)
+		{
+			/* whole number, as long as it is */
+		}else if (needed > width)
+		{
+			memset(expected, '*', width);
+			expected[width] = '\0';
+			stars++;
+		}else if (right)
+		{
+			snprintf(expected, sizeof(expected), "%*.*f", width, decimals, value / scales[decimals]);
+		}
+		memset(str, 'x', sizeof(str));
+		length = fixedFormat(str, value, decimals, width, right);
+		wrong += (strcmp(str, expected) != 0) || (length != strlen(expected));
+		wrong += (width != 0) && (str[width + 1] != 'x');			//never past width + 1 bytes
+	}
+	CHECK_EQUAL(0, wrong);
+	CHECK(stars > 0);
+
+	CHECK_EQUAL(6, fixedFormat(str, -1205, 2, 0, false));
+	CHECK(strcmp(str, "-12.05") == 0);
+	fixedFormat(str, 5, 3, 7, true);
+	CHECK(strcmp(str, "  0.005") == 0);
+	fixedFormat(str, 1234567, 1, 7, true);
+	CHECK(strcmp(str, "*******") == 0);
+}
+/* -----------------------------------------------------
+void testParse(void)
+Random strings with one digit more than decimals.
+-----------------------------------------------------*/
+void testParse(void)
+{
+	char str[40];
+	int wrong = 0;
+
+	srand(15);
+	for (long n = 0; n < 200000; n++)
+	{
+		int decimals = rand() % 5;
+		int32_t whole = rand() % 100000;
+		int32_t fraction = rand() % (int32_t)scales[decimals];
+		int extra = rand() % 10;
+		bool negative = rand() % 2;
+		int64_t expected = (int64_t)whole * (int32_t)scales[decimals] + fraction + (extra >= 5);
+		int length;
+
+		length = sprintf(str, "%*s%s%d", rand() % 3, "", negative ? "-" : (rand() % 2) ? "+" : "", whole);
+		if (decimals > 0)
+		{
+			length += sprintf(str + length, ".%0*d", decimals, fraction);
+		}else{
+			length += sprintf(str + length, ".");
+		}
+		sprintf(str + length, "%d%s", extra, (rand() % 2) ? "kWh" : "");
+		if (negative)
+		{
+			expected = -expected;
+		}
+		wrong += (fixedParse(str, decimals) != expected);
+	}
+	CHECK_EQUAL(0, wrong);
+
+	CHECK_EQUAL(1250, fixedParse(" 12.5kWh", 2));
+	CHECK_EQUAL(-102, fixedParse("-1.015", 2));
+	CHECK_EQUAL(1200, fixedParse("12", 2));
+	CHECK_EQUAL(12, fixedParse("12.3.4", 0));
+	CHECK_EQUAL(INT32_MAX, fixedParse("99999999999", 0));
+	CHECK_EQUAL(-INT32_MAX, fixedParse("-99999999999", 0));
+	CHECK_EQUAL(INT32_MAX, fixedParse("30000000", 2));
+	CHECK_EQUAL(0, fixedParse("kWh", 2));
+}
+/* -----------------------------------------------------
+void testRoundTrip(void)
+Formatted number parses back to itself.
+-----------------------------------------------------*/
+void testRoundTrip(void)
+{
+	char str[FIXED_LENGTH_MAX + 1];
+	int wrong = 0;
+
+	srand(16);
+	for (long n = 0; n < 200000; n++)
+	{
+		int32_t value = randomValue();
+		uint8_t decimals = rand() % 10;
+
+		if (value == INT32_MIN)
+		{
+			continue;											//parse saturates at -INT32_MAX
+		}
+		fixedFormat(str, value, decimals, 0, false);
+		wrong += (fixedParse(str, decimals) != value);
+	}
+	CHECK_EQUAL(0, wrong);
+}
+
+int main(void)
+{
+	testFormat();
+	testParse();
+	testRoundTrip();
+	return testDone("testFixedPoint");
+}
@@ -0,0 +1,118 @@
+/*---------------------------------------------------------
+Purpose: Host test of timer scanned keypad (driverKeyPad.c)
+with scripted presses whose contacts bounce up to 8 ms at
+press and at release. Every key of the pad is decoded, no
+press is missed or doubled, latency from press to key in
+FIFO is measured. keypad_get waits up to its timeout, keys
+typed while nobody reads wait in FIFO.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "eventQueue.h"
+#include "driverKeyPad.h"
+#include "fakeKeyPad.h"
+#include "testCheck.h"
+
+#define PRESSES 2000
+
+extern eventQueue keyEvents;
+extern char key_table[4][4];
+
+keyPress presses[PRESSES];
+
+/* -----------------------------------------------------
+void testBounce(void)
+Presses of random keys, held 40 - 100 ms, 60 - 150 ms apart.
+-----------------------------------------------------*/
+void testBounce(void)
+{
+	uint32_t at = 100;
+	int next = 0;
+	int wrong = 0;
+	int extra = 0;
+	unsigned long latency = 0;
+	uint32_t worst = 0;
+	uint8_t event;
+
+	srand(20);
+	for (int i = 0; i < PRESSES; i++)
+	{
+		presses[i].key = key_table[rand() % 4][rand() % 4];
+		presses[i].pressMs = at;
+		presses[i].pressBounceMs = rand() % 9;
+		presses[i].releaseMs = at + 40 + rand() % 61;
+		presses[i].releaseBounceMs = rand() % 9;
+		at = presses[i].releaseMs + presses[i].releaseBounceMs + 60 + rand() % 91;
+	}
+	keyNow = 0;
+	keypad_init();
+	keyScript(presses, PRESSES);
+	while (keyNow < at)
+	{
+		keyRun(1);
+		while (eventGet(&keyEvents, &event))
+		{
+			if (next == PRESSES)
+			{
+				extra++;
+				continue;
+			}
+			wrong += (event != presses[next].key);
+			wrong += (keyNow >= presses[next].releaseMs + presses[next].releaseBounceMs);
+			latency += keyNow - presses[next].pressMs;
+			if (keyNow - presses[next].pressMs > worst)
+			{
+				worst = keyNow - presses[next].pressMs;
+			}
+			next++;
+		}
+	}
+	CHECK_EQUAL(PRESSES, next);
+	CHECK_EQUAL(0, wrong);
+	CHECK_EQUAL(0, extra);
+	printf("testKeyPad: %d presses with up to 8 ms bounce, %d missed, latency mean %.1f ms, max %u ms\n",
+		   PRESSES, PRESSES - next, (double)latency / next, (unsigned)worst);
+}
+/* -----------------------------------------------------
+void testGet(void)
+Timeout, key that comes while waiting, keys typed ahead.
+Waiting forever does not read the tick, so here time would
+not go on, KEYPAD_FOREVER is used when a key is in FIFO.
+-----------------------------------------------------*/
+void testGet(void)
+{
+	const keyPress typed[] = {
+		{'5', 100, 2, 150, 2},
+		{'1', 300, 0, 340, 0},
+		{'C', 420, 3, 470, 1},
+		{'0', 540, 1, 590, 0}
+	};
+	uint32_t start;
+
+	keyNow = 0;
+	keypad_init();
+	keyScript(typed, 4);
+	CHECK_EQUAL(KEYPAD_NO_KEY, keypad_get(KEYPAD_NO_WAIT));
+	start = keyNow;
+	CHECK_EQUAL(KEYPAD_NO_KEY, keypad_get(50));
+	CHECK((keyNow - start >= 50) && (keyNow - start <= 51));
+	CHECK_EQUAL('5', keypad_get(1000));
+	CHECK(keyNow < 150);
+	keyRun(700 - keyNow);
+	CHECK_EQUAL('1', keypad_get(KEYPAD_FOREVER));
+	CHECK_EQUAL('C', keypad_get(KEYPAD_NO_WAIT));
+	CHECK(scanKeyPad() && (returnKey() == '0'));
+	CHECK(!scanKeyPad());
+}
+
+int main(void)
+{
+	testBounce();
+	testGet();
+	return testDone("testKeyPad");
+}
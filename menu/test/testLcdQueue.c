@@ -0,0 +1,166 @@
+/*---------------------------------------------------------
+Purpose: Host test of LCD queue (driverLCD.c) after lcd_init.
+lcd_data_write and lcd_cmd_write only queue the byte and turn
+on timer 2 compare interrupt, every interrupt sends one
+nibble, high one first, with the right RS. Clear and home
+commands are followed by LCD_HOME_TICKS silent ticks, empty
+queue turns interrupt off. Random drawing flushed through
+the queue leaves display equal to shadow while queue indexes
+wrap many times.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/io.h>
+#include "driverLCD.h"
+#include "fakeLcd.h"
+#include "testCheck.h"
+
+extern char lcdShadow[LCD_CELLS];
+extern volatile unsigned char lcdBusyTicks;
+
+bool same(void)
+{
+	char cells[LCD_CELLS];
+
+	lcdEmuVisible(cells);
+	return memcmp(cells, lcdShadow, LCD_CELLS) == 0;
+}
+/* -----------------------------------------------------
+void testQueued(void)
+Byte waits in queue until interrupts send it.
+-----------------------------------------------------*/
+void testQueued(void)
+{
+	lcd_cmd_write(SET_DRAM_ADDR + line_3 + 2);
+	lcd_data_write('A');
+	CHECK_EQUAL(0, lcdEmuNibbles);
+	CHECK(TIMSK & (1<<OCIE2));
+	CHECK(lcdEmuStep());
+	CHECK_EQUAL(1, lcdEmuNibbles);
+	CHECK_EQUAL(0, lcdEmuBytes);
+	CHECK(lcdEmuStep());
+	CHECK_EQUAL(1, lcdEmuBytes);
+	CHECK(lcdEmuStep() && lcdEmuStep());
+	CHECK_EQUAL('A', lcdEmuDdram[line_3 + 2]);
+	CHECK(TIMSK & (1<<OCIE2));
+	CHECK(lcdEmuStep());								//finds queue empty
+	CHECK(!(TIMSK & (1<<OCIE2)));
+	CHECK(!lcdEmuStep());
+	lcdWaitIdle();
+}
+/* -----------------------------------------------------
+void testBusy(void)
+Nothing is sent for LCD_HOME_TICKS after clear.
+-----------------------------------------------------*/
+void testBusy(void)
+{
+	unsigned long nibbles;
+	int silent = 0;
+
+	lcd_cmd_write(CLR_DISPLAY);
+	lcd_data_write('B');
+	lcdEmuStep();
+	lcdEmuStep();
+	CHECK_EQUAL(' ', lcdEmuDdram[line_3 + 2]);
+	nibbles = lcdEmuNibbles;
+	while (lcdBusyTicks != 0)
+	{
+		lcdEmuStep();
+		silent++;
+	}
+	CHECK_EQUAL(32, silent);
+	CHECK_EQUAL(nibbles, lcdEmuNibbles);
+	CHECK_EQUAL(3, lcdEmuDrain());
+	CHECK_EQUAL('B', lcdEmuDdram[line_0]);
+}
+/* -----------------------------------------------------
+void testRandom(void)
+Small drawing operations, each flushed and drained, so the
+queue never fills. lcd_init first, bytes written above moved
+display address behind the driver's back.
+-----------------------------------------------------*/
+void testRandom(void)
+{
+	char text[10];
+	int differ = 0;
+	unsigned long ticks = 0;
+	unsigned long nibbles;
+
+	lcd_init();
+	CHECK(same());
+	nibbles = lcdEmuNibbles;
+	srand(12);
+	for (long op = 0; op < 20000; op++)
+	{
+		switch (rand() % 4)
+		{
+			case 0:
+			case 1:
+			{
+				int length = 1 + rand() % 8;
+
+				for (int i = 0; i < length; i++)
+				{
+					text[i] = (rand() % 6 == 0) ? ' ' : 'A' + rand() % 26;
+				}
+				text[length] = '\0';
+				GoTo(rand() % LCD_COLUMNS, rand() % LCD_LINES);
+				LCDPutString(text);
+				break;
+			}
+
+			case 2:
+			LCDPutChar('0' + rand() % 10);
+			break;
+
+			default:
+			clearLine(rand() % LCD_COLUMNS, rand() % LCD_LINES);
+			break;
+		}
+		lcdFlush();
+		ticks += lcdEmuDrain();
+		differ += !same();
+	}
+	lcdWaitIdle();
+	CHECK_EQUAL(0, differ);
+	CHECK(ticks >= lcdEmuNibbles - nibbles);
+}
+/* -----------------------------------------------------
+void testLine(void)
+Caller only queues a 20 char line, bus time is in ticks.
+-----------------------------------------------------*/
+void testLine(void)
+{
+	unsigned long nibbles = lcdEmuNibbles;
+	unsigned long ticks;
+
+	GoTo(0, 2);
+	LCDPutString("Charging's complete!");
+	lcdFlush();
+	CHECK_EQUAL(nibbles, lcdEmuNibbles);
+	ticks = lcdEmuDrain();
+	CHECK(same());
+	printf("testLcdQueue: 20 char line, %lu nibbles, %lu ticks of 50 us in background "
+		   "(direct transfer blocked caller %lu us)\n",
+		   lcdEmuNibbles - nibbles, ticks, (lcdEmuNibbles - nibbles) * 120);
+}
+
+int main(void)
+{
+	lcdEmuReset();
+	lcd_init();
+	CHECK(same());
+	lcdEmuNibbles = 0;
+	lcdEmuBytes = 0;
+	testQueued();
+	testBusy();
+	testRandom();
+	testLine();
+	return testDone("testLcdQueue");
+}
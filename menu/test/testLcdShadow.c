@@ -0,0 +1,183 @@
+/*---------------------------------------------------------
+Purpose: Host test of LCD shadow and lcdFlush (driverLCD.c)
+against HD44780 emulator that decodes nibbles on lcd_port.
+After lcd_init display is clear. After 20000 random drawing
+operations and flushes display shows what shadow holds.
+Flush sends nothing when nothing changed, one address
+command for a run of changed cells, resends a single clean
+cell instead of address command and uses clear command when
+new screen is mostly blank. Bytes are sent directly here
+(lcdAsync false), queue is tested in testLcdQueue.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "driverLCD.h"
+#include "fakeLcd.h"
+#include "testCheck.h"
+
+extern char lcdShadow[LCD_CELLS];
+extern bool lcdAsync;
+
+/* -----------------------------------------------------
+bool same(void)
+Display shows the shadow.
+-----------------------------------------------------*/
+bool same(void)
+{
+	char cells[LCD_CELLS];
+
+	lcdEmuVisible(cells);
+	return memcmp(cells, lcdShadow, LCD_CELLS) == 0;
+}
+/* -----------------------------------------------------
+unsigned long flushNibbles(void)
+Flushes and returns nibbles it took.
+-----------------------------------------------------*/
+unsigned long flushNibbles(void)
+{
+	unsigned long before = lcdEmuNibbles;
+
+	lcdFlush();
+	return lcdEmuNibbles - before;
+}
+
+void randomText(char *text, int max)
+{
+	int length = 1 + rand() % max;
+
+	for (int i = 0; i < length; i++)
+	{
+		int r = rand() % 16;
+
+		text[i] = (r == 0) ? ' ' : (r == 1) ? '\n' : (r == 2) ? 0x01 : 'A' + rand() % 26;
+	}
+	text[length] = '\0';
+}
+/* -----------------------------------------------------
+void testInit(void)
+lcd_init clears display and shadow.
+-----------------------------------------------------*/
+void testInit(void)
+{
+	lcdEmuReset();
+	lcd_init();
+	lcdAsync = false;
+	CHECK(same());
+	CHECK_EQUAL(0, flushNibbles());
+}
+/* -----------------------------------------------------
+void testRandom(void)
+Random GoTo, strings, chars, clear and clearLine, flushed
+after every few of them.
+-----------------------------------------------------*/
+void testRandom(void)
+{
+	char text[40];
+	int differ = 0;
+
+	srand(11);
+	for (long op = 0; op < 20000; op++)
+	{
+		switch (rand() % 8)
+		{
+			case 0:
+			case 1:
+			case 2:
+			GoTo(rand() % LCD_COLUMNS, rand() % LCD_LINES);
+			randomText(text, 30);
+			LCDPutString(text);
+			break;
+
+			case 3:
+			LCDPutChar('a' + rand() % 26);
+			break;
+
+			case 4:
+			GoTo(rand() % LCD_COLUMNS, rand() % LCD_LINES);
+			randomText(text, 8);
+			LCDPutString_P(text);
+			break;
+
+			case 5:
+			clearLine(rand() % LCD_COLUMNS, rand() % LCD_LINES);
+			break;
+
+			case 6:
+			if (rand() % 8 == 0)
+			{
+				lcdClear();
+			}
+			break;
+
+			default:
+			lcdFlush();
+			differ += !same();
+			break;
+		}
+	}
+	lcdFlush();
+	differ += !same();
+	CHECK_EQUAL(0, differ);
+}
+/* -----------------------------------------------------
+void testCosts(void)
+Nibbles flush takes for small changes.
+-----------------------------------------------------*/
+void testCosts(void)
+{
+	unsigned long full, sample, redraw;
+
+	lcdClear();
+	lcdFlush();
+	GoTo(0, 1);
+	LCDPutString("Energy: 12.345 kWh");
+	lcdFlush();
+
+	GoTo(0, 1);
+	LCDPutString("Energy: 12.345 kWh");
+	CHECK_EQUAL(0, flushNibbles());
+
+	GoTo(5, 3);
+	LCDPutChar('x');
+	CHECK_EQUAL(4, flushNibbles());							//address and char
+
+	GoTo(5, 3);
+	LCDPutString("y#z");
+	CHECK_EQUAL(8, flushNibbles());							//address, 'y', '#' again, 'z'
+	CHECK(same());
+
+	GoTo(8, 1);
+	LCDPutString("12.351");
+	sample = flushNibbles();
+	CHECK_EQUAL(6, sample);									//address, "51"
+
+	for (uint8_t y = 0; y < LCD_LINES; y++)
+	{
+		GoTo(0, y);
+		LCDPutString("ABCDEFGHIJKLMNOPQRST");
+	}
+	full = flushNibbles();
+	lcdClear();
+	GoTo(3, 0);
+	LCDPutString("Menu");
+	redraw = flushNibbles();
+	CHECK_EQUAL(2 + 2 + 8, redraw);							//clear, address, "Menu"
+	CHECK(same());
+	printf("testLcdShadow: nibbles per flush: 2 digits of a sample %lu, full screen %lu, "
+		   "full screen to one word %lu (%lu blanked cell by cell)\n",
+		   sample, full, redraw, 2 + 2 * (unsigned long)LCD_CELLS);
+}
+
+int main(void)
+{
+	testInit();
+	testRandom();
+	testCosts();
+	return testDone("testLcdShadow");
+}
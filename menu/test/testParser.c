@@ -0,0 +1,289 @@
+/*---------------------------------------------------------
+Purpose: Host test of package parser (dataReceive.c). Feeds
+packages in ASCII and binary mode through USART_RXC_vect,
+checks decoded fields, rejection of bad length and format,
+and fuzzes the stream: random noise between packages and
+random corrupted bytes. A corrupted package is never taken
+as valid, every clean package that comes after the parser
+had a chance to resync is received. Prints rejection rate
+of corrupted packages and frames per second the parser takes
+on PC, next to what the 9600 baud line brings.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <avr/io.h>
+#include "dataReceive.h"
+#include "formPacket.h"
+#include "testCheck.h"
+
+/* Same as in dataReceive.c */
+#define FRAME_MAX 100
+/* USART_Init(64) at 10 MHz, 8N1 takes 10 bits a byte */
+#define LINE_BYTES_PER_S (10000000UL / 16 / (64 + 1) / 10)
+
+extern void USART_RXC_vect(void);
+
+/* -----------------------------------------------------
+bool rxByte(char byte)
+Byte arrives to USART and main loop looks at it at once.
+Returns true if a package was completed.
+-----------------------------------------------------*/
+bool rxByte(char byte)
+{
+	UDR = byte;
+	USART_RXC_vect();
+	return receivePackage();
+}
+/* -----------------------------------------------------
+int rxBytes(const char *bytes, int n)
+Feeds n bytes, returns packages completed.
+-----------------------------------------------------*/
+int rxBytes(const char *bytes, int n)
+{
+	int completed = 0;
+
+	for (int i = 0; i < n; i++)
+	{
+		completed += rxByte(bytes[i]);
+	}
+	return completed;
+}
+/* -----------------------------------------------------
+int serverPackage(char *wire, const char *command, const char *data, int datalint)
+Package from server (01) to controller (02) as it is on
+wire, in the current mode. Returns its length.
+-----------------------------------------------------*/
+int serverPackage(char *wire, const char *command, const char *data, int datalint)
+{
+	if (binaryMode)
+	{
+		formPacketBin(1, 2, (command[0] - '0') * 10 + (command[1] - '0'), (const uint8_t *)data, datalint);
+		memcpy(wire, formedDataPackageToSend, formedPacketLength);
+		return formedPacketLength;
+	}
+	formPacket("01", "02", (char *)command, (char *)data);
+	wire[0] = '*';
+	wire[1] = '-';
+	memcpy(wire + 2, formedDataPackageToSend, formedPacketLength);
+	return formedPacketLength + 2;
+}
+/* -----------------------------------------------------
+void testAscii(void)
+Fields of ASCII package, data is terminated in place.
+-----------------------------------------------------*/
+void testAscii(void)
+{
+	char wire[FRAME_MAX + 4];
+	int n;
+
+	n = serverPackage(wire, "51", "12.50", 5);
+	CHECK_EQUAL(1, rxBytes(wire, n));
+	CHECK_EQUAL(RX_OK, _status);
+	CHECK_EQUAL(1, _source);
+	CHECK_EQUAL(2, _destination);
+	CHECK_EQUAL(51, _command);
+	CHECK_EQUAL(5, dl);
+	CHECK(strcmp(actualData, "12.50") == 0);
+
+	n = serverPackage(wire, "23", "", 0);
+	CHECK_EQUAL(1, rxBytes(wire, n));
+	CHECK_EQUAL(RX_OK, _status);
+	CHECK_EQUAL(23, _command);
+	CHECK_EQUAL(0, dl);
+}
+/* -----------------------------------------------------
+void testRejected(void)
+Wrong digit in header, too long data and broken stop chars
+are rejected with reason, wrong check sum is reported as
+completed corrupted package. Next package is fine.
+-----------------------------------------------------*/
+void testRejected(void)
+{
+	char wire[FRAME_MAX + 4];
+	uint16_t rejected = rxFramesRejected;
+	int n;
+
+	CHECK_EQUAL(0, rxBytes("*-02x1", 6));
+	CHECK_EQUAL(RX_ERR_FORMAT, _status);
+
+	CHECK_EQUAL(0, rxBytes("*-0102510099", 12));
+	CHECK_EQUAL(RX_ERR_LENGTH, _status);
+
+	n = serverPackage(wire, "51", "12.50", 5);
+	wire[n - 1] = '+';
+	CHECK_EQUAL(0, rxBytes(wire, n));
+	CHECK_EQUAL(RX_ERR_FORMAT, _status);
+
+	n = serverPackage(wire, "51", "12.50", 5);
+	wire[12] = '3';
+	CHECK_EQUAL(1, rxBytes(wire, n));
+	CHECK_EQUAL(RX_ERR_CHECKSUM, _status);
+	CHECK_EQUAL(0, _command);
+	CHECK_EQUAL(0, dl);
+	CHECK_EQUAL(4, rxFramesRejected - rejected);
+
+	n = serverPackage(wire, "52", "7", 1);
+	CHECK_EQUAL(1, rxBytes(wire, n));
+	CHECK_EQUAL(RX_OK, _status);
+	CHECK_EQUAL(52, _command);
+}
+/* -----------------------------------------------------
+void testBinary(void)
+Binary package carries zero bytes and sequence, length over
+127 takes two varint bytes and is rejected as too long.
+-----------------------------------------------------*/
+void testBinary(void)
+{
+	char wire[FRAME_MAX + 4];
+	char data[4] = {0, 0, 0x19, 0x64};
+	char longHeader[] = {'*', '-', 1, 2, 51, 7, (char)0x80, 0x01};
+	int n;
+
+	binaryMode = true;
+	n = serverPackage(wire, "51", data, 4);
+	CHECK_EQUAL(1, rxBytes(wire, n));
+	CHECK_EQUAL(RX_OK, _status);
+	CHECK_EQUAL(51, _command);
+	CHECK_EQUAL(packetSequence, _sequence);
+	CHECK_EQUAL(4, dl);
+	CHECK(memcmp(actualData, data, 4) == 0);
+
+	CHECK_EQUAL(0, rxBytes(longHeader, sizeof(longHeader)));
+	CHECK_EQUAL(RX_ERR_LENGTH, _status);
+
+	n = serverPackage(wire, "51", data, 4);
+	wire[8] ^= 0x01;
+	CHECK_EQUAL(1, rxBytes(wire, n));
+	CHECK_EQUAL(RX_ERR_CHECKSUM, _status);
+	binaryMode = false;
+}
+/* -----------------------------------------------------
+void testFuzz(bool binary, int packages)
+Random packages with noise between them (no '*', it would
+open a package that takes the next one as data) and a
+random byte corrupted in every fourth. Parser must not
+accept a corrupted package and must receive every clean
+package that starts FRAME_MAX bytes after the last damage.
+-----------------------------------------------------*/
+void testFuzz(bool binary, int packages)
+{
+	char wire[FRAME_MAX + 4];
+	char data[FRAME_MAX];
+	char command[4];
+	int sinceDamage = FRAME_MAX;
+	uint16_t rejected = rxFramesRejected;
+	int corrupted = 0;
+	int expected = 0;
+	int received = 0;
+	int falseAccepts = 0;
+	int missed = 0;
+
+	binaryMode = binary;
+	srand(binary ? 2 : 1);
+	for (int p = 0; p < packages; p++)
+	{
+		int noise = rand() % 8;
+		int datalint = rand() % 40;
+		bool corrupt = (rand() % 4 == 0);
+		bool synced;
+		bool got = false;
+		int n;
+
+		for (int i = 0; i < noise; i++)
+		{
+			char byte = rand() % 256;
+
+			rxByte((byte == '*') ? '.' : byte);
+		}
+		sinceDamage += noise;
+		for (int i = 0; i < datalint; i++)
+		{
+			data[i] = binary ? (rand() % 256) : ('0' + rand() % 10);
+		}
+		data[datalint] = '\0';
+		sprintf(command, "%02d", 10 + rand() % 80);
+		n = serverPackage(wire, command, data, datalint);
+		if (corrupt)
+		{
+			int at = 2 + rand() % (n - 4);
+			char byte;
+
+			do
+			{
+				byte = rand() % 256;
+			} while ((byte == wire[at]) || (byte == '*'));
+			wire[at] = byte;
+		}
+		corrupted += corrupt;
+		synced = (sinceDamage >= FRAME_MAX);
+		expected += (synced && !corrupt);
+		for (int i = 0; i < n; i++)
+		{
+			if (rxByte(wire[i]) && (_status == RX_OK))
+			{
+				bool same = !corrupt && (i == n - 1) && (dl == datalint) &&
+							(_command == atoi(command)) && (memcmp(actualData, data, datalint) == 0);
+
+				falseAccepts += !same;
+				got |= same;
+			}
+		}
+		received += got;
+		missed += (synced && !corrupt && !got);
+		sinceDamage = corrupt ? 0 : sinceDamage + n;
+	}
+	rejected = rxFramesRejected - rejected;
+	CHECK_EQUAL(0, falseAccepts);
+	CHECK_EQUAL(0, missed);
+	printf("testParser: %s fuzz, %d packages, %d clean after resync, %d received, "
+		   "%d corrupted, %u rejected (%d%%), 0 accepted\n",
+		   binary ? "binary" : "ASCII", packages, expected, received,
+		   corrupted, rejected, 100 * rejected / corrupted);
+	binaryMode = false;
+}
+/* -----------------------------------------------------
+void testThroughput(bool binary, int frames)
+Package with 20 data bytes fed frames times, byte by byte
+through interrupt and receivePackage. Every one is received.
+-----------------------------------------------------*/
+void testThroughput(bool binary, int frames)
+{
+	char wire[FRAME_MAX + 4];
+	int received = 0;
+	clock_t start;
+	double seconds;
+	int n;
+
+	binaryMode = binary;
+	n = serverPackage(wire, "51", "12345678901234567890", 20);
+	start = clock();
+	for (int f = 0; f < frames; f++)
+	{
+		received += rxBytes(wire, n);
+	}
+	seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+	CHECK_EQUAL(frames, received);
+	CHECK_EQUAL(RX_OK, _status);
+	printf("testParser: %s, %d byte package, %.0f frames/s on PC, line brings %lu frames/s\n",
+		   binary ? "binary" : "ASCII", n, frames / (seconds > 0 ? seconds : 1e-9), LINE_BYTES_PER_S / n);
+	binaryMode = false;
+}
+
+int main(void)
+{
+	testAscii();
+	testRejected();
+	testBinary();
+	testFuzz(false, 20000);
+	testFuzz(true, 20000);
+	testThroughput(false, 200000);
+	testThroughput(true, 200000);
+	return testDone("testParser");
+}
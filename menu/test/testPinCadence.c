@@ -0,0 +1,103 @@
+/*---------------------------------------------------------
+Purpose: Host test of PIN typing through keypad FIFO
+(driverKeyPad.c). 1000 four digit PINs are typed at a given
+interval between presses, every key held half of it with up
+to 2 ms of contact bounce, while the reader takes keys out of
+FIFO only every 50 ms, as PIN entry between LCD updates does.
+Digits typed ahead wait in FIFO. Lost digits are counted for
+intervals from 20 ms up, none is lost at any of them.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "driverKeyPad.h"
+#include "fakeKeyPad.h"
+#include "testCheck.h"
+
+#define PINS 1000
+#define PIN_LENGTH 4
+
+keyPress presses[PINS * PIN_LENGTH];
+
+/* -----------------------------------------------------
+int typePins(uint8_t intervalMs)
+Returns number of PINs that lost or changed a digit.
+-----------------------------------------------------*/
+int typePins(uint8_t intervalMs)
+{
+	uint32_t at = 100;
+	int bad = 0;
+
+	srand(21);
+	for (int i = 0; i < PINS * PIN_LENGTH; i++)
+	{
+		uint8_t hold = intervalMs / 2;
+
+		presses[i].key = '0' + rand() % 10;
+		presses[i].pressMs = at;
+		presses[i].pressBounceMs = rand() % 3;
+		presses[i].releaseMs = at + hold;
+		presses[i].releaseBounceMs = rand() % 3;
+		at += intervalMs;
+		if (i % PIN_LENGTH == PIN_LENGTH - 1)
+		{
+			at += 1000;										//next customer
+		}
+	}
+	keyNow = 0;
+	keypad_init();
+	keyScript(presses, PINS * PIN_LENGTH);
+	for (int pin = 0; pin < PINS; pin++)
+	{
+		const keyPress *first = &presses[pin * PIN_LENGTH];
+		char typed[PIN_LENGTH];
+		int n = 0;
+		char key;
+
+		keyRun(first->pressMs - keyNow);
+		while (keyNow < first->pressMs + PIN_LENGTH * intervalMs + 500)
+		{
+			keyRun(50);
+			while ((key = keypad_get(KEYPAD_NO_WAIT)) != KEYPAD_NO_KEY)
+			{
+				if (n < PIN_LENGTH)
+				{
+					typed[n] = key;
+				}
+				n++;
+			}
+		}
+		if (n != PIN_LENGTH)
+		{
+			bad++;
+			continue;
+		}
+		for (int d = 0; d < PIN_LENGTH; d++)
+		{
+			if (typed[d] != first[d].key)
+			{
+				bad++;
+				break;
+			}
+		}
+	}
+	return bad;
+}
+
+int main(void)
+{
+	const uint8_t intervals[] = {20, 30, 40, 50, 60, 80, 120};
+
+	for (uint8_t i = 0; i < sizeof(intervals); i++)
+	{
+		int bad = typePins(intervals[i]);
+
+		CHECK_EQUAL(0, bad);
+		printf("testPinCadence: key every %u ms, %d of %d PINs lost digits\n", intervals[i], bad, PINS);
+	}
+	return testDone("testPinCadence");
+}
@@ -0,0 +1,166 @@
+/*---------------------------------------------------------
+Purpose: Host test of request pipelining (serverRequest.c)
+against fake server. Several requests wait at once and
+replies that come in other order reach the right request:
+by command in ASCII mode, by sequence number in binary
+mode. Table of pending requests has MAX_PENDING places,
+replies nobody waits for are counted and dropped. Requests
+sent together finish in the time of the slowest one.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "formPacket.h"
+#include "requestFrames.h"
+#include "serverRequest.h"
+#include "fakeServer.h"
+#include "testCheck.h"
+
+/* -----------------------------------------------------
+void testOutOfOrderAscii(void)
+Three requests, replies come last first.
+-----------------------------------------------------*/
+void testOutOfOrderAscii(void)
+{
+	const serverStepScript script[] = {{SERVER_REPLY, 60}, {SERVER_REPLY, 10}, {SERVER_REPLY, 30}};
+	int8_t price, balance, energy;
+
+	serverReset();
+	serverScript(script, 3);
+	price = requestSend(FRAME_CURRENT_PRICE, 51, 500, 0, REQUEST_REPEATABLE);
+	balance = requestSend(FRAME_BALANCE, 67, 500, 0, REQUEST_REPEATABLE);
+	energy = requestSendData("86", "102.20", 87, 500, 0, REQUEST_REPEATABLE);
+	CHECK((price >= 0) && (balance >= 0) && (energy >= 0));
+
+	CHECK_EQUAL(REQUEST_OK, requestWait(price));
+	CHECK_EQUAL(REQUEST_OK, requestStatus(balance));
+	CHECK_EQUAL(REQUEST_OK, requestStatus(energy));
+	CHECK(strncmp(requestReplyData(price), "R50Send", 7) == 0);
+	CHECK(strncmp(requestReplyData(balance), "R66Send", 7) == 0);
+	CHECK(strcmp(requestReplyData(energy), "R86102.20") == 0);
+	CHECK_EQUAL(87, requestReplyCommand(energy));
+	CHECK_EQUAL(3, serverRequests);
+	requestRelease(price);
+	requestRelease(balance);
+	requestRelease(energy);
+}
+/* -----------------------------------------------------
+void testOutOfOrderBinary(void)
+Two requests with the same command, replies reversed, only
+sequence number tells them apart.
+-----------------------------------------------------*/
+void testOutOfOrderBinary(void)
+{
+	const serverStepScript script[] = {{SERVER_REPLY, 50}, {SERVER_REPLY, 5}};
+	int8_t first, second;
+
+	serverReset();
+	binaryMode = true;
+	serverScript(script, 2);
+	first = requestSendData("66", "first", 67, 500, 0, REQUEST_REPEATABLE);
+	second = requestSendData("66", "second", 67, 500, 0, REQUEST_REPEATABLE);
+	CHECK_EQUAL(REQUEST_OK, requestWait(second));
+	CHECK_EQUAL(REQUEST_PENDING, requestStatus(first));
+	CHECK_EQUAL(REQUEST_OK, requestWait(first));
+	CHECK(strcmp(requestReplyData(first), "R66first") == 0);
+	CHECK(strcmp(requestReplyData(second), "R66second") == 0);
+	requestRelease(first);
+	requestRelease(second);
+	binaryMode = false;
+}
+/* -----------------------------------------------------
+void testTableFull(void)
+MAX_PENDING requests fit, the next gets -1 until one is
+released.
+-----------------------------------------------------*/
+void testTableFull(void)
+{
+	int8_t handles[MAX_PENDING];
+	int8_t extra;
+
+	serverReset();
+	for (int i = 0; i < MAX_PENDING; i++)
+	{
+		handles[i] = requestSend(FRAME_BALANCE, 67, 500, 0, REQUEST_REPEATABLE);
+		CHECK(handles[i] >= 0);
+	}
+	CHECK_EQUAL(-1, requestSend(FRAME_BALANCE, 67, 500, 0, REQUEST_REPEATABLE));
+	CHECK_EQUAL(REQUEST_TIMEOUT, requestStatus(-1));
+	requestRelease(handles[1]);
+	extra = requestSend(FRAME_BALANCE, 67, 500, 0, REQUEST_REPEATABLE);
+	CHECK_EQUAL(handles[1], extra);
+	for (int i = 0; i < MAX_PENDING; i++)
+	{
+		CHECK_EQUAL(REQUEST_OK, requestWait(handles[i]));
+		requestRelease(handles[i]);
+	}
+}
+/* -----------------------------------------------------
+void testUnmatched(void)
+Package that no request waits for is counted.
+-----------------------------------------------------*/
+void testUnmatched(void)
+{
+	uint16_t unmatched = unmatchedReplies;
+	int8_t price;
+
+	serverReset();
+	serverReply(99, 0, "late", false, 0);
+	price = requestSend(FRAME_CURRENT_PRICE, 51, 500, 0, REQUEST_REPEATABLE);
+	CHECK_EQUAL(REQUEST_OK, requestWait(price));
+	CHECK_EQUAL(1, unmatchedReplies - unmatched);
+	requestRelease(price);
+}
+/* -----------------------------------------------------
+void testLatency(void)
+Four requests in a row, every reply 40 ms after request:
+pipelined they take about one round trip, one by one four.
+-----------------------------------------------------*/
+void testLatency(void)
+{
+	const uint8_t frames[] = {FRAME_CURRENT_PRICE, FRAME_LAST_CONSUMED_ENERGY, FRAME_LAST_TOTAL, FRAME_BALANCE};
+	int8_t handles[4];
+	uint16_t start;
+	uint16_t pipelined;
+	uint16_t sequential;
+
+	serverReset();
+	serverDelayMs = 40;
+	start = serverNow;
+	for (int i = 0; i < 4; i++)
+	{
+		handles[i] = requestSend(frames[i], requestFrameCommand(frames[i]) + 1, 500, 0, REQUEST_REPEATABLE);
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		CHECK_EQUAL(REQUEST_OK, requestWait(handles[i]));
+		requestRelease(handles[i]);
+	}
+	pipelined = serverNow - start;
+
+	start = serverNow;
+	for (int i = 0; i < 4; i++)
+	{
+		handles[i] = requestSend(frames[i], requestFrameCommand(frames[i]) + 1, 500, 0, REQUEST_REPEATABLE);
+		CHECK_EQUAL(REQUEST_OK, requestWait(handles[i]));
+		requestRelease(handles[i]);
+	}
+	sequential = serverNow - start;
+	CHECK(2 * pipelined < sequential);
+	printf("testPipeline: 4 requests with 40 ms server delay, pipelined %u ms, one by one %u ms\n",
+		   pipelined, sequential);
+}
+
+int main(void)
+{
+	testOutOfOrderAscii();
+	testOutOfOrderBinary();
+	testTableFull();
+	testUnmatched();
+	testLatency();
+	return testDone("testPipeline");
+}
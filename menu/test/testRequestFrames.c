@@ -0,0 +1,146 @@
+/*---------------------------------------------------------
+Purpose: Host test of request packages kept in flash
+(requestFrames.c). Every package is checked in with its
+header and check sum written by hand, it has to be byte for
+byte the one formPacket forms from the same command and
+data, and sendRequestFrame streams it as it is. In binary
+mode request is formed with sequence number and no data.
+Prints what ready made packages save against header and
+check sum made at run time.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "formPacket.h"
+#include "requestFrames.h"
+#include "testCheck.h"
+
+extern PGM_P const requestFrames[FRAME_COUNT];
+extern void USART_UDRE_vect(void);
+
+char wire[128];
+int wireLength;
+
+/* -----------------------------------------------------
+void collect(void)
+Takes bytes queued to USART into wire.
+-----------------------------------------------------*/
+void collect(void)
+{
+	wireLength = 0;
+	while (UCSRB & (1<<UDRIE))
+	{
+		USART_UDRE_vect();
+		if (UCSRB & (1<<UDRIE))
+		{
+			wire[wireLength++] = UDR;
+		}
+	}
+}
+/* -----------------------------------------------------
+void testAscii(void)
+Package in flash equals the one formed from its command and
+data, streamed package equals package in flash.
+-----------------------------------------------------*/
+void testAscii(void)
+{
+	int crcBytes = 0;
+	int streamed = 0;
+
+	binaryMode = false;
+	for (uint8_t frame = 0; frame < FRAME_COUNT; frame++)
+	{
+		const char *p = requestFrames[frame];
+		char command[3] = {p[4], p[5], '\0'};
+		char data[100];
+		int length = 0;
+
+		for (uint8_t i = 6; i < 10; i++)
+		{
+			length = length * 10 + (p[i] - '0');
+		}
+		CHECK(length < (int)sizeof(data));
+		memcpy(data, p + 10, length);
+		data[length] = '\0';
+		formPacket("02", "01", command, data);
+		CHECK_EQUAL(formedPacketLength, strlen(p));
+		CHECK(memcmp(p, formedDataPackageToSend, formedPacketLength) == 0);
+		sendRequestFrame(frame);
+		collect();
+		CHECK_EQUAL(formedPacketLength, wireLength);
+		CHECK(memcmp(wire, p, wireLength) == 0);
+		CHECK_EQUAL((p[4] - '0') * 10 + (p[5] - '0'), requestFrameCommand(frame));
+		crcBytes += 10 + length;
+		streamed += wireLength;
+	}
+	/* before: frameCrc[] 2 bytes per package, header[10] and hex[4]
+	on stack of sendRequestFrame, CRC of header and data at start up,
+	4 divisions by 10 and crc16ToHex on every send */
+	printf("ready made packages: %d bytes streamed from flash, saved %d SRAM + 14 stack bytes, %d CRC updates at start up, strlen_P, 4 divisions by 10 and crc16ToHex per send\n",
+		   streamed, 2 * FRAME_COUNT, crcBytes);
+}
+/* -----------------------------------------------------
+void testKnownPackages(void)
+Packages with check sums as they were written by hand in
+flash before (StartSession has NAK offer since).
+-----------------------------------------------------*/
+void testKnownPackages(void)
+{
+	const char *known[] = {
+		"0201500016SendCurrentPriceB20F-*",
+		NULL,
+		"0201990012EndofSessionA5C6-*",
+		"0201610022SendLastConsumedEnergyD0C4-*",
+		"0201630013SendLastTotal140C-*",
+		"0201660011SendBalance9D78-*"
+	};
+
+	binaryMode = false;
+	for (uint8_t frame = 0; frame < FRAME_COUNT; frame++)
+	{
+		sendRequestFrame(frame);
+		collect();
+		wire[wireLength] = '\0';
+		if (known[frame] != NULL)
+		{
+			CHECK(strcmp(wire, known[frame]) == 0);
+		}else{
+			CHECK(strncmp(wire, "0201220021StartSession;BIN2;NAK", 31) == 0);
+			CHECK(strcmp(wire + wireLength - 2, "-*") == 0);
+		}
+	}
+}
+/* -----------------------------------------------------
+void testBinary(void)
+Binary request has command, new sequence and no data.
+-----------------------------------------------------*/
+void testBinary(void)
+{
+	binaryMode = true;
+	for (uint8_t frame = 0; frame < FRAME_COUNT; frame++)
+	{
+		uint8_t sequence = packetSequence;
+
+		sendRequestFrame(frame);
+		collect();
+		CHECK_EQUAL(11, wireLength);
+		CHECK_EQUAL(requestFrameCommand(frame), (uint8_t)wire[4]);
+		CHECK_EQUAL((uint8_t)(sequence + 1), (uint8_t)wire[5]);
+		CHECK_EQUAL(0, wire[6]);
+	}
+	binaryMode = false;
+}
+
+int main(void)
+{
+	testAscii();
+	testKnownPackages();
+	testBinary();
+	return testDone("testRequestFrames");
+}
@@ -0,0 +1,309 @@
+/*---------------------------------------------------------
+Purpose: Host test of request timeouts, repeats and NAK
+(serverRequest.c) against fake server that drops, delays,
+duplicates and corrupts replies. Repeatable request is sent
+again on its own deadline with doubled timeout, request
+sent once (PIN, card login) never is, its late reply is
+still taken. Corrupted package does not resend anything, it
+is NAKed by requestPoll (08 "NAKn" in NAK mode, 09
+RepeatLastPacket for old server) and server repeats the
+reply, the one who waits does nothing. Deadlines keep
+running meanwhile. Prints the worst time corrupted reply
+adds before the request is answered. In ASCII mode a
+duplicated reply and a late reply to a repeat are dropped,
+also when they come while the next request with the same
+command waits.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "formPacket.h"
+#include "dataReceive.h"
+#include "requestFrames.h"
+#include "serverRequest.h"
+#include "fakeServer.h"
+#include "testCheck.h"
+
+/* -----------------------------------------------------
+void testDroppedRepeatable(void)
+Two replies dropped, third request is answered. Waits are
+100 and 200 ms before the repeats.
+-----------------------------------------------------*/
+void testDroppedRepeatable(void)
+{
+	const serverStepScript script[] = {{SERVER_DROP, 0}, {SERVER_DROP, 0}, {SERVER_REPLY, 20}};
+	uint16_t start;
+	int8_t h;
+
+	serverReset();
+	serverScript(script, 3);
+	start = serverNow;
+	h = requestSend(FRAME_BALANCE, 67, 100, 2, REQUEST_REPEATABLE);
+	CHECK_EQUAL(REQUEST_OK, requestWait(h));
+	CHECK_EQUAL(3, serverCount(66));
+	CHECK((uint16_t)(serverNow - start) >= 300);
+	requestRelease(h);
+}
+/* -----------------------------------------------------
+void testDroppedForever(void)
+Every reply dropped: timeout after 100 + 200 + 400 ms.
+-----------------------------------------------------*/
+void testDroppedForever(void)
+{
+	const serverStepScript script[] = {{SERVER_DROP, 0}, {SERVER_DROP, 0}, {SERVER_DROP, 0}};
+	uint16_t start;
+	uint16_t took;
+	int8_t h;
+
+	serverReset();
+	serverScript(script, 3);
+	start = serverNow;
+	h = requestSend(FRAME_BALANCE, 67, 100, 2, REQUEST_REPEATABLE);
+	CHECK_EQUAL(REQUEST_TIMEOUT, requestWait(h));
+	took = serverNow - start;
+	CHECK_EQUAL(3, serverCount(66));
+	CHECK((took >= 700) && (took < 720));
+	requestRelease(h);
+}
+/* -----------------------------------------------------
+void testOnceLate(void)
+Request sent once is not repeated, its reply that comes
+after the first timeout is taken.
+-----------------------------------------------------*/
+void testOnceLate(void)
+{
+	const serverStepScript script[] = {{SERVER_REPLY, 150}};
+	int8_t h;
+
+	serverReset();
+	serverScript(script, 1);
+	h = requestSendData("00", "1234", 1, 100, 1, REQUEST_ONCE);
+	CHECK_EQUAL(REQUEST_OK, requestWait(h));
+	CHECK_EQUAL(1, serverCount(0));
+	CHECK(strcmp(requestReplyData(h), "R001234") == 0);
+	requestRelease(h);
+
+	serverReset();
+	serverScript(script, 1);
+	h = requestSendData("10", "04A1B2C3D4E5F6", 11, 100, 0, REQUEST_ONCE);
+	CHECK_EQUAL(REQUEST_TIMEOUT, requestWait(h));
+	CHECK_EQUAL(1, serverCount(10));
+	requestRelease(h);
+	serverAdvance(100);
+}
+/* -----------------------------------------------------
+void testCorrupted(bool nak)
+Corrupted reply to request without repeats: requestWait
+alone gets the reply, it is NAKed once and nothing is
+resent.
+-----------------------------------------------------*/
+void testCorrupted(bool nak)
+{
+	const serverStepScript script[] = {{SERVER_CORRUPT, 20}};
+	int8_t h;
+
+	serverReset();
+	nakMode = nak;
+	serverScript(script, 1);
+	h = requestSendData("00", "1234", 1, 100, 0, REQUEST_ONCE);
+	CHECK_EQUAL(REQUEST_OK, requestWait(h));
+	CHECK(strcmp(requestReplyData(h), "R001234") == 0);
+	CHECK_EQUAL(1, serverNaks);
+	CHECK_EQUAL(1, serverCount(0));
+	if (nak)
+	{
+		CHECK_EQUAL(8, serverLastCommand);
+		CHECK(strcmp(serverLastData, "NAK3") == 0);
+	}else{
+		CHECK_EQUAL(9, serverLastCommand);
+		CHECK(strcmp(serverLastData, "RepeatLastPacket") == 0);
+	}
+	requestRelease(h);
+	nakMode = false;
+}
+/* -----------------------------------------------------
+void testCorruptedOther(void)
+Corrupted reply to one request does not resend the other,
+both finish.
+-----------------------------------------------------*/
+void testCorruptedOther(void)
+{
+	const serverStepScript script[] = {{SERVER_CORRUPT, 10}, {SERVER_REPLY, 200}};
+	int8_t first, second;
+
+	serverReset();
+	nakMode = true;
+	serverScript(script, 2);
+	first = requestSend(FRAME_CURRENT_PRICE, 51, 300, 2, REQUEST_REPEATABLE);
+	second = requestSend(FRAME_BALANCE, 67, 300, 2, REQUEST_REPEATABLE);
+	CHECK_EQUAL(REQUEST_OK, requestWait(first));
+	CHECK_EQUAL(REQUEST_OK, requestWait(second));
+	CHECK_EQUAL(1, serverCount(50));
+	CHECK_EQUAL(1, serverCount(66));
+	CHECK_EQUAL(1, serverNaks);
+	requestRelease(first);
+	requestRelease(second);
+	nakMode = false;
+}
+/* -----------------------------------------------------
+uint16_t answerTime(uint8_t action, uint16_t delayMs, bool repeatable)
+Ms from request to reply when server does action after
+delayMs, nobody but requestWait looks at it.
+-----------------------------------------------------*/
+uint16_t answerTime(uint8_t action, uint16_t delayMs, bool repeatable)
+{
+	const serverStepScript script[] = {{action, delayMs}};
+	uint16_t start;
+	int8_t h;
+
+	serverReset();
+	serverScript(script, 1);
+	start = serverNow;
+	h = requestSendData("66", "x", 67, 100, 2, repeatable);
+	CHECK_EQUAL(REQUEST_OK, requestWait(h));
+	requestRelease(h);
+	serverAdvance(500);
+	requestPoll();
+	return serverNow - 500 - start;
+}
+/* -----------------------------------------------------
+void testCorruptedLatency(void)
+Corrupted reply at any time before and after the first
+deadline: the request never times out and is answered at
+most one NAK round later than a clean reply would be.
+-----------------------------------------------------*/
+void testCorruptedLatency(void)
+{
+	uint16_t worst = 0;
+	uint16_t worstOnce = 0;
+	int late = 0;
+
+	for (uint16_t delay = 0; delay <= 150; delay += 5)
+	{
+		uint16_t clean = answerTime(SERVER_REPLY, delay, REQUEST_REPEATABLE);
+		uint16_t extra = answerTime(SERVER_CORRUPT, delay, REQUEST_REPEATABLE) - clean;
+		uint16_t extraOnce = answerTime(SERVER_CORRUPT, delay, REQUEST_ONCE) -
+							 answerTime(SERVER_REPLY, delay, REQUEST_ONCE);
+
+		worst = (extra > worst) ? extra : worst;
+		worstOnce = (extraOnce > worstOnce) ? extraOnce : worstOnce;
+		late += (extra > serverDelayMs + 20) || (extraOnce > serverDelayMs + 20);
+	}
+	CHECK_EQUAL(0, late);
+	printf("corrupted reply, no NAK by caller: worst recovery +%u ms (repeatable), +%u ms (sent once)\n",
+		   worst, worstOnce);
+}
+/* -----------------------------------------------------
+void testOwnDeadline(void)
+Only the request whose time is up is sent again.
+-----------------------------------------------------*/
+void testOwnDeadline(void)
+{
+	const serverStepScript script[] = {{SERVER_DROP, 0}, {SERVER_REPLY, 400}, {SERVER_REPLY, 10}};
+	int8_t quick, slow;
+
+	serverReset();
+	serverScript(script, 3);
+	quick = requestSend(FRAME_CURRENT_PRICE, 51, 100, 1, REQUEST_REPEATABLE);
+	serverAdvance(50);
+	slow = requestSend(FRAME_BALANCE, 67, 1000, 1, REQUEST_REPEATABLE);
+	CHECK_EQUAL(REQUEST_OK, requestWait(quick));
+	CHECK_EQUAL(REQUEST_PENDING, requestStatus(slow));
+	CHECK_EQUAL(2, serverCount(50));
+	CHECK_EQUAL(1, serverCount(66));
+	CHECK_EQUAL(REQUEST_OK, requestWait(slow));
+	CHECK_EQUAL(1, serverCount(66));
+	requestRelease(quick);
+	requestRelease(slow);
+}
+/* -----------------------------------------------------
+void testDuplicate(void)
+Second copy of a reply is counted as unmatched and does
+not answer the next request.
+-----------------------------------------------------*/
+void testDuplicate(void)
+{
+	const serverStepScript script[] = {{SERVER_DUPLICATE, 10}, {SERVER_REPLY, 50}};
+	uint16_t unmatched = unmatchedReplies;
+	int8_t h;
+
+	serverReset();
+	serverScript(script, 2);
+	h = requestSendData("66", "one", 67, 200, 0, REQUEST_REPEATABLE);
+	CHECK_EQUAL(REQUEST_OK, requestWait(h));
+	requestRelease(h);
+	serverAdvance(30);
+	requestPoll();
+	CHECK_EQUAL(1, unmatchedReplies - unmatched);
+	h = requestSendData("66", "two", 67, 200, 0, REQUEST_REPEATABLE);
+	CHECK_EQUAL(REQUEST_OK, requestWait(h));
+	CHECK(strcmp(requestReplyData(h), "R66two") == 0);
+	requestRelease(h);
+}
+/* -----------------------------------------------------
+void testDuplicatePending(void)
+Next request with the same command is sent as soon as the
+first reply is taken, the second copy comes while it waits.
+-----------------------------------------------------*/
+void testDuplicatePending(void)
+{
+	const serverStepScript script[] = {{SERVER_DUPLICATE, 10}, {SERVER_REPLY, 50}};
+	uint16_t unmatched = unmatchedReplies;
+	int8_t h;
+
+	serverReset();
+	serverScript(script, 2);
+	h = requestSendData("66", "one", 67, 200, 0, REQUEST_REPEATABLE);
+	CHECK_EQUAL(REQUEST_OK, requestWait(h));
+	requestRelease(h);
+	h = requestSendData("66", "two", 67, 200, 0, REQUEST_REPEATABLE);
+	CHECK_EQUAL(REQUEST_OK, requestWait(h));
+	CHECK(strcmp(requestReplyData(h), "R66two") == 0);
+	CHECK_EQUAL(1, unmatchedReplies - unmatched);
+	requestRelease(h);
+}
+/* -----------------------------------------------------
+void testLateRepeatPending(void)
+Reply to the first package comes after the repeat was sent,
+reply to the repeat comes while the next request with the
+same command waits: it is owed to the released request.
+-----------------------------------------------------*/
+void testLateRepeatPending(void)
+{
+	const serverStepScript script[] = {{SERVER_REPLY, 150}, {SERVER_REPLY, 150}, {SERVER_REPLY, 100}};
+	uint16_t unmatched = unmatchedReplies;
+	int8_t h;
+
+	serverReset();
+	serverScript(script, 3);
+	h = requestSendData("66", "one", 67, 100, 1, REQUEST_REPEATABLE);
+	CHECK_EQUAL(REQUEST_OK, requestWait(h));
+	CHECK_EQUAL(2, serverCount(66));
+	requestRelease(h);
+	h = requestSendData("66", "two", 67, 300, 0, REQUEST_REPEATABLE);
+	CHECK_EQUAL(REQUEST_OK, requestWait(h));
+	CHECK(strcmp(requestReplyData(h), "R66two") == 0);
+	CHECK_EQUAL(1, unmatchedReplies - unmatched);
+	CHECK_EQUAL(3, serverCount(66));
+	requestRelease(h);
+}
+
+int main(void)
+{
+	testDroppedRepeatable();
+	testDroppedForever();
+	testOnceLate();
+	testCorrupted(true);
+	testCorrupted(false);
+	testCorruptedOther();
+	testCorruptedLatency();
+	testOwnDeadline();
+	testDuplicate();
+	testDuplicatePending();
+	testLateRepeatPending();
+	return testDone("testRequestTimeout");
+}
@@ -0,0 +1,196 @@
+/*---------------------------------------------------------
+Purpose: Host test of RFID event queue (driverRFID.c). Edges
+of INT0 (card put, removed) and INT1 (data ready, start
+transmit) recorded from a card read are played to RFIDinit
+through fake reader, every action of the transition table is
+counted: each edge runs its action once, not again and again
+while the state stays. Edges that come between reads, more
+than the queue holds, do not leave a stale event, the next
+read starts from the latest one.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "driverRFID.h"
+#include "fakeReader.h"
+#include "testCheck.h"
+
+/* Transition table cell as driverRFID.c has it */
+typedef struct {
+	int nextstateRFID;
+	void (*actionToDoRFID)();
+} stateElementRFID;
+
+extern stateElementRFID stateMatrixRFID[6][4];
+extern void nilAction();
+extern void sendCommand();
+extern void readBuffer();
+extern void transmitString();
+
+int nils = 0;
+int sends = 0;
+int reads = 0;
+int transmits = 0;
+
+void countNil() { nils++; nilAction(); }
+void countSend() { sends++; sendCommand(); }
+void countRead() { reads++; readBuffer(); }
+void countTransmit() { transmits++; transmitString(); }
+
+/* -----------------------------------------------------
+void countActions(void)
+Puts counting actions to the transition table in place of
+the driver ones.
+-----------------------------------------------------*/
+void countActions(void)
+{
+	for (uint8_t s = 0; s < 6; s++)
+	{
+		for (uint8_t e = 0; e < 4; e++)
+		{
+			void (**a)() = &stateMatrixRFID[s][e].actionToDoRFID;
+
+			if (*a == nilAction)
+			{
+				*a = countNil;
+			}
+			else if (*a == sendCommand)
+			{
+				*a = countSend;
+			}
+			else if (*a == readBuffer)
+			{
+				*a = countRead;
+			}
+			else if (*a == transmitString)
+			{
+				*a = countTransmit;
+			}
+		}
+	}
+}
+
+void startCount(void)
+{
+	nils = 0;
+	sends = 0;
+	reads = 0;
+	transmits = 0;
+}
+/* -----------------------------------------------------
+void offlineRead(const readerEdge *edges, int n, bool remove)
+Plays edges to offline first read of a card with PIN and
+binary record, then removes card if told to.
+-----------------------------------------------------*/
+void offlineRead(const readerEdge *edges, int n, bool remove)
+{
+	static readerEdge removal = {0, READER_INT0};
+	cardRecord record = {"", 1, 500, 0, 0};
+
+	memcpy(readerCard[1], "4321", 4);
+	cardDataEncode(&record, readerCard[CARD_DATA_BLOCK]);
+	readerScript(edges, n);
+	readerCommands = 0;
+	offlineFirstRead = true;
+	rfidDone = false;
+	RFIDinit(1, "64.76", 5);
+	CHECK(strcmp(RfidBufferToRead, "07060504030201") == 0);
+	CHECK(strcmp(cardInfo.pin, "4321") == 0);
+	CHECK_EQUAL(500, cardInfo.debt);
+	if (!remove)
+	{
+		return;
+	}
+	removal.ms = readerNowUs / 1000 + 10;
+	readerScript(&removal, 1);
+	readerRun(20);
+}
+/* -----------------------------------------------------
+void testRecordedRead(void)
+Tap, data ready and start transmit for id, the same for
+blocks: two of each action and one nilAction, for the
+event RFIDinit starts from. nilEvent posted at the end is
+left for the next RFIDinit, loop is over by then.
+-----------------------------------------------------*/
+void testRecordedRead(void)
+{
+	const readerEdge edges[] = {
+		{10, READER_INT0},
+		{40, READER_INT1}, {70, READER_INT1},
+		{115, READER_INT1}, {400, READER_INT1}
+	};
+
+	readerReset();
+	readerAuto = false;
+	startCount();
+	offlineRead(edges, 5, true);
+	CHECK_EQUAL(2, readerCommands);
+	CHECK_EQUAL(2, sends);
+	CHECK_EQUAL(2, reads);
+	CHECK_EQUAL(2, transmits);
+	CHECK_EQUAL(1, nils);
+}
+/* -----------------------------------------------------
+void testRetap(void)
+Card taken away before the id came and put again: id
+command is sent again, the rest once.
+-----------------------------------------------------*/
+void testRetap(void)
+{
+	const readerEdge edges[] = {
+		{10, READER_INT0}, {12, READER_INT0}, {20, READER_INT0},
+		{50, READER_INT1}, {75, READER_INT1},
+		{120, READER_INT1}, {400, READER_INT1}
+	};
+
+	readerReset();
+	readerAuto = false;
+	startCount();
+	offlineRead(edges, 7, true);
+	CHECK_EQUAL(3, readerCommands);
+	CHECK_EQUAL(3, sends);
+	CHECK_EQUAL(2, reads);
+	CHECK_EQUAL(2, transmits);
+	CHECK_EQUAL(2, nils);
+}
+/* -----------------------------------------------------
+void testEdgesBetweenReads(void)
+20 INT0 edges while nobody reads, card is present before
+and after them: next read starts at once and needs 2 commands.
+-----------------------------------------------------*/
+void testEdgesBetweenReads(void)
+{
+	const readerEdge tap = {10, READER_INT0};
+	readerEdge edges[20];
+	uint32_t start;
+
+	readerReset();
+	offlineRead(&tap, 1, false);
+	for (uint8_t i = 0; i < 20; i++)
+	{
+		edges[i].ms = readerNowUs / 1000 + 10 + i;
+		edges[i].line = READER_INT0;
+	}
+	readerScript(edges, 20);
+	readerRun(40);
+	startCount();
+	start = readerNowUs;
+	offlineRead(NULL, 0, true);
+	CHECK_EQUAL(2, readerCommands);
+	CHECK_EQUAL(2, sends);
+	CHECK_EQUAL(2, transmits);
+	CHECK(readerNowUs - start < 1000000);
+}
+
+int main(void)
+{
+	countActions();
+	testRecordedRead();
+	testRetap();
+	testEdgesBetweenReads();
+	return testDone("testRfidEvents");
+}
@@ -0,0 +1,230 @@
+/*---------------------------------------------------------
+Purpose: Host test of card reading (driverRFID.c) against
+fake reader. Offline first read takes card id and then PIN,
+record and legacy blocks by one 0x52 command, two commands
+from tap to identified. Binary record, legacy ASCII record
+and corrupted record (PIN cleared) are decoded to cardInfo,
+online read takes id and record block. Prints tap to
+identified time with reader latency of the fake, side by side
+with the same fake driven as the baseline driver did it (id,
+then PIN, debt, past expense and past consumption one block
+per command, 2 ms before every reply byte) and as the first
+one transaction driver did (2 ms before every reply byte).
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "driverSPI.h"
+#include "driverRFID.h"
+#include "fakeReader.h"
+#include "testCheck.h"
+
+extern bool deleteCredit;
+
+readerEdge edges[2];
+
+/* -----------------------------------------------------
+uint32_t tapAndRead(bool online)
+Card is put 10 ms from now, read as sessionStart reads it,
+then removed. Returns ms from tap to identified.
+-----------------------------------------------------*/
+uint32_t tapAndRead(bool online)
+{
+	uint32_t tapMs = readerNowUs / 1000 + 10;
+	uint32_t took;
+
+	edges[0].ms = tapMs;
+	edges[0].line = READER_INT0;
+	readerScript(edges, 1);
+	readerCommands = 0;
+	readerBytes = 0;
+	rfidDone = false;
+	if (online)
+	{
+		onlineFirstREad = true;
+		RFIDinit(1, "uid", 3);
+	}else{
+		offlineFirstRead = true;
+		RFIDinit(1, "64.76", 5);
+	}
+	took = readerNowUs / 1000 - tapMs;
+	edges[1].ms = readerNowUs / 1000 + 10;
+	edges[1].line = READER_INT0;
+	readerScript(edges + 1, 1);
+	readerRun(20);
+	return took;
+}
+
+/* -----------------------------------------------------
+void replayTransfer(const uint8_t *tx, uint8_t *rx, uint8_t length, uint8_t gapMs)
+Shifts transfer through SPI engine and lets fake time run
+until it is done.
+-----------------------------------------------------*/
+void replayTransfer(const uint8_t *tx, uint8_t *rx, uint8_t length, uint8_t gapMs)
+{
+	spiTransfer transfer = {tx, rx, length, gapMs, false};
+
+	spiStart(&transfer);
+	while (!transfer.done)
+	{
+		readerRun(1);
+	}
+}
+/* -----------------------------------------------------
+uint32_t replayRead(const uint8_t commands[][3], uint8_t n, uint8_t gapMs)
+Reads card without the driver: every command is sent,
+reply is taken when reader has it ready, gapMs before each
+reply byte. Id command has 1 byte, block reads 3. Returns
+ms the read took.
+-----------------------------------------------------*/
+uint32_t replayRead(const uint8_t commands[][3], uint8_t n, uint8_t gapMs)
+{
+	uint8_t reply[100];
+	uint32_t start;
+
+	readerReset();
+	SPIinit();
+	GICR = 0;	//INT1 edges are not for the driver
+	start = readerNowUs;
+	for (uint8_t c = 0; c < n; c++)
+	{
+		bool id = (commands[c][0] == 0x55);
+		uint8_t blocks = id ? 0 : commands[c][2];
+
+		replayTransfer(commands[c], NULL, id ? 1 : 3, 0);
+		readerRun(readerCommandMs + blocks * readerBlockMs + 1);
+		replayTransfer(NULL, reply, id ? 7 : 1 + blocks * CARD_BLOCK_SIZE, gapMs);
+	}
+	return (readerNowUs - start) / 1000;
+}
+/* -----------------------------------------------------
+void testBeforeAfter(void)
+Tap to identified of the offline read in the same reader
+model: baseline, one transaction with 2 ms per byte, now.
+-----------------------------------------------------*/
+void testBeforeAfter(void)
+{
+	const uint8_t baseline[][3] = {{0x55}, {0x52, 1, 1}, {0x52, 2, 1}, {0x52, 4, 1}, {0x52, 5, 1}};
+	const uint8_t together[][3] = {{0x55}, {0x52, CARD_FIRST_BLOCK, CARD_BLOCK_COUNT}};
+	uint32_t before = replayRead(baseline, 5, 2);
+	uint32_t paced = replayRead(together, 2, 2);
+	uint32_t now;
+
+	readerReset();
+	memcpy(readerCard[1], "4321", 4);
+	now = tapAndRead(false);
+	CHECK(2 * now < paced);
+	CHECK(4 * now < before);
+	printf("tap to identified, same reader model: baseline %lu ms (5 commands), one transaction paced %lu ms, now %lu ms\n",
+		   (unsigned long)before, (unsigned long)paced, (unsigned long)now);
+}
+
+void putRecord(int32_t debt, int32_t energy, int32_t expense)
+{
+	cardRecord record = {"", 3, debt, energy, expense};
+
+	cardDataEncode(&record, readerCard[CARD_DATA_BLOCK]);
+}
+/* -----------------------------------------------------
+void testBinaryCard(void)
+Id, PIN and binary record after two commands.
+-----------------------------------------------------*/
+void testBinaryCard(void)
+{
+	uint32_t took;
+
+	readerReset();
+	memcpy(readerCard[1], "4321", 4);
+	putRecord(1234, 56789, 4321);
+	took = tapAndRead(false);
+	CHECK_EQUAL(2, readerCommands);
+	CHECK_EQUAL(1 + 7 + 3 + 1 + CARD_BLOCK_COUNT * CARD_BLOCK_SIZE, readerBytes);
+	CHECK(strcmp(RfidBufferToRead, "07060504030201") == 0);
+	CHECK(strcmp(cardInfo.pin, "4321") == 0);
+	CHECK(cardRecordValid);
+	CHECK_EQUAL(3, cardInfo.sequence);
+	CHECK_EQUAL(1234, cardInfo.debt);
+	CHECK_EQUAL(56789, cardInfo.pastEnergy);
+	CHECK_EQUAL(4321, cardInfo.pastExpense);
+	/* two command latencies, bytes back to back, ms ticks */
+	CHECK(took >= 25 + 25 + CARD_BLOCK_COUNT * 3);
+	CHECK(took <= 25 + 25 + CARD_BLOCK_COUNT * 3 + 5);
+	printf("offline read: %d commands, %d bytes, tap to identified %lu ms\n", readerCommands, readerBytes, (unsigned long)took);
+}
+/* -----------------------------------------------------
+void testLegacyCard(void)
+ASCII debt, past expense and past energy blocks.
+-----------------------------------------------------*/
+void testLegacyCard(void)
+{
+	readerReset();
+	memcpy(readerCard[1], "1111", 4);
+	strcpy((char *)readerCard[CARD_DATA_BLOCK], "64.76");
+	strcpy((char *)readerCard[CARD_LEGACY_EXPENSE_BLOCK], "12.5");
+	strcpy((char *)readerCard[CARD_LEGACY_ENERGY_BLOCK], "100");
+	tapAndRead(false);
+	CHECK_EQUAL(2, readerCommands);
+	CHECK(cardRecordValid);
+	CHECK(strcmp(cardInfo.pin, "1111") == 0);
+	CHECK_EQUAL(0, cardInfo.sequence);
+	CHECK_EQUAL(6476, cardInfo.debt);
+	CHECK_EQUAL(1250, cardInfo.pastExpense);
+	CHECK_EQUAL(10000, cardInfo.pastEnergy);
+}
+/* -----------------------------------------------------
+void testCorruptedCard(void)
+Record with a bad byte: PIN is cleared, values are zero.
+-----------------------------------------------------*/
+void testCorruptedCard(void)
+{
+	readerReset();
+	memcpy(readerCard[1], "4321", 4);
+	putRecord(1234, 56789, 4321);
+	readerCard[CARD_DATA_BLOCK][4] ^= 0x10;
+	tapAndRead(false);
+	CHECK_EQUAL(2, readerCommands);
+	CHECK(!cardRecordValid);
+	CHECK_EQUAL(0, cardInfo.pin[0]);
+	CHECK_EQUAL(0, cardInfo.debt);
+}
+/* -----------------------------------------------------
+void testOnlineRead(void)
+Id, then record block alone, record is queued for delete
+only if it is valid.
+-----------------------------------------------------*/
+void testOnlineRead(void)
+{
+	readerReset();
+	putRecord(995, 0, 0);
+	tapAndRead(true);
+	CHECK_EQUAL(2, readerCommands);
+	CHECK_EQUAL(1 + 7 + 3 + 1 + CARD_BLOCK_SIZE, readerBytes);
+	CHECK(strcmp(RfidBufferToRead, "07060504030201") == 0);
+	CHECK(cardRecordValid);
+	CHECK_EQUAL(995, cardInfo.debt);
+	CHECK(deleteCredit);
+	onlineFirstREad = false;
+	deleteCredit = false;
+
+	readerReset();
+	putRecord(995, 0, 0);
+	readerCard[CARD_DATA_BLOCK][15] ^= 0x01;
+	tapAndRead(true);
+	CHECK(!cardRecordValid);
+	CHECK(!deleteCredit);
+	onlineFirstREad = false;
+}
+
+int main(void)
+{
+	testBinaryCard();
+	testLegacyCard();
+	testCorruptedCard();
+	testOnlineRead();
+	testBeforeAfter();
+	return testDone("testRfidRead");
+}
@@ -0,0 +1,126 @@
+/*---------------------------------------------------------
+Purpose: Host test of screen templates in flash
+(screenTemplates.c). drawScreen leaves exactly the template
+texts in LCD shadow, no text runs past its line, and drawn
+on a blank display a screen takes at most one address
+command per line. Every screen change from one template to
+any other leaves display equal to shadow.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "driverLCD.h"
+#include "screenTemplates.h"
+#include "fakeLcd.h"
+#include "testCheck.h"
+
+extern char lcdShadow[LCD_CELLS];
+extern bool lcdAsync;
+extern const screenLine * const screens[SCREEN_COUNT];
+
+bool same(void)
+{
+	char cells[LCD_CELLS];
+
+	lcdEmuVisible(cells);
+	return memcmp(cells, lcdShadow, LCD_CELLS) == 0;
+}
+/* -----------------------------------------------------
+void testTemplates(void)
+Shadow built from the table by hand equals drawn one.
+-----------------------------------------------------*/
+void testTemplates(void)
+{
+	char expected[LCD_CELLS];
+	int wrong = 0;
+	int overrun = 0;
+
+	for (uint8_t screen = 0; screen < SCREEN_COUNT; screen++)
+	{
+		memset(expected, ' ', LCD_CELLS);
+		for (const screenLine *line = screens[screen]; line->text != 0; line++)
+		{
+			overrun += (line->x + strlen(line->text) > LCD_COLUMNS);
+			memcpy(expected + line->y * LCD_COLUMNS + line->x, line->text, strlen(line->text));
+		}
+		drawScreen(screen);
+		wrong += (memcmp(expected, lcdShadow, LCD_CELLS) != 0);
+	}
+	CHECK_EQUAL(0, wrong);
+	CHECK_EQUAL(0, overrun);
+
+	drawScreen(SCREEN_WELCOME);
+	CHECK(memcmp(lcdShadow + LCD_COLUMNS, "Ultra 2000 eCharger ", LCD_COLUMNS) == 0);
+	CHECK(memcmp(lcdShadow + 2 * LCD_COLUMNS, "Press any key", 13) == 0);
+	drawScreen(SCREEN_MENU);
+	CHECK(memcmp(lcdShadow + 2 * LCD_COLUMNS, " Consumption", 12) == 0);
+}
+/* -----------------------------------------------------
+void testAddressCommands(void)
+Screen drawn on blank display, one cursor set per line.
+-----------------------------------------------------*/
+void testAddressCommands(void)
+{
+	for (uint8_t screen = 0; screen < SCREEN_COUNT; screen++)
+	{
+		uint8_t lines = 0;
+		unsigned long commands;
+
+		lcdClear();
+		lcdFlush();
+		for (const screenLine *line = screens[screen]; line->text != 0; line++)
+		{
+			lines++;
+		}
+		commands = lcdEmuCommands;
+		drawScreen(screen);
+		lcdFlush();
+		CHECK(lcdEmuCommands - commands <= lines);
+		CHECK(same());
+	}
+}
+/* -----------------------------------------------------
+void testTransitions(void)
+From every screen to every other.
+-----------------------------------------------------*/
+void testTransitions(void)
+{
+	int differ = 0;
+	unsigned long most = 0;
+
+	for (uint8_t from = 0; from < SCREEN_COUNT; from++)
+	{
+		for (uint8_t to = 0; to < SCREEN_COUNT; to++)
+		{
+			unsigned long nibbles;
+
+			drawScreen(from);
+			lcdFlush();
+			nibbles = lcdEmuNibbles;
+			drawScreen(to);
+			lcdFlush();
+			differ += !same();
+			if (lcdEmuNibbles - nibbles > most)
+			{
+				most = lcdEmuNibbles - nibbles;
+			}
+		}
+	}
+	CHECK_EQUAL(0, differ);
+	printf("testScreens: %d screens, longest change between templates %lu nibbles\n", SCREEN_COUNT, most);
+}
+
+int main(void)
+{
+	lcdEmuReset();
+	lcd_init();
+	lcdAsync = false;
+	testTemplates();
+	testAddressCommands();
+	testTransitions();
+	return testDone("testScreens");
+}
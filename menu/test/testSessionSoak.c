@@ -0,0 +1,206 @@
+/*---------------------------------------------------------
+Purpose: Soak of the two dispatch loops, main loop of menu.c
+(stateEval_menu) and id() of sessionStart.c (stateEval),
+both the real ones. Actions that wait for keypad, card,
+server or charging are replaced in the transition tables by
+a probe that checks the state it is fired in, posts the next
+event of a scripted session and records its own frame
+address. identification, id() and idSessionDone stay, so
+every session goes from menu loop into id() and back, one
+step of id() takes the last event again as it does when no
+event is waiting. Session ends where endSessionm would reset
+the controller, the probe there starts the next one as reset
+would. 10000 sessions, the deepest frame of session 1 must
+be the deepest of session 10000 and of every one between,
+and every action a loop fires has the frame of the first one
+that loop fired: actions never nest, the stack does not grow.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <setjmp.h>
+#include "testCheck.h"
+
+#define SOAK_SESSIONS 10000
+/* Script step that posts nothing */
+#define NO_POST 0xFF
+
+/* Transition table cells as sessionStart.c and menu.c have them */
+typedef struct {
+	int nextState;
+	void (*actionToDo)();
+} stateCell;
+
+extern stateCell stateMatrix[7][9];
+extern stateCell stateMatrix_menu[5][6];
+extern int currentState;
+extern int currentState_m;
+extern int EventOccured;
+extern bool idied;
+extern void identification();
+extern void idSessionDone();
+extern void endSessionm();
+extern void stateTransition(int curr);
+extern void stateTransition_m(int curr);
+extern int menuMain(void);
+
+/* States and events of the two tables */
+enum { init, LCD, RFID, KeyPad, Terminal, Session, offline };
+enum { NULLevent, a, b, c, d, e, f, g, h };
+enum { one, charge, consumption, balance, idl };
+enum { zeroevent, a1, b2, c3, d4, e5 };
+
+typedef struct {
+	bool menu;		//step of menu loop, else of id()
+	int state;		//state the probe must be fired in
+	uint8_t post;	//event it posts
+} sessionStep;
+
+/* Online session: idle, identification (welcome, start
+session, repeated packet, card, PIN to server and reply),
+price, charging, consumption, balance, end of session */
+const sessionStep script[] = {
+	{true, idl, b2},
+	{false, init, b}, {false, Session, NO_POST}, {false, Session, c},
+	{false, RFID, a}, {false, Terminal, a}, {false, Terminal, b},
+	{false, KeyPad, a}, {false, Terminal, a}, {false, Terminal, f},
+	{true, one, b2}, {true, one, c3}, {true, charge, a1}, {true, one, d4},
+	{true, consumption, a1}, {true, one, e5}, {true, balance, a1}, {true, one, zeroevent}
+};
+#define SCRIPT_STEPS (sizeof(script) / sizeof(script[0]))
+
+jmp_buf soakEnd;
+uint8_t step = 0;
+long sessions = 0;
+long wrongSteps = 0;
+uintptr_t deepest = UINTPTR_MAX;	//of the session running
+uintptr_t deepestFirst = 0;
+uintptr_t deepestLast = 0;
+long deeperSessions = 0;
+uintptr_t loopFrame[2] = {0, 0};	//of actions fired by id() and by menu loop
+long nested = 0;
+
+/* Not called, charging is replaced by probe */
+void initCharge(void)
+{
+}
+
+bool startCharge(void)
+{
+	return true;
+}
+/* -----------------------------------------------------
+void probe(void)
+In place of every action that waits: checks state, posts
+the next scripted event, records its frame.
+-----------------------------------------------------*/
+void probe(void)
+{
+	const sessionStep *s = &script[step % SCRIPT_STEPS];
+	uintptr_t frame = (uintptr_t)__builtin_frame_address(0);
+
+	if (frame < deepest)
+	{
+		deepest = frame;
+	}
+	if (loopFrame[s->menu] == 0)
+	{
+		loopFrame[s->menu] = frame;
+	}
+	nested += (frame != loopFrame[s->menu]);
+	wrongSteps += (step >= SCRIPT_STEPS) || (s->state != (s->menu ? currentState_m : currentState));
+	step++;
+	if (s->post == NO_POST)
+	{
+		return;
+	}
+	if (s->menu)
+	{
+		stateTransition_m(s->post);
+	}else{
+		stateTransition(s->post);
+	}
+}
+/* -----------------------------------------------------
+void sessionEnd(void)
+In place of endSessionm: closes the session, starts the next
+from globals as they are after reset and from the event
+main posts, or leaves menu loop after the last one.
+-----------------------------------------------------*/
+void sessionEnd(void)
+{
+	wrongSteps += (step != SCRIPT_STEPS) || (currentState_m != idl);
+	sessions++;
+	if (sessions == 1)
+	{
+		deepestFirst = deepest;
+	}
+	deeperSessions += (deepest != deepestFirst);
+	deepestLast = deepest;
+	if (sessions == SOAK_SESSIONS)
+	{
+		longjmp(soakEnd, 1);
+	}
+	deepest = UINTPTR_MAX;
+	step = 0;
+	currentState = init;
+	EventOccured = a;
+	idied = false;
+	stateTransition_m(a1);
+}
+/* -----------------------------------------------------
+void probeActions(stateCell *cells, int n)
+Puts probe in place of every action but the ones that
+run the loops and end them.
+-----------------------------------------------------*/
+void probeActions(stateCell *cells, int n)
+{
+	for (int i = 0; i < n; i++)
+	{
+		void (*action)() = cells[i].actionToDo;
+
+		if (action == endSessionm)
+		{
+			cells[i].actionToDo = sessionEnd;
+		}
+		else if ((action != identification) && (action != idSessionDone))
+		{
+			cells[i].actionToDo = probe;
+		}
+	}
+}
+/* -----------------------------------------------------
+void testSoak(void)
+10000 sessions through menuMain, deepest frame is the same
+in all of them.
+-----------------------------------------------------*/
+void testSoak(void)
+{
+	volatile uintptr_t base = (uintptr_t)__builtin_frame_address(0);
+
+	probeActions(&stateMatrix[0][0], 7 * 9);
+	probeActions(&stateMatrix_menu[0][0], 5 * 6);
+	if (setjmp(soakEnd) == 0)
+	{
+		menuMain();
+	}
+	CHECK_EQUAL(SOAK_SESSIONS, sessions);
+	CHECK_EQUAL(0, wrongSteps);
+	CHECK_EQUAL(0, deeperSessions);
+	CHECK_EQUAL(0, nested);
+	CHECK_EQUAL(deepestFirst, deepestLast);
+	printf("%d sessions, %d actions each: deepest action %lu bytes below test at session 1, %lu at session %d (host frames)\n",
+		   SOAK_SESSIONS, (int)SCRIPT_STEPS + 1, (unsigned long)(base - deepestFirst),
+		   (unsigned long)(base - deepestLast), SOAK_SESSIONS);
+}
+
+int main(void)
+{
+	testSoak();
+	return testDone("testSessionSoak");
+}
@@ -0,0 +1,242 @@
+/*---------------------------------------------------------
+Purpose: Host test of SPI transfer engine (driverSPI.c) and
+card id conversion. SPIinit chooses fck/64, the fastest
+divider within SPI_READER_MAX_HZ. Transfer is shifted from
+SPI_STC_vect back to back, or one byte per gap from
+spiTick, tx NULL sends SPI_FILL, rx NULL drops bytes, busy
+engine refuses the next transfer, empty one is done at once.
+idToString fills MAX digits and the terminator, not more.
+Card reply is clocked back to back. Prints bytes per second,
+interrupts and estimated busy cycles per card read.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "driverSPI.h"
+#include "driverRFID.h"
+#include "fakeReader.h"
+#include "testCheck.h"
+
+/* Gap of the engine test, the one old driver had */
+#define GAP_MS 2
+/* Controller clock and AVR cycles counted by hand from the C
+code: SPI interrupt with entry and exit, wake up from sleep
+with queue check, spiTick in timer interrupt, command and
+its decoding (sendCommand, transmitString, cardDataDecode) */
+#define CPU_HZ 10000000UL
+#define SPI_ISR_CYCLES 45
+#define WAKE_CYCLES 30
+#define TICK_CYCLES 15
+#define COMMAND_CYCLES 2000
+
+extern char superBuffer[100];
+extern void idToString();
+
+/* -----------------------------------------------------
+void testDivider(void)
+10 MHz / 64 is 156 kHz, / 32 would be 312 kHz.
+-----------------------------------------------------*/
+void testDivider(void)
+{
+	SPIinit();
+	CHECK_EQUAL((1<<SPIE) | (1<<SPE) | (1<<MSTR) | (1<<SPR1), SPCR);
+	CHECK_EQUAL(0, SPSR);
+	CHECK_EQUAL((1<<PB4) | (1<<PB5) | (1<<PB7), DDRB);
+	CHECK_EQUAL(52, readerByteUs());
+	CHECK(10000000UL / 64 <= SPI_READER_MAX_HZ);
+	CHECK(10000000UL / 32 > SPI_READER_MAX_HZ);
+}
+/* -----------------------------------------------------
+void testBackToBack(void)
+20 bytes in 20 byte times, engine busy meanwhile.
+-----------------------------------------------------*/
+void testBackToBack(void)
+{
+	uint8_t tx[20];
+	uint8_t rx[20];
+	spiTransfer transfer = {tx, rx, sizeof(tx), 0, false};
+	spiTransfer other = {tx, NULL, 1, 0, false};
+	uint32_t start;
+	uint32_t took;
+
+	readerReset();
+	readerEcho = true;
+	SPIinit();
+	for (uint8_t i = 0; i < sizeof(tx); i++)
+	{
+		tx[i] = 17 * i;
+	}
+	start = readerNowUs;
+	CHECK(spiStart(&transfer));
+	CHECK(spiBusy());
+	CHECK(!spiStart(&other));
+	readerRun(2);
+	CHECK(transfer.done);
+	took = readerByteDoneUs[sizeof(tx) - 1] - start;
+	CHECK(!spiBusy());
+	CHECK_EQUAL(sizeof(tx), readerSpiInterrupts);
+	CHECK_EQUAL(sizeof(tx) * readerByteUs(), took);
+	for (uint8_t i = 0; i < sizeof(rx); i++)
+	{
+		CHECK_EQUAL((uint8_t)~tx[i], rx[i]);
+	}
+	CHECK(!other.done);
+	CHECK(spiStart(&other));
+	printf("back to back: %lu bytes/s\n", (unsigned long)(sizeof(tx) * 1000000UL / took));
+	readerRun(1);
+	CHECK(other.done);
+}
+/* -----------------------------------------------------
+void testNullBuffers(void)
+Poll bytes are SPI_FILL, empty transfer is done at once.
+-----------------------------------------------------*/
+void testNullBuffers(void)
+{
+	uint8_t rx[4];
+	spiTransfer poll = {NULL, rx, sizeof(rx), 0, false};
+	spiTransfer drop = {rx, NULL, sizeof(rx), 0, false};
+	spiTransfer empty = {NULL, NULL, 0, 0, false};
+
+	readerReset();
+	readerEcho = true;
+	SPIinit();
+	CHECK(spiStart(&poll));
+	readerRun(1);
+	CHECK(poll.done);
+	for (uint8_t i = 0; i < sizeof(rx); i++)
+	{
+		CHECK_EQUAL((uint8_t)~SPI_FILL, rx[i]);
+	}
+	CHECK(spiStart(&drop));
+	readerRun(1);
+	CHECK(drop.done);
+	CHECK_EQUAL((uint8_t)~SPI_FILL, rx[0]);
+	CHECK(spiStart(&empty));
+	CHECK(empty.done);
+	CHECK(!spiBusy());
+}
+/* -----------------------------------------------------
+void testGap(void)
+Byte of a transfer with gap starts gap to gap + 1 ms after
+the one before.
+-----------------------------------------------------*/
+void testGap(void)
+{
+	uint8_t rx[10];
+	spiTransfer transfer = {NULL, rx, sizeof(rx), GAP_MS, false};
+	uint32_t last;
+	int wrong = 0;
+
+	readerReset();
+	readerEcho = true;
+	SPIinit();
+	readerRun(1);
+	last = readerNowUs;
+	CHECK(spiStart(&transfer));
+	readerRun(sizeof(rx) * (GAP_MS + 1) + 1);
+	CHECK(transfer.done);
+	CHECK_EQUAL(sizeof(rx), readerBytes);
+	for (uint8_t i = 0; i < sizeof(rx); i++)
+	{
+		uint32_t start = readerByteDoneUs[i] - readerByteUs();
+
+		wrong += (start - last < GAP_MS * 1000) || (start - last > (GAP_MS + 1) * 1000);
+		last = readerByteDoneUs[i];
+	}
+	CHECK_EQUAL(0, wrong);
+	printf("with %d ms gap: %lu bytes/s\n", GAP_MS,
+		   (unsigned long)(sizeof(rx) * 1000000UL / (readerByteDoneUs[sizeof(rx) - 1] - readerByteDoneUs[0] + readerByteUs())));
+}
+/* -----------------------------------------------------
+void testIdToString(void)
+Seven id bytes are 14 hex digits, last byte first.
+-----------------------------------------------------*/
+void testIdToString(void)
+{
+	const uint8_t id[7] = {0xAB, 0x01, 0x23, 0x45, 0x67, 0x89, 0xCD};
+
+	memset(RfidBufferToRead, 'x', sizeof(RfidBufferToRead));
+	memcpy(superBuffer, id, sizeof(id));
+	idToString();
+	CHECK_EQUAL(MAX + 1, sizeof(RfidBufferToRead));
+	CHECK_EQUAL(MAX, strlen(RfidBufferToRead));
+	CHECK(strcmp(RfidBufferToRead, "CD8967452301AB") == 0);
+	CHECK_EQUAL(0, superBuffer[0]);
+}
+/* -----------------------------------------------------
+void testCardRead(void)
+Offline read: one SPI interrupt per byte, reply bytes back
+to back, driver sleeps between interrupts. Busy cycles are
+estimated from interrupts and wake ups.
+-----------------------------------------------------*/
+void testCardRead(void)
+{
+	readerEdge tap[2] = {{10, READER_INT0}, {1000, READER_INT0}};
+	uint32_t took;
+	uint32_t busy;
+	int gaps = 0;
+
+	readerReset();
+	readerScript(tap, 2);
+	offlineFirstRead = true;
+	rfidDone = false;
+	RFIDinit(1, "64.76", 5);
+	took = readerNowUs / 1000 - 10;
+	CHECK_EQUAL(readerBytes, readerSpiInterrupts);
+	CHECK(readerWakeups >= readerSpiInterrupts);
+	for (int i = readerBytes - CARD_BLOCK_COUNT * CARD_BLOCK_SIZE; i < readerBytes; i++)
+	{
+		gaps += (readerByteDoneUs[i] - readerByteDoneUs[i - 1] != readerByteUs());
+	}
+	CHECK_EQUAL(0, gaps);
+	busy = readerSpiInterrupts * SPI_ISR_CYCLES + readerWakeups * WAKE_CYCLES +
+		   took * TICK_CYCLES + readerCommands * COMMAND_CYCLES;
+	CHECK(busy * 10 < took * (CPU_HZ / 1000));
+	printf("offline read: %d bytes, %d SPI interrupts, %d wake ups in %lu ms, busy about %lu of %lu cycles\n",
+		   readerBytes, readerSpiInterrupts, readerWakeups, (unsigned long)took,
+		   (unsigned long)busy, (unsigned long)(took * (CPU_HZ / 1000)));
+	readerRun(1000);
+}
+
+/* -----------------------------------------------------
+void testCardWrite(void)
+Log out: record written by one command, the same estimate.
+-----------------------------------------------------*/
+void testCardWrite(void)
+{
+	readerEdge tap[2] = {{10, READER_INT0}, {1000, READER_INT0}};
+	uint32_t took;
+	uint32_t busy;
+
+	readerReset();
+	readerScript(tap, 2);
+	offlineWrite = true;
+	rfidDone = false;
+	RFIDinit(5, "write", 5);
+	offlineWrite = false;
+	took = readerNowUs / 1000 - 10;
+	CHECK_EQUAL(1, readerCommands);
+	busy = readerSpiInterrupts * SPI_ISR_CYCLES + readerWakeups * WAKE_CYCLES +
+		   took * TICK_CYCLES + readerCommands * COMMAND_CYCLES;
+	CHECK(busy * 10 < took * (CPU_HZ / 1000));
+	printf("log out write: %d bytes, %d wake ups in %lu ms, busy about %lu of %lu cycles\n",
+		   readerBytes, readerWakeups, (unsigned long)took,
+		   (unsigned long)busy, (unsigned long)(took * (CPU_HZ / 1000)));
+	readerRun(1000);
+}
+
+int main(void)
+{
+	testDivider();
+	testBackToBack();
+	testNullBuffers();
+	testGap();
+	testIdToString();
+	testCardRead();
+	testCardWrite();
+	return testDone("testSpi");
+}
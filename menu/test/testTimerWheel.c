@@ -0,0 +1,179 @@
+/*---------------------------------------------------------
+Purpose: Host test of software timers (timerWheel.c) on a
+fake 1 ms tick. One-shot timer fires once when it is due,
+periodic one keeps its period without drift, also across
+wrap of the 16 bit tick. Late poll drops missed periods.
+Callback could start its own timer again, stopped timer
+does not fire, table has TIMER_SLOTS places.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include "timerWheel.h"
+#include "testCheck.h"
+
+uint16_t fakeTick = 0;
+int fired[TIMER_SLOTS];
+uint16_t firedAt[64];
+int firedCount = 0;
+
+/* -----------------------------------------------------
+uint16_t getTick(void)
+Tick of driverTimer, moved by the test.
+-----------------------------------------------------*/
+uint16_t getTick(void)
+{
+	return fakeTick;
+}
+
+void callbackA(void)
+{
+	fired[0]++;
+	if (firedCount < 64)
+	{
+		firedAt[firedCount++] = fakeTick;
+	}
+}
+
+void callbackB(void)
+{
+	fired[1]++;
+}
+
+int8_t restartHandle = NO_TIMER;
+
+void callbackRestart(void)
+{
+	fired[2]++;
+	if (fired[2] < 3)
+	{
+		restartHandle = timerStart(10, 0, callbackRestart);
+	}
+}
+
+void nothing(void)
+{
+}
+/* -----------------------------------------------------
+void run(uint16_t ms)
+Tick goes on ms times and main loop polls after every one.
+-----------------------------------------------------*/
+void run(uint16_t ms)
+{
+	while (ms-- > 0)
+	{
+		fakeTick++;
+		timerPoll();
+	}
+}
+
+void reset(uint16_t tick)
+{
+	for (int8_t h = 0; h < TIMER_SLOTS; h++)
+	{
+		timerStop(h);
+		fired[h] = 0;
+	}
+	firedCount = 0;
+	fakeTick = tick;
+}
+/* -----------------------------------------------------
+void testOneShot(void)
+Fires at start + delay, only once, and frees the slot.
+-----------------------------------------------------*/
+void testOneShot(void)
+{
+	int8_t h;
+
+	reset(100);
+	h = timerStart(50, 0, callbackA);
+	run(49);
+	CHECK_EQUAL(0, fired[0]);
+	CHECK(timerActive(h));
+	run(1);
+	CHECK_EQUAL(1, fired[0]);
+	CHECK_EQUAL(150, firedAt[0]);
+	CHECK(!timerActive(h));
+	run(500);
+	CHECK_EQUAL(1, fired[0]);
+}
+/* -----------------------------------------------------
+void testPeriodicWrap(void)
+Period of 7 ms across tick wrap, every call exactly 7 ms
+after the one before.
+-----------------------------------------------------*/
+void testPeriodicWrap(void)
+{
+	int8_t h;
+	int wrong = 0;
+
+	reset(0xFFF0);
+	h = timerStart(7, 7, callbackA);
+	run(7 * 40);
+	CHECK_EQUAL(40, fired[0]);
+	for (int i = 1; i < firedCount; i++)
+	{
+		wrong += ((uint16_t)(firedAt[i] - firedAt[i - 1]) != 7);
+	}
+	CHECK_EQUAL(0, wrong);
+	CHECK_EQUAL((uint16_t)(0xFFF0 + 7), firedAt[0]);
+	timerStop(h);
+	run(20);
+	CHECK_EQUAL(40, fired[0]);
+}
+/* -----------------------------------------------------
+void testLatePoll(void)
+Main loop away for 35 ms of 10 ms period: one call, then
+period goes on from now.
+-----------------------------------------------------*/
+void testLatePoll(void)
+{
+	reset(1000);
+	timerStart(10, 10, callbackA);
+	fakeTick += 35;
+	timerPoll();
+	CHECK_EQUAL(1, fired[0]);
+	run(9);
+	CHECK_EQUAL(1, fired[0]);
+	run(1);
+	CHECK_EQUAL(2, fired[0]);
+	CHECK_EQUAL(1045, firedAt[1]);
+}
+/* -----------------------------------------------------
+void testRestartAndSlots(void)
+Callback starts its timer again, table gets full.
+-----------------------------------------------------*/
+void testRestartAndSlots(void)
+{
+	int8_t handles[TIMER_SLOTS];
+
+	reset(0);
+	timerStart(10, 0, callbackRestart);
+	run(100);
+	CHECK_EQUAL(3, fired[2]);
+
+	reset(0);
+	for (int8_t h = 0; h < TIMER_SLOTS; h++)
+	{
+		handles[h] = timerStart(1000, 0, nothing);
+		CHECK(handles[h] != NO_TIMER);
+	}
+	CHECK_EQUAL(NO_TIMER, timerStart(5, 0, callbackB));
+	timerStop(handles[3]);
+	CHECK_EQUAL(handles[3], timerStart(5, 0, callbackB));
+	run(5);
+	CHECK_EQUAL(1, fired[1]);
+	CHECK(!timerActive(NO_TIMER));
+}
+
+int main(void)
+{
+	testOneShot();
+	testPeriodicWrap();
+	testLatePoll();
+	testRestartAndSlots();
+	return testDone("testTimerWheel");
+}
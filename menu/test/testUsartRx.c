@@ -0,0 +1,192 @@
+/*---------------------------------------------------------
+Purpose: Host test of USART receive ring (dataReceive.c).
+Bytes are put to UDR and USART_RXC_vect is called as the
+interrupt would be, main loop side drains them through
+receivePackage(). Checks that a full ring drops and counts
+only the bytes that do not fit, that hardware overruns are
+counted, and that a long stream of packages is received
+without loss while main loop drains the ring in bursts.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <avr/io.h>
+#include "dataReceive.h"
+#include "formPacket.h"
+#include "testCheck.h"
+
+/* Same as in dataReceive.c */
+#define RX_RING_SIZE 64
+
+extern void USART_RXC_vect(void);
+extern bool rxRingGet(char *byte);
+
+/* -----------------------------------------------------
+void rxByte(char byte)
+Byte arrives to USART.
+-----------------------------------------------------*/
+void rxByte(char byte)
+{
+	UDR = byte;
+	USART_RXC_vect();
+}
+/* -----------------------------------------------------
+int serverPackage(char *wire, const char *command, const char *data)
+Package from server (01) to controller (02) as it is on
+wire, with start chars. Returns its length.
+-----------------------------------------------------*/
+int serverPackage(char *wire, const char *command, const char *data)
+{
+	formPacket("01", "02", (char *)command, (char *)data);
+	wire[0] = '*';
+	wire[1] = '-';
+	memcpy(wire + 2, formedDataPackageToSend, formedPacketLength);
+	return formedPacketLength + 2;
+}
+/* -----------------------------------------------------
+void drain(void)
+Empties ring and parser state between tests.
+-----------------------------------------------------*/
+void drain(void)
+{
+	char byte;
+
+	while (rxRingGet(&byte));
+}
+/* -----------------------------------------------------
+void testFullRing(void)
+Ring keeps RX_RING_SIZE bytes in order, the next ones are
+dropped and counted.
+-----------------------------------------------------*/
+void testFullRing(void)
+{
+	char byte;
+	uint16_t overruns = rxOverruns;
+
+	for (int i = 0; i < RX_RING_SIZE + 5; i++)
+	{
+		rxByte('A' + (i % 26));
+	}
+	CHECK_EQUAL(5, rxOverruns - overruns);
+	for (int i = 0; i < RX_RING_SIZE; i++)
+	{
+		CHECK(rxRingGet(&byte));
+		CHECK_EQUAL('A' + (i % 26), byte);
+	}
+	CHECK(!rxRingGet(&byte));
+}
+/* -----------------------------------------------------
+void testHardwareOverrun(void)
+DOR flag in UCSRA is counted, byte is still kept.
+-----------------------------------------------------*/
+void testHardwareOverrun(void)
+{
+	char byte;
+	uint16_t hwOverruns = rxHwOverruns;
+
+	UCSRA = (1<<DOR);
+	rxByte('x');
+	UCSRA = 0;
+	rxByte('y');
+	CHECK_EQUAL(1, rxHwOverruns - hwOverruns);
+	CHECK(rxRingGet(&byte) && (byte == 'x'));
+	CHECK(rxRingGet(&byte) && (byte == 'y'));
+}
+/* -----------------------------------------------------
+void testStream(int burst)
+Thousand packages arrive, main loop looks at the ring after
+every burst bytes. While burst is below ring size nothing
+is lost, indexes wrap many times.
+-----------------------------------------------------*/
+void testStream(int burst)
+{
+	char wire[100];
+	char data[20];
+	int received = 0;
+	int sent = 0;
+	int pending = 0;
+	uint16_t overruns = rxOverruns;
+	uint16_t rejected = rxFramesRejected;
+
+	for (int p = 0; p < 1000; p++)
+	{
+		sprintf(data, "%d.%02d", p, p % 100);
+		int n = serverPackage(wire, "51", data);
+		sent++;
+		for (int i = 0; i < n; i++)
+		{
+			rxByte(wire[i]);
+			if (++pending == burst)
+			{
+				pending = 0;
+				while (receivePackage())
+				{
+					CHECK_EQUAL(RX_OK, _status);
+					CHECK_EQUAL(51, _command);
+					sprintf(data, "%d.%02d", received, received % 100);
+					CHECK(strcmp(actualData, data) == 0);
+					received++;
+				}
+			}
+		}
+	}
+	while (receivePackage())
+	{
+		received++;
+	}
+	CHECK_EQUAL(sent, received);
+	CHECK_EQUAL(0, rxOverruns - overruns);
+	CHECK_EQUAL(0, rxFramesRejected - rejected);
+}
+/* -----------------------------------------------------
+void testLateDrain(void)
+Main loop that comes back after more than ring size bytes
+loses package, the loss is counted and the next package is
+received again.
+-----------------------------------------------------*/
+void testLateDrain(void)
+{
+	char wire[100];
+	char data[] = "1234567890123456789012345678901234567890";
+	uint16_t overruns = rxOverruns;
+	int n;
+	int received = 0;
+
+	n = serverPackage(wire, "51", data);
+	for (int r = 0; r < 2; r++)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			rxByte(wire[i]);
+		}
+	}
+	while (receivePackage())
+	{
+		received += (_status == RX_OK);
+	}
+	CHECK(rxOverruns - overruns > 0);
+	CHECK(received < 2);
+	for (int i = 0; i < n; i++)
+	{
+		rxByte(wire[i]);
+	}
+	CHECK(receivePackage());
+	CHECK_EQUAL(RX_OK, _status);
+	CHECK(strcmp(actualData, data) == 0);
+}
+
+int main(void)
+{
+	testFullRing();
+	testHardwareOverrun();
+	drain();
+	testStream(1);
+	testStream(17);
+	testStream(RX_RING_SIZE);
+	testLateDrain();
+	return testDone("testUsartRx");
+}
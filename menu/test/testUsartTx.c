@@ -0,0 +1,201 @@
+/*---------------------------------------------------------
+Purpose: Host test of USART transmit ring (driverUSART.c).
+Checks that sending returns before any byte is on wire,
+that USART_UDRE_vect moves the bytes to UDR in order and
+switches itself off when ring is empty, and that ring
+indexes keep order across many wraps. Prints foreground
+cycles per package and for the charging packages (86, gap,
+87) against the polling transmit of the baseline.
+
+Author: Ultra 2000
+Company: DTU Dipom
+Version: 1.0
+Date and year: 2014/05/26
+-----------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <avr/io.h>
+#include "driverUSART.h"
+#include "formPacket.h"
+#include "testCheck.h"
+
+/* Same as in driverUSART.c */
+#define TX_RING_SIZE 128
+/* Controller clock, byte time at 19230 baud (UBRR 64, U2X),
+10 bits per byte, and gap of old servers (menu.c) */
+#define CPU_HZ 10000000UL
+#define BYTE_CYCLES (CPU_HZ * 10 / 19230)
+#define GAP_MS 500
+/* AVR cycles, counted by hand from what the C code is: polling
+loop of baseline transmitUSART (in, sbrs, rjmp), queuing one
+byte to the ring and UDRE interrupt with its entry and exit */
+#define POLL_CYCLES 4
+#define QUEUE_CYCLES 20
+#define UDRE_CYCLES 40
+
+extern void USART_UDRE_vect(void);
+
+char wire[1024];
+int wireLength;
+
+/* -----------------------------------------------------
+int udreRun(int max)
+Fires UDRE interrupt while it is enabled, at most max times,
+collects bytes written to UDR. Returns bytes sent.
+-----------------------------------------------------*/
+int udreRun(int max)
+{
+	int sent = 0;
+
+	while ((UCSRB & (1<<UDRIE)) && (max-- > 0))
+	{
+		int before = wireLength;
+
+		UDR = 0;
+		USART_UDRE_vect();
+		if (UCSRB & (1<<UDRIE))
+		{
+			wire[wireLength++] = UDR;
+		}
+		sent += wireLength - before;
+	}
+	return sent;
+}
+/* -----------------------------------------------------
+void testQueued(void)
+Package is queued without waiting, then drained in order.
+-----------------------------------------------------*/
+void testQueued(void)
+{
+	char package[] = "*-0201500018SendCurrentPrice7A3C-*";
+
+	wireLength = 0;
+	sendStringUSART(package);
+	CHECK_EQUAL(0, wireLength);
+	CHECK(UCSRB & (1<<UDRIE));
+	CHECK(!txQueueEmpty());
+	udreRun(1000);
+	CHECK(!(UCSRB & (1<<UDRIE)));
+	CHECK(txQueueEmpty());
+	CHECK_EQUAL(strlen(package), wireLength);
+	CHECK(memcmp(wire, package, wireLength) == 0);
+}
+/* -----------------------------------------------------
+void testFullRing(void)
+TX_RING_SIZE bytes fit without UDRE running.
+-----------------------------------------------------*/
+void testFullRing(void)
+{
+	wireLength = 0;
+	for (int i = 0; i < TX_RING_SIZE; i++)
+	{
+		transmitUSART((char)i);
+	}
+	CHECK_EQUAL(0, wireLength);
+	udreRun(1000);
+	CHECK_EQUAL(TX_RING_SIZE, wireLength);
+	for (int i = 0; i < TX_RING_SIZE; i++)
+	{
+		CHECK_EQUAL((uint8_t)i, (uint8_t)wire[i]);
+	}
+}
+/* -----------------------------------------------------
+void testInterleaved(void)
+Main loop and interrupt take turns for many ring wraps,
+bytes come out in order. Ring is drained whenever the next
+burst would not fit, transmitUSART would wait forever here.
+-----------------------------------------------------*/
+void testInterleaved(void)
+{
+	uint8_t next = 0;
+	uint8_t expected = 0;
+
+	for (int round = 0; round < 200; round++)
+	{
+		int queued = (round * 7) % 50 + 1;
+
+		if ((uint8_t)(next - expected) + queued > TX_RING_SIZE)
+		{
+			wireLength = 0;
+			udreRun(1000);
+			for (int i = 0; i < wireLength; i++)
+			{
+				CHECK_EQUAL(expected++, (uint8_t)wire[i]);
+			}
+		}
+		wireLength = 0;
+		for (int i = 0; i < queued; i++)
+		{
+			transmitUSART((char)next++);
+		}
+		udreRun((round * 3) % queued + 1);
+		for (int i = 0; i < wireLength; i++)
+		{
+			CHECK_EQUAL(expected++, (uint8_t)wire[i]);
+		}
+	}
+	wireLength = 0;
+	udreRun(1000);
+	for (int i = 0; i < wireLength; i++)
+	{
+		CHECK_EQUAL(expected++, (uint8_t)wire[i]);
+	}
+	CHECK_EQUAL(next, expected);
+	CHECK(txQueueEmpty());
+}
+/* -----------------------------------------------------
+void testTxcCleared(void)
+Queuing a byte clears TXC, so flushUSART waits for it.
+-----------------------------------------------------*/
+void testTxcCleared(void)
+{
+	UCSRA = (1<<U2X);
+	transmitUSART('a');
+	CHECK(UCSRA & (1<<U2X));
+	udreRun(1000);
+	UCSRA |= (1<<TXC);
+	flushUSART();
+	CHECK(txQueueEmpty());
+}
+
+/* -----------------------------------------------------
+void testFrameCycles(void)
+Baseline waited for UDRE before every byte, so the main
+loop was held for the time of the package on wire, and
+slept GAP_MS between 86 and 87. Ring costs a queue and an
+interrupt per byte, gap is a software timer.
+-----------------------------------------------------*/
+void testFrameCycles(void)
+{
+	int interrupts = 0;
+	uint32_t polling;
+	uint32_t queued;
+
+	formPacketFixed("86", 123456);
+	wireLength = 0;
+	sendPacket();
+	while (UCSRB & (1<<UDRIE))
+	{
+		interrupts++;
+		udreRun(1);
+	}
+	CHECK_EQUAL(formedPacketLength, wireLength);
+	CHECK_EQUAL(wireLength + 1, interrupts);
+	polling = (wireLength - 1) * BYTE_CYCLES + wireLength * POLL_CYCLES;
+	queued = wireLength * QUEUE_CYCLES + interrupts * UDRE_CYCLES;
+	CHECK(50 * queued < polling);
+	printf("package of %d bytes: polling %lu cycles, ring %lu cycles of main loop\n",
+		   wireLength, (unsigned long)polling, (unsigned long)queued);
+	printf("charging 86, gap, 87: polling and _delay_ms %lu cycles, ring and timer %lu cycles\n",
+		   (unsigned long)(2 * polling + GAP_MS * (CPU_HZ / 1000)), (unsigned long)(2 * queued));
+}
+
+int main(void)
+{
+	testQueued();
+	testFullRing();
+	testInterleaved();
+	testTxcCleared();
+	testFrameCycles();
+	return testDone("testUsartTx");
+}